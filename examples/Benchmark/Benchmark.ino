@@ -0,0 +1,418 @@
+/**
+ * @brief Measures the cost of the moving average filters.
+ *
+ * Every benchmark prints one line with its name and the measured time per operation. The sizes
+ * default to what fits into the RAM of the board, 2 KB on an AVR such as the Nano, pass e.g.
+ * -DBENCHMARK_FILTERS=10000 to run the filter bank at full size on a host or a large board. The
+ * bank of 64 independent per-channel filters is the typical multi-channel firmware, every filter
+ * keeps all its state in the object and its own ring.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <MovingAverage.h>
+#include <FirFilter.h>
+#include <Reciprocal.h>
+#include <MedianNetwork.h>
+#include <DmaIngestion.h>
+
+#ifndef BENCHMARK_FILTERS
+#if defined(__AVR__)
+#define BENCHMARK_FILTERS 4
+#else
+#define BENCHMARK_FILTERS 64
+#endif
+#endif
+
+#define BENCHMARK_WINDOW 8
+#define BENCHMARK_ROUNDS 32
+
+#define BENCHMARK_TAPS 15
+#define BENCHMARK_MEDIAN 9
+
+// Data points per benchmark and windows of the burst, slope and order statistic benchmarks
+#if defined(__AVR__)
+#define BENCHMARK_SAMPLES 64
+#define BENCHMARK_BURST 16
+#define BENCHMARK_SLOPE 16
+#else
+#define BENCHMARK_SAMPLES 256
+#define BENCHMARK_BURST 64
+#define BENCHMARK_SLOPE 64
+#endif
+
+// Window sizes of the large window benchmark, limited by the RAM for the ring
+#if defined(__AVR__)
+const uint32_t large_windows[] = { 32, 64 };
+#else
+const uint32_t large_windows[] = { 1024, 65536, 1048576 };
+#endif
+
+#ifndef BENCHMARK_ORDER_WINDOW
+#if defined(__AVR__)
+#define BENCHMARK_ORDER_WINDOW 16
+#else
+#define BENCHMARK_ORDER_WINDOW 4096
+#endif
+#endif
+
+#ifndef BENCHMARK_DMA_SCANS
+#if defined(__AVR__)
+#define BENCHMARK_DMA_SCANS 8
+#else
+#define BENCHMARK_DMA_SCANS 64
+#endif
+#endif
+
+#if defined(__AVR__)
+#define BENCHMARK_DMA_CHANNELS 2
+#else
+#define BENCHMARK_DMA_CHANNELS 4
+#endif
+
+// Histogram of the callback latencies, smaller on AVR
+#if defined(__AVR__)
+typedef LatencyHistogram<2, 16, uint16_t> BenchmarkHistogram;
+#else
+typedef LatencyHistogram<> BenchmarkHistogram;
+#endif
+
+MovingAverage<> filters[BENCHMARK_FILTERS];  // A dense array of filters, one per channel
+
+// The same binomial kernel in RAM and in flash; its coefficients sum to 2^14, so 16-bit data points
+// accumulate in 32 bits
+const FilterKernel<uint16_t, BENCHMARK_TAPS> ram_kernel = FilterCore::binomialKernel<uint16_t, BENCHMARK_TAPS>();
+const FilterKernel<uint16_t, BENCHMARK_TAPS> flash_kernel PROGMEM = FilterCore::binomialKernel<uint16_t, BENCHMARK_TAPS>();
+FirFilter<int16_t, int16_t, uint16_t, BENCHMARK_TAPS, RamStorage, int32_t> ram_fir(ram_kernel.coefficients);
+FirFilter<int16_t, int16_t, uint16_t, BENCHMARK_TAPS, ProgmemStorage, int32_t> flash_fir(flash_kernel.coefficients);
+
+// Per channel filters fed one data point at a time and from a simulated DMA buffer
+MovingAverage<> scan_filters[BENCHMARK_DMA_CHANNELS];
+MovingAverage<> dma_filters[BENCHMARK_DMA_CHANNELS];
+DmaIngestion<MovingAverage<>, int16_t, BENCHMARK_DMA_SCANS, BENCHMARK_DMA_CHANNELS, BenchmarkHistogram> dma(dma_filters);
+
+MovingAverage<> slope_filter;
+int16_t slope_window[BENCHMARK_SLOPE];  // Ring of the recomputed regression
+float slopes[2];                         // Output of the slope benchmark, global so it is not optimised away
+
+int16_t series[BENCHMARK_SAMPLES];   // Input of the median benchmark
+int16_t medians[BENCHMARK_SAMPLES];  // Output of the median benchmark, global so it is not optimised away
+int16_t order_window[BENCHMARK_ORDER_WINDOW];  // Ring of the order statistic benchmark
+
+/**
+ * @brief Prints the result of a benchmark.
+ *
+ * @param name The name of the benchmark.
+ * @param elapsed The elapsed time in microseconds.
+ * @param operations The number of operations timed.
+ */
+void printResult(const char* name, unsigned long elapsed, unsigned long operations) {
+  Serial.print(name);
+  Serial.print(":\tns/op:");
+  Serial.print((unsigned long)(elapsed * 1000.0 / operations));
+  Serial.print("\n");
+}
+
+/**
+ * @brief Feeds a sample into every filter of the bank and reads SMA and WMA.
+ */
+void benchmarkBank() {
+  unsigned long start = micros();
+  for (uint8_t round = 0; round < BENCHMARK_ROUNDS; round++) {
+    for (uint16_t i = 0; i < BENCHMARK_FILTERS; i++) {
+      filters[i].add(i + round);
+      filters[i].readAverage(BENCHMARK_WINDOW);
+      filters[i].readWeightedAverage(BENCHMARK_WINDOW);
+    }
+  }
+  printResult("Bank", micros() - start, (unsigned long)BENCHMARK_ROUNDS * BENCHMARK_FILTERS);
+}
+
+/**
+ * @brief Runs an FIR filter over random data points.
+ *
+ * @param name The name of the benchmark.
+ * @param fir The filter under test.
+ */
+template<typename F>
+void benchmarkFir(const char* name, F& fir) {
+  unsigned long start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    fir.add(i * 31);
+    fir.read();
+  }
+  printResult(name, micros() - start, BENCHMARK_SAMPLES);
+}
+
+/**
+ * @brief Shows that SMA and WMA cost the same per data point for any window size.
+ *
+ * Uses 32-bit window sizes, fills each window once and then times adding a data point and reading
+ * both averages.
+ */
+void benchmarkLargeWindows() {
+  for (uint8_t w = 0; w < sizeof(large_windows) / sizeof(large_windows[0]); w++) {
+    MovingAverage<int32_t, int32_t, uint32_t>* filter = new MovingAverage<int32_t, int32_t, uint32_t>();
+    filter->begin();
+    for (uint32_t i = 0; i < large_windows[w]; i++) {
+      filter->add(i & 1023);
+      filter->readAverage(large_windows[w]);
+    }
+
+    unsigned long start = micros();
+    for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+      filter->add(i * 31);
+      filter->readAverage(large_windows[w]);
+      filter->readWeightedAverage(large_windows[w]);
+    }
+    unsigned long elapsed = micros() - start;
+
+    Serial.print("Window:");
+    Serial.print(large_windows[w]);
+    Serial.print("\t");
+    printResult("SMA+WMA", elapsed, BENCHMARK_SAMPLES);
+    delete filter;
+  }
+}
+
+/**
+ * @brief Compares the / operator with a precomputed reciprocal for a runtime divisor.
+ */
+void benchmarkDivision() {
+  volatile uint32_t divisor = BENCHMARK_WINDOW * (BENCHMARK_WINDOW + 1) / 2;  // Hide the divisor from the optimiser
+  uint32_t checksum = 0;
+
+  unsigned long start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    checksum += uint32_t(i * 2654435761UL) / divisor;
+  }
+  printResult("Divide", micros() - start, BENCHMARK_SAMPLES);
+
+  Reciprocal reciprocal(divisor);
+  start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    checksum -= reciprocal.divide(uint32_t(i * 2654435761UL));
+  }
+  printResult("Reciprocal", micros() - start, BENCHMARK_SAMPLES);
+
+  if (checksum != 0)
+    Serial.print("Reciprocal mismatch\n");
+}
+
+/**
+ * @brief Compares sliding the median of a small window through a SkipList with the sorting network
+ * kernels.
+ *
+ * The SkipList is filled once and then slides with one insertion and one removal per output, the
+ * work of readMovingMedian() on a full window without the networks.
+ */
+void benchmarkMedian() {
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    series[i] = random(-1000, 1000);
+  }
+  const uint16_t positions = BENCHMARK_SAMPLES - BENCHMARK_MEDIAN + 1;
+
+  SkipList<int16_t>* skiplist = SkipList<int16_t>::forWindow(BENCHMARK_MEDIAN);
+  for (uint8_t k = 0; k < BENCHMARK_MEDIAN - 1; k++) {
+    skiplist->insert(series[k]);
+  }
+  unsigned long start = micros();
+  for (uint16_t i = 0; i < positions; i++) {
+    skiplist->insert(series[i + BENCHMARK_MEDIAN - 1]);
+    medians[i] = skiplist->getMedian();
+    skiplist->remove(series[i]);
+  }
+  printResult("Median-SkipList", micros() - start, positions);
+  delete skiplist;
+
+  start = micros();
+  for (uint16_t i = 0; i < positions; i++) {
+    int16_t values[BENCHMARK_MEDIAN];
+    for (uint8_t k = 0; k < BENCHMARK_MEDIAN; k++) {
+      values[k] = series[i + k];
+    }
+    medians[i] = MedianNetwork<BENCHMARK_MEDIAN>::median(values);
+  }
+  printResult("Median-Network", micros() - start, positions);
+
+  start = micros();
+  MedianNetwork<BENCHMARK_MEDIAN>::medianSeries(series, medians, BENCHMARK_SAMPLES);
+  printResult("Median-Batch", micros() - start, positions);
+}
+
+/**
+ * @brief Slides a large window through an order statistic index.
+ *
+ * Every step replaces the oldest value and reads the median and the 90th percentile, the work of
+ * readMovingMedian() and readPercentile() on a full window.
+ *
+ * @param name The name of the benchmark.
+ */
+template<typename I>
+void benchmarkOrderIndex(const char* name) {
+  I* index = I::forWindow(BENCHMARK_ORDER_WINDOW);
+  for (uint16_t i = 0; i < BENCHMARK_ORDER_WINDOW; i++) {
+    order_window[i] = random(-1000, 1000);
+    index->insert(order_window[i]);
+  }
+
+  unsigned long start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    uint16_t oldest = i % BENCHMARK_ORDER_WINDOW;
+    index->remove(order_window[oldest]);
+    order_window[oldest] = random(-1000, 1000);
+    index->insert(order_window[oldest]);
+    medians[i] = index->getMedian();
+    index->at(BENCHMARK_ORDER_WINDOW * 9 / 10, medians[i]);
+  }
+  printResult(name, micros() - start, BENCHMARK_SAMPLES);
+  delete index;
+}
+
+/**
+ * @brief Compares loading a burst of data points one by one with prime().
+ *
+ * Both filters end with the same window of BENCHMARK_BURST data points and read its average and
+ * median.
+ */
+void benchmarkPrime() {
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    series[i] = random(-1000, 1000);
+  }
+
+  unsigned long start = micros();
+  {
+    MovingAverage<> filter;
+    filter.begin();
+    for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+      filter.add(series[i]);
+      filter.readAverage(BENCHMARK_BURST);
+    }
+    medians[0] = filter.readMovingMedian(BENCHMARK_BURST);
+  }
+  printResult("Burst-Add", micros() - start, BENCHMARK_SAMPLES);
+
+  start = micros();
+  {
+    MovingAverage<> filter;
+    filter.begin();
+    filter.reconfigure(BENCHMARK_BURST);
+    filter.prime(series, BENCHMARK_SAMPLES);
+    filter.readAverage(BENCHMARK_BURST);
+    medians[1] = filter.readMovingMedian(BENCHMARK_BURST);
+  }
+  printResult("Burst-Prime", micros() - start, BENCHMARK_SAMPLES);
+}
+
+/**
+ * @brief Compares feeding interleaved ADC scans one data point at a time with DmaIngestion.
+ *
+ * Fills each half of the DMA buffer in turn, as the DMA would, and calls the matching callback.
+ * Prints the time per data point of both and the ticks per callback measured by DmaIngestion.
+ */
+void benchmarkDma() {
+  const uint16_t halves = 2 * BENCHMARK_SAMPLES / BENCHMARK_DMA_SCANS;
+  const unsigned long points = (unsigned long)halves * BENCHMARK_DMA_SCANS * BENCHMARK_DMA_CHANNELS;
+  int16_t* buffer = dma.buffer();
+  for (uint16_t i = 0; i < dma.LENGTH; i++) {
+    buffer[i] = random(0, 1024);
+  }
+
+  unsigned long start = micros();
+  for (uint16_t half = 0; half < halves; half++) {
+    const int16_t* scans = buffer + (half % 2) * BENCHMARK_DMA_SCANS * BENCHMARK_DMA_CHANNELS;
+    for (uint16_t i = 0; i < BENCHMARK_DMA_SCANS; i++) {
+      for (uint8_t channel = 0; channel < BENCHMARK_DMA_CHANNELS; channel++) {
+        scan_filters[channel].add(scans[i * BENCHMARK_DMA_CHANNELS + channel]);
+        scan_filters[channel].readAverage(BENCHMARK_WINDOW);
+        scan_filters[channel].readWeightedAverage(BENCHMARK_WINDOW);
+      }
+    }
+  }
+  printResult("DMA-PerSample", micros() - start, points);
+
+  start = micros();
+  for (uint16_t half = 0; half < halves; half++) {
+    if (half % 2 == 0)
+      dma.onHalfComplete();
+    else
+      dma.onComplete();
+  }
+  for (uint8_t channel = 0; channel < BENCHMARK_DMA_CHANNELS; channel++) {
+    medians[channel] = dma_filters[channel].readAverage(BENCHMARK_WINDOW);
+    medians[channel] += dma_filters[channel].readWeightedAverage(BENCHMARK_WINDOW);
+  }
+  printResult("DMA-Batch", micros() - start, points);
+
+  Serial.print("DMA-Callback-Ticks:\t");
+  dma.readBudget().print();
+}
+
+/**
+ * @brief Compares the running least-squares slope with recomputing the regression per window.
+ */
+void benchmarkSlope() {
+  unsigned long start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    slope_filter.add(series[i]);
+    slopes[0] = slope_filter.readSlope(BENCHMARK_SLOPE);
+  }
+  printResult("Slope-Running", micros() - start, BENCHMARK_SAMPLES);
+
+  start = micros();
+  uint8_t head = 0;
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    slope_window[head] = series[i];
+    head = (head + 1) % BENCHMARK_SLOPE;
+    int32_t sum = 0;
+    int32_t weighted_sum = 0;
+    for (uint8_t k = 0; k < BENCHMARK_SLOPE; k++) {
+      int16_t value = slope_window[(head + k) % BENCHMARK_SLOPE];
+      sum += value;
+      weighted_sum += int32_t(value) * (k + 1);
+    }
+    const float n = BENCHMARK_SLOPE;
+    slopes[1] = 6.0f * (2.0f * weighted_sum - (n + 1) * sum) / (n * (n * n - 1));
+  }
+  printResult("Slope-Recompute", micros() - start, BENCHMARK_SAMPLES);
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  for (uint16_t i = 0; i < BENCHMARK_FILTERS; i++) {
+    filters[i].begin();  // Initialize every filter of the bank
+  }
+  for (uint8_t channel = 0; channel < BENCHMARK_DMA_CHANNELS; channel++) {
+    scan_filters[channel].begin();
+    dma_filters[channel].begin();
+    dma_filters[channel].reconfigure(BENCHMARK_WINDOW);
+  }
+  slope_filter.begin();
+  ram_fir.begin();
+  flash_fir.begin();
+
+  Serial.print("Filters:");
+  Serial.print(BENCHMARK_FILTERS);
+  Serial.print("\tsizeof:");
+  Serial.print(sizeof(MovingAverage<>));
+  Serial.print("\tbytes/channel:");
+  Serial.print(sizeof(MovingAverage<>) + BENCHMARK_WINDOW * sizeof(int16_t));
+  Serial.print("\n");
+}
+
+void loop() {
+  benchmarkBank();
+  benchmarkLargeWindows();
+  benchmarkFir("FIR-RAM", ram_fir);
+  benchmarkFir("FIR-PROGMEM", flash_fir);
+  benchmarkDivision();
+  benchmarkMedian();
+  benchmarkPrime();
+  benchmarkDma();
+  benchmarkSlope();
+  benchmarkOrderIndex<SkipList<int16_t>>("Order-SkipList");
+  benchmarkOrderIndex<BlockedOrderStatistic<int16_t>>("Order-Blocked");
+  delay(1000);  // Wait 1s between every run
+}
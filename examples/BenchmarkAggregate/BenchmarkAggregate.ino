@@ -0,0 +1,70 @@
+/**
+ * @brief Measures the cost of the sliding aggregator.
+ *
+ * Compares the sliding maximum of a SlidingAggregator with rescanning the window, both read after
+ * every data point of a random series. Every benchmark prints one line with its name and the
+ * measured time per data point.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <SlidingAggregator.h>
+
+#define BENCHMARK_SAMPLES 256
+#define BENCHMARK_AGGREGATE 64
+
+SlidingAggregator<MaxMonoid<int16_t>, BENCHMARK_AGGREGATE> max_aggregator;
+int16_t series[BENCHMARK_SAMPLES];
+int16_t maxima[2];  // Output of the benchmarks, global so it is not optimised away
+
+/**
+ * @brief Prints the result of a benchmark.
+ *
+ * @param name The name of the benchmark.
+ * @param elapsed The elapsed time in microseconds.
+ * @param operations The number of operations timed.
+ */
+void printResult(const char* name, unsigned long elapsed, unsigned long operations) {
+  Serial.print(name);
+  Serial.print(":\tns/op:");
+  Serial.print((unsigned long)(elapsed * 1000.0 / operations));
+  Serial.print("\n");
+}
+
+/**
+ * @brief Compares the sliding maximum of the aggregator to rescanning the window.
+ */
+void benchmarkAggregate() {
+  unsigned long start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    max_aggregator.add(series[i]);
+    maxima[0] = max_aggregator.read();
+  }
+  printResult("Max-Sliding", micros() - start, BENCHMARK_SAMPLES);
+
+  start = micros();
+  for (uint16_t i = BENCHMARK_AGGREGATE; i <= BENCHMARK_SAMPLES; i++) {
+    int16_t maximum = series[i - BENCHMARK_AGGREGATE];
+    for (uint16_t k = i - BENCHMARK_AGGREGATE + 1; k < i; k++) {
+      maximum = series[k] > maximum ? series[k] : maximum;
+    }
+    maxima[1] = maximum;
+  }
+  printResult("Max-Rescan", micros() - start, BENCHMARK_SAMPLES - BENCHMARK_AGGREGATE + 1);
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  randomSeed(42);
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    series[i] = random(-1000, 1000);
+  }
+  max_aggregator.begin();
+}
+
+void loop() {
+  benchmarkAggregate();
+  delay(1000);  // Wait 1s between every run
+}
@@ -0,0 +1,74 @@
+/**
+ * @brief Measures the cost of the compressed history.
+ *
+ * Times appending a random series to a CompressedHistory, including the compression of every full
+ * block, and reading the average of all of it from the summaries. Every benchmark prints one line
+ * with its name and the measured time per operation. The block and the store default to what fits
+ * into the RAM of the board, pass e.g. -DBENCHMARK_ARCHIVE_BLOCK=128 -DBENCHMARK_ARCHIVE_BYTES=4096
+ * to change them.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <CompressedHistory.h>
+
+#define BENCHMARK_SAMPLES 256
+
+#ifndef BENCHMARK_ARCHIVE_BLOCK
+#if defined(__AVR__)
+#define BENCHMARK_ARCHIVE_BLOCK 64
+#define BENCHMARK_ARCHIVE_BYTES 256
+#else
+#define BENCHMARK_ARCHIVE_BLOCK 256
+#define BENCHMARK_ARCHIVE_BYTES 16384
+#endif
+#endif
+
+CompressedHistory<int16_t, BENCHMARK_ARCHIVE_BLOCK> archive(BENCHMARK_ARCHIVE_BYTES, 64);
+int16_t series[BENCHMARK_SAMPLES];
+int16_t archive_average;  // Output of the benchmarks, global so it is not optimised away
+
+/**
+ * @brief Prints the result of a benchmark.
+ *
+ * @param name The name of the benchmark.
+ * @param elapsed The elapsed time in microseconds.
+ * @param operations The number of operations timed.
+ */
+void printResult(const char* name, unsigned long elapsed, unsigned long operations) {
+  Serial.print(name);
+  Serial.print(":\tns/op:");
+  Serial.print((unsigned long)(elapsed * 1000.0 / operations));
+  Serial.print("\n");
+}
+
+/**
+ * @brief Measures appending to the compressed history and reading the average of all of it.
+ */
+void benchmarkArchive() {
+  unsigned long start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    archive.add(series[i]);
+  }
+  printResult("Archive-Append", micros() - start, BENCHMARK_SAMPLES);
+
+  start = micros();
+  archive_average = archive.readAverage(archive.size());
+  printResult("Archive-Average", micros() - start, 1);
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  randomSeed(42);
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    series[i] = random(-1000, 1000);
+  }
+  archive.begin();
+}
+
+void loop() {
+  benchmarkArchive();
+  delay(1000);  // Wait 1s between every run
+}
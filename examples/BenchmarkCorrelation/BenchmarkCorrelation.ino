@@ -0,0 +1,73 @@
+/**
+ * @brief Measures the cost of the rolling correlation.
+ *
+ * Compares adding pairs one by one and reading the correlation after each, adding them as one
+ * block, and the static kernel over the whole series. The pairs are a random series and the
+ * series one data point later, i.e. its lag-1 autocorrelation. Every benchmark prints one line with
+ * its name and the measured time per pair.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <CorrelationFilter.h>
+
+#define BENCHMARK_SAMPLES 256
+#define BENCHMARK_CORRELATION 32
+
+CorrelationFilter<int16_t, BENCHMARK_CORRELATION> correlation_filter;
+CorrelationFilter<int16_t, BENCHMARK_CORRELATION> batch_correlation_filter;
+int16_t series[BENCHMARK_SAMPLES];
+float correlations[3];  // Output of the benchmarks, global so it is not optimised away
+
+/**
+ * @brief Prints the result of a benchmark.
+ *
+ * @param name The name of the benchmark.
+ * @param elapsed The elapsed time in microseconds.
+ * @param operations The number of operations timed.
+ */
+void printResult(const char* name, unsigned long elapsed, unsigned long operations) {
+  Serial.print(name);
+  Serial.print(":\tns/op:");
+  Serial.print((unsigned long)(elapsed * 1000.0 / operations));
+  Serial.print("\n");
+}
+
+/**
+ * @brief Compares the rolling correlation per pair and per block to the offline kernel.
+ */
+void benchmarkCorrelation() {
+  const uint16_t pairs = BENCHMARK_SAMPLES - 1;
+  unsigned long start = micros();
+  for (uint16_t i = 0; i < pairs; i++) {
+    correlation_filter.add(series[i], series[i + 1]);
+    correlations[0] = correlation_filter.readCorrelation();
+  }
+  printResult("Corr-Running", micros() - start, pairs);
+
+  start = micros();
+  batch_correlation_filter.addBatch(series, series + 1, pairs);
+  correlations[1] = batch_correlation_filter.readCorrelation();
+  printResult("Corr-Batch", micros() - start, pairs);
+
+  start = micros();
+  correlations[2] = CorrelationFilter<int16_t>::correlation(series, series + 1, pairs);
+  printResult("Corr-Offline", micros() - start, pairs);
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  randomSeed(42);
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    series[i] = random(-1000, 1000);
+  }
+  correlation_filter.begin();
+  batch_correlation_filter.begin();
+}
+
+void loop() {
+  benchmarkCorrelation();
+  delay(1000);  // Wait 1s between every run
+}
@@ -0,0 +1,72 @@
+/**
+ * @brief Measures the cost of the exponential moving averages.
+ *
+ * Compares the EMA of the MovingAverage engine, set by a raw smoothing factor, to the
+ * ExponentialFilter set by a time constant, with and without timestamps. Every benchmark prints
+ * one line with its name and the measured time per operation.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <MovingAverage.h>
+#include <ExponentialFilter.h>
+
+#define BENCHMARK_SAMPLES 256
+
+MovingAverage<> ema_filter;
+ExponentialFilter<> time_constant_filter;
+int16_t average;  // Output of the benchmarks, global so it is not optimised away
+
+/**
+ * @brief Prints the result of a benchmark.
+ *
+ * @param name The name of the benchmark.
+ * @param elapsed The elapsed time in microseconds.
+ * @param operations The number of operations timed.
+ */
+void printResult(const char* name, unsigned long elapsed, unsigned long operations) {
+  Serial.print(name);
+  Serial.print(":\tns/op:");
+  Serial.print((unsigned long)(elapsed * 1000.0 / operations));
+  Serial.print("\n");
+}
+
+/**
+ * @brief Compares the EMA with a raw smoothing factor to the time constant EMA.
+ */
+void benchmarkEma() {
+  unsigned long start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    ema_filter.add(i * 31);
+    average = ema_filter.readExponentialAverage(0.1f);
+  }
+  printResult("EMA-Alpha", micros() - start, BENCHMARK_SAMPLES);
+
+  start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    time_constant_filter.add(i * 31);
+    average = time_constant_filter.read();
+  }
+  printResult("EMA-TimeConstant", micros() - start, BENCHMARK_SAMPLES);
+
+  start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    time_constant_filter.add(i * 31, i * 1000UL + (i & 7) * 50);  // 1 ms period with jitter
+    average = time_constant_filter.read();
+  }
+  printResult("EMA-Timestamp", micros() - start, BENCHMARK_SAMPLES);
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  ema_filter.begin();
+  time_constant_filter.begin();
+  time_constant_filter.setTimeConstant(0.01f, 0.001f);  // tau = 10 ms at 1 kHz
+}
+
+void loop() {
+  benchmarkEma();
+  delay(1000);  // Wait 1s between every run
+}
@@ -0,0 +1,86 @@
+/**
+ * @brief Measures the cost of the shared window history.
+ *
+ * Compares reading the averages of four windows of one stream from one WindowHistory with keeping
+ * one MovingAverage per window, both after every data point of a random series. Every benchmark
+ * prints one line with its name and the measured time per data point. The history defaults to
+ * what fits into the RAM of the board, pass e.g. -DBENCHMARK_HISTORY=4096 for a larger one.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <MovingAverage.h>
+#include <WindowHistory.h>
+
+#define BENCHMARK_SAMPLES 256
+
+#ifndef BENCHMARK_HISTORY
+#if defined(__AVR__)
+#define BENCHMARK_HISTORY 64
+#else
+#define BENCHMARK_HISTORY 1024
+#endif
+#endif
+
+// Four windows of one stream, from one shared history or from one filter each
+const uint16_t history_windows[] = { BENCHMARK_HISTORY / 8, BENCHMARK_HISTORY / 4, BENCHMARK_HISTORY / 2, BENCHMARK_HISTORY };
+WindowHistory<int16_t, BENCHMARK_HISTORY> history;
+MovingAverage<int16_t, int16_t, uint16_t> window_filters[4];
+int16_t series[BENCHMARK_SAMPLES];
+int16_t window_averages[4];  // Output of the benchmarks, global so it is not optimised away
+
+/**
+ * @brief Prints the result of a benchmark.
+ *
+ * @param name The name of the benchmark.
+ * @param elapsed The elapsed time in microseconds.
+ * @param operations The number of operations timed.
+ */
+void printResult(const char* name, unsigned long elapsed, unsigned long operations) {
+  Serial.print(name);
+  Serial.print(":\tns/op:");
+  Serial.print((unsigned long)(elapsed * 1000.0 / operations));
+  Serial.print("\n");
+}
+
+/**
+ * @brief Compares four averages of one shared history to four separate filters.
+ */
+void benchmarkHistory() {
+  unsigned long start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    history.add(series[i]);
+    for (uint8_t w = 0; w < 4; w++) {
+      window_averages[w] = history.readAverage(history_windows[w]);
+    }
+  }
+  printResult("History-Shared", micros() - start, BENCHMARK_SAMPLES);
+
+  start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    for (uint8_t w = 0; w < 4; w++) {
+      window_filters[w].add(series[i]);
+      window_averages[w] = window_filters[w].readAverage(history_windows[w]);
+    }
+  }
+  printResult("History-Separate", micros() - start, BENCHMARK_SAMPLES);
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  randomSeed(42);
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    series[i] = random(-1000, 1000);
+  }
+  history.begin();
+  for (uint8_t w = 0; w < 4; w++) {
+    window_filters[w].begin();
+  }
+}
+
+void loop() {
+  benchmarkHistory();
+  delay(1000);  // Wait 1s between every run
+}
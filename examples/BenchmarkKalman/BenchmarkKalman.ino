@@ -0,0 +1,66 @@
+/**
+ * @brief Measures the cost of the Kalman filters.
+ *
+ * Both filters start at their steady-state gains, where an update costs one multiply-add per
+ * state. Every benchmark prints one line with its name and the measured time per operation.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <KalmanFilter.h>
+
+#define BENCHMARK_SAMPLES 256
+
+KalmanFilter<> kalman_filter;
+KalmanVelocityFilter<> kalman_velocity_filter;
+int16_t estimate;  // Output of the benchmarks, global so it is not optimised away
+
+/**
+ * @brief Prints the result of a benchmark.
+ *
+ * @param name The name of the benchmark.
+ * @param elapsed The elapsed time in microseconds.
+ * @param operations The number of operations timed.
+ */
+void printResult(const char* name, unsigned long elapsed, unsigned long operations) {
+  Serial.print(name);
+  Serial.print(":\tns/op:");
+  Serial.print((unsigned long)(elapsed * 1000.0 / operations));
+  Serial.print("\n");
+}
+
+/**
+ * @brief Times the Kalman filters, which have reached their steady-state gains after setup().
+ */
+void benchmarkKalman() {
+  unsigned long start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    kalman_filter.add(i * 31);
+    estimate = kalman_filter.read();
+  }
+  printResult("Kalman", micros() - start, BENCHMARK_SAMPLES);
+
+  start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    kalman_velocity_filter.add(i * 31);
+    estimate = kalman_velocity_filter.read();
+  }
+  printResult("Kalman-Velocity", micros() - start, BENCHMARK_SAMPLES);
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  kalman_filter.begin();
+  kalman_filter.setNoise(1, 100);
+  kalman_filter.useSteadyState();
+  kalman_velocity_filter.begin();
+  kalman_velocity_filter.setNoise(0.1f, 100);
+  kalman_velocity_filter.useSteadyState();
+}
+
+void loop() {
+  benchmarkKalman();
+  delay(1000);  // Wait 1s between every run
+}
@@ -0,0 +1,107 @@
+/**
+ * @brief Measures the cost of the lock-free queues.
+ *
+ * The queues are timed single-threaded, so the numbers are the cost of the queue operations
+ * themselves: push and pop with both counter backends, a batch push drained into a filter in place,
+ * and the latency of a single push and pop. Every benchmark prints one line with its name and the
+ * measured time per operation.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <MovingAverage.h>
+#include <BoundedQueue.h>
+#include <LatencyHistogram.h>
+
+#define BENCHMARK_WINDOW 8
+#define BENCHMARK_SAMPLES 256
+#define BENCHMARK_QUEUE 64
+
+// Histogram of the queue latencies, smaller on AVR
+#if defined(__AVR__)
+typedef LatencyHistogram<2, 16, uint16_t> BenchmarkHistogram;
+#else
+typedef LatencyHistogram<> BenchmarkHistogram;
+#endif
+
+// Queues between a producer and a filter, with the default and the volatile counter backend
+SpscQueue<int16_t, BENCHMARK_QUEUE> spsc_queue;
+SpscQueue<int16_t, BENCHMARK_QUEUE, VolatileCounter<uint8_t>> volatile_queue;
+MpscQueue<int16_t, BENCHMARK_QUEUE> mpsc_queue;
+MovingAverage<> queue_filter;
+BenchmarkHistogram queue_latency;
+
+int16_t series[BENCHMARK_QUEUE];  // Batch pushed into the queue
+int16_t item;                     // Output of the benchmarks, global so it is not optimised away
+
+/**
+ * @brief Prints the result of a benchmark.
+ *
+ * @param name The name of the benchmark.
+ * @param elapsed The elapsed time in microseconds.
+ * @param operations The number of operations timed.
+ */
+void printResult(const char* name, unsigned long elapsed, unsigned long operations) {
+  Serial.print(name);
+  Serial.print(":\tns/op:");
+  Serial.print((unsigned long)(elapsed * 1000.0 / operations));
+  Serial.print("\n");
+}
+
+/**
+ * @brief Moves data points through a queue one at a time.
+ *
+ * @param name The name of the benchmark.
+ * @param queue The queue under test.
+ */
+template<typename Q>
+void benchmarkQueue(const char* name, Q& queue) {
+  unsigned long start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    queue.push(int16_t(i));
+    queue.pop(item);
+  }
+  printResult(name, micros() - start, BENCHMARK_SAMPLES);
+}
+
+/**
+ * @brief Times the queues one item and a batch at a time, and the latency of a push and pop.
+ */
+void benchmarkQueues() {
+  benchmarkQueue("Queue-SPSC", spsc_queue);
+  benchmarkQueue("Queue-SPSC-Volatile", volatile_queue);
+  benchmarkQueue("Queue-MPSC", mpsc_queue);
+
+  unsigned long start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i += BENCHMARK_QUEUE) {
+    spsc_queue.pushBatch(series, BENCHMARK_QUEUE);
+    spsc_queue.drainInto(queue_filter);
+  }
+  item = queue_filter.readAverage(BENCHMARK_WINDOW);
+  printResult("Queue-SPSC-Batch", micros() - start, BENCHMARK_SAMPLES);
+
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    LatencyProbe<BenchmarkHistogram> probe(queue_latency);
+    spsc_queue.push(int16_t(i));
+    spsc_queue.pop(item);
+  }
+  Serial.print("Queue-Latency-Ticks:\t");
+  queue_latency.print();
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  randomSeed(42);
+  for (uint16_t i = 0; i < BENCHMARK_QUEUE; i++) {
+    series[i] = random(-1000, 1000);
+  }
+  queue_filter.begin();
+  queue_filter.reconfigure(BENCHMARK_WINDOW);
+}
+
+void loop() {
+  benchmarkQueues();
+  delay(1000);  // Wait 1s between every run
+}
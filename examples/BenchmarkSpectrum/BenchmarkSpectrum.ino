@@ -0,0 +1,72 @@
+/**
+ * @brief Measures the cost of the sliding DFT bins.
+ *
+ * Compares two bins that follow the ring of a filter with the Goertzel algorithm over the window,
+ * both read after every data point of a random series. Every benchmark prints one line with its
+ * name and the measured time per data point.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <MovingAverage.h>
+
+#define BENCHMARK_SAMPLES 256
+#define BENCHMARK_SPECTRUM 64
+
+const uint32_t spectrum_bins[] = { 5, 10 };
+MovingAverage<> spectrum_filter;
+SlidingDft<int16_t> spectrum(spectrum_bins, 2);
+int16_t series[BENCHMARK_SAMPLES];
+float magnitudes[2];  // Output of the benchmarks, global so it is not optimised away
+
+/**
+ * @brief Prints the result of a benchmark.
+ *
+ * @param name The name of the benchmark.
+ * @param elapsed The elapsed time in microseconds.
+ * @param operations The number of operations timed.
+ */
+void printResult(const char* name, unsigned long elapsed, unsigned long operations) {
+  Serial.print(name);
+  Serial.print(":\tns/op:");
+  Serial.print((unsigned long)(elapsed * 1000.0 / operations));
+  Serial.print("\n");
+}
+
+/**
+ * @brief Compares sliding DFT bins on the ring to the Goertzel algorithm over the window.
+ */
+void benchmarkSpectrum() {
+  unsigned long start = micros();
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    spectrum_filter.add(series[i]);
+    spectrum_filter.readAverage(BENCHMARK_SPECTRUM);
+    magnitudes[0] = spectrum.readMagnitude(0) + spectrum.readMagnitude(1);
+  }
+  printResult("DFT-Sliding", micros() - start, BENCHMARK_SAMPLES);
+
+  start = micros();
+  for (uint16_t i = BENCHMARK_SPECTRUM; i <= BENCHMARK_SAMPLES; i++) {
+    const int16_t* window = series + i - BENCHMARK_SPECTRUM;
+    magnitudes[1] = SlidingDft<int16_t>::goertzel(window, BENCHMARK_SPECTRUM, spectrum_bins[0]) +
+                    SlidingDft<int16_t>::goertzel(window, BENCHMARK_SPECTRUM, spectrum_bins[1]);
+  }
+  printResult("DFT-Goertzel", micros() - start, BENCHMARK_SAMPLES - BENCHMARK_SPECTRUM + 1);
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  randomSeed(42);
+  for (uint16_t i = 0; i < BENCHMARK_SAMPLES; i++) {
+    series[i] = random(-1000, 1000);
+  }
+  spectrum_filter.begin();
+  spectrum_filter.attach(&spectrum);
+}
+
+void loop() {
+  benchmarkSpectrum();
+  delay(1000);  // Wait 1s between every run
+}
@@ -0,0 +1,67 @@
+/**
+ * @brief Compares the moving average filters against slow reference implementations.
+ *
+ * Random trials with random window sizes, smoothing factors and sample streams are run through
+ * the MovingAverage engine and a naive reference filter, one data point at a time, in blocks
+ * through addBatch() and DmaIngestion, and with resets, window changes and primed bursts in
+ * between. Every disagreement is printed, together with a running count of trials and failures.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include "DifferentialTrial.h"
+
+uint8_t trial[DIFFERENTIAL_HEADER + 2 * DIFFERENTIAL_SAMPLES];  // Header bytes followed by the samples
+uint32_t trials = 0;
+uint32_t failures = 0;
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  randomSeed(42);      // Make the trials reproducible
+}
+
+void loop() {
+  size_t size = random(DIFFERENTIAL_HEADER, sizeof(trial) + 1);  // Random number of samples
+  for (size_t i = 0; i < size; i++) {
+    trial[i] = random(0, 256);
+  }
+
+  // Run the same trial for integer and floating point filters
+  if (!runDifferentialTrial<int16_t, int16_t>(trial, size))
+    failures++;
+  if (!runDifferentialTrial<int32_t, int32_t>(trial, size))
+    failures++;
+  if (!runDifferentialTrial<float, float>(trial, size))
+    failures++;
+  if (!runDifferentialTrial<int16_t, int16_t, uint16_t>(trial, size))
+    failures++;  // Windows of more than 255 samples with wide window sums
+  if (!runDifferentialTrial<int16_t, int16_t, uint16_t, BlockedOrderStatistic<int16_t, 8, int64_t>>(trial, size))
+    failures++;  // Small blocks, so windows of a few dozen samples already split and merge
+
+  // Run the same trial through addBatch() and DmaIngestion
+  if (!runBatchTrial<int16_t, int16_t>(trial, size))
+    failures++;
+  if (!runBatchTrial<float, float>(trial, size))
+    failures++;
+  if (!runBatchTrial<int16_t, int16_t, uint16_t, BlockedOrderStatistic<int16_t, 8, int64_t>>(trial, size))
+    failures++;
+
+  // Run the same trial with resets, window changes and primed bursts in between
+  if (!runLifecycleTrial<int16_t, int16_t>(trial, size))
+    failures++;
+  if (!runLifecycleTrial<float, float>(trial, size))
+    failures++;
+  if (!runLifecycleTrial<int16_t, int16_t, uint16_t, BlockedOrderStatistic<int16_t, 8, int64_t>>(trial, size))
+    failures++;
+  trials++;
+
+  if (trials % 100 == 0) {
+    Serial.print("Trials:");
+    Serial.print(trials);
+    Serial.print("\tFailures:");
+    Serial.print(failures);
+    Serial.print("\n");
+  }
+}
@@ -0,0 +1,492 @@
+/**
+ * @file DifferentialTrial.h
+ *
+ * @brief Drives a byte-encoded sample stream through MovingAverage and ReferenceFilter.
+ *
+ * A trial decodes its window size, smoothing factor, peak parameters and samples from a plain byte
+ * buffer, feeds the samples into both the optimised MovingAverage engine and the ReferenceFilter,
+ * and compares every output after every sample. The byte interface makes the same trial usable
+ * with random buffers on a board and with libFuzzer on a host: compiling this header with
+ * MOVINGAVERAGE_FUZZER defined (and a host build of the Arduino core) provides the
+ * `LLVMFuzzerTestOneInput` entry point.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef DIFFERENTIALTRIAL_H
+#define DIFFERENTIALTRIAL_H
+
+#include <MovingAverage.h>
+#include <DmaIngestion.h>
+#include "ReferenceFilters.h"
+
+#ifndef DIFFERENTIAL_MAX_WINDOW
+#if defined(__AVR__)
+#define DIFFERENTIAL_MAX_WINDOW 64
+#define DIFFERENTIAL_SAMPLES 150
+#else
+#define DIFFERENTIAL_MAX_WINDOW 1023
+#define DIFFERENTIAL_SAMPLES 1200
+#endif
+#endif
+
+#define DIFFERENTIAL_HEADER 6
+#define DIFFERENTIAL_SCANS 16    // Scans per half of the DMA buffer
+#define DIFFERENTIAL_CHANNELS 3  // Interleaved channels of the batch and DMA paths
+
+/**
+ * @brief Compares an engine output with its reference.
+ *
+ * Integral outputs and selections (median, min, max) must match exactly. Sums of floating point
+ * outputs may differ by rounding, as the engine and the reference add in a different order.
+ *
+ * @param expected The reference output.
+ * @param actual The engine output.
+ * @param exact Whether the output must match exactly, even for floating point types.
+ * @return True if the outputs agree, false otherwise.
+ */
+template<typename U>
+bool outputsAgree(U expected, U actual, bool exact) {
+  if (exact || U(0.5) == U(0))
+    return expected == actual;
+
+  U difference = expected > actual ? expected - actual : actual - expected;
+  U magnitude = expected < 0 ? -expected : expected;
+  return difference <= U(1e-3) * (1 + magnitude);
+}
+
+/**
+ * @brief Prints a mismatch between the engine and the reference.
+ *
+ * @param path The way the samples reached the engine, e.g. "Add" or "Batch".
+ * @param output The name of the output.
+ */
+template<typename U>
+void printMismatch(const char* path, const char* output, uint16_t sample, uint16_t window_size, U expected, U actual) {
+  Serial.print("Mismatch:");
+  Serial.print(path);
+  Serial.print("/");
+  Serial.print(output);
+  Serial.print("\tsample:");
+  Serial.print(sample);
+  Serial.print("\twindow:");
+  Serial.print(window_size);
+  Serial.print("\texpected:");
+  Serial.print(expected);
+  Serial.print("\tactual:");
+  Serial.print(actual);
+  Serial.print("\n");
+}
+
+/**
+ * @brief Decodes the window size of a trial.
+ *
+ * @tparam W The window size type of the engine.
+ * @param data The encoded trial, bytes 0 and 5 hold the window size.
+ * @return The window size, in the interval [1; DIFFERENTIAL_MAX_WINDOW].
+ */
+template<typename W>
+uint16_t decodeWindowSize(const uint8_t* data) {
+  uint16_t window_size = (data[0] | data[5] << 8) % (DIFFERENTIAL_MAX_WINDOW + 1);
+  window_size = window_size > W(~W(0)) ? data[0] : window_size;
+  return window_size ? window_size : 1;
+}
+
+/**
+ * @brief Compares the windowed outputs and the cumulative average of an engine with the reference.
+ *
+ * The windowed averages must also lie within the range of the window. The EMA and the peak
+ * detection are left out, as their reads advance them.
+ *
+ * @param path The way the samples reached the engine, printed with a mismatch.
+ * @param filter The engine.
+ * @param reference The reference fed with the same samples.
+ * @param window_size The window size of both.
+ * @param smoothing_factor Halved as trim fraction, times 100 as percentile.
+ * @param sample The number of the newest sample.
+ * @return True if the engine agreed with the reference on every output, false otherwise.
+ */
+template<typename T, typename U, typename W, typename I>
+bool windowedOutputsAgree(const char* path, MovingAverage<T, U, W, I>& filter, const ReferenceFilter<T, U>& reference,
+                          uint16_t window_size, float smoothing_factor, uint16_t sample) {
+  U expected, actual;
+  U minimum = reference.readMinimum();
+  U maximum = reference.readMaximum();
+
+  expected = reference.readAverage();
+  actual = filter.readAverage(window_size);
+  if (!outputsAgree(expected, actual, false) || actual < minimum || actual > maximum) {
+    printMismatch(path, "SMA", sample, window_size, expected, actual);
+    return false;
+  }
+
+  expected = reference.readWeightedAverage();
+  actual = filter.readWeightedAverage(window_size);
+  if (!outputsAgree(expected, actual, false) || actual < minimum || actual > maximum) {
+    printMismatch(path, "WMA", sample, window_size, expected, actual);
+    return false;
+  }
+
+  expected = reference.readTrend();
+  actual = filter.readTrend(window_size);
+  if (!outputsAgree(expected, actual, false)) {
+    printMismatch(path, "Trend", sample, window_size, expected, actual);
+    return false;
+  }
+
+  float expected_slope = reference.readSlope();
+  float actual_slope = filter.readSlope(window_size);
+  if (!outputsAgree(expected_slope, actual_slope, false)) {
+    printMismatch(path, "Slope", sample, window_size, expected_slope, actual_slope);
+    return false;
+  }
+
+  expected = reference.readMovingMedian();
+  actual = filter.readMovingMedian(window_size);
+  if (!outputsAgree(expected, actual, true)) {
+    printMismatch(path, "MM", sample, window_size, expected, actual);
+    return false;
+  }
+
+  expected = reference.readHampel(3.0f);
+  actual = filter.readHampel(window_size, 3.0f);
+  if (!outputsAgree(expected, actual, true)) {
+    printMismatch(path, "HF", sample, window_size, expected, actual);
+    return false;
+  }
+
+  expected = reference.readTrimmedMean(smoothing_factor / 2);
+  actual = filter.readTrimmedMean(window_size, smoothing_factor / 2);
+  if (!outputsAgree(expected, actual, false) || actual < minimum || actual > maximum) {
+    printMismatch(path, "TM", sample, window_size, expected, actual);
+    return false;
+  }
+
+  expected = reference.readWinsorizedMean(smoothing_factor / 2);
+  actual = filter.readWinsorizedMean(window_size, smoothing_factor / 2);
+  if (!outputsAgree(expected, actual, false) || actual < minimum || actual > maximum) {
+    printMismatch(path, "WM", sample, window_size, expected, actual);
+    return false;
+  }
+
+  expected = reference.readPercentile(smoothing_factor * 100);
+  actual = filter.readPercentile(window_size, smoothing_factor * 100);
+  if (!outputsAgree(expected, actual, true)) {
+    printMismatch(path, "Pct", sample, window_size, expected, actual);
+    return false;
+  }
+
+  expected = reference.readCumulativeAverage();
+  actual = filter.readCumulativeAverage();
+  if (!outputsAgree(expected, actual, false)) {
+    printMismatch(path, "CA", sample, window_size, expected, actual);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Runs one differential trial.
+ *
+ * Layout of the buffer:
+ * - bytes 0 and 5: window size, low and high byte, modulo DIFFERENTIAL_MAX_WINDOW + 1. Engines with
+ *   a window size type too narrow for it use the low byte, 0 is treated as 1.
+ * - byte 1: low nibble right-shifts the samples to provoke duplicates, high nibble + 1 is the
+ *   number of consecutive matches for peak detection.
+ * - byte 2: smoothing factor in steps of 1/255, halved as trim fraction, times 100 as percentile.
+ * - bytes 3-4: peak threshold.
+ * - byte 5: see bytes 0 and 5.
+ * - remaining byte pairs: the samples.
+ *
+ * Besides the differential checks, the windowed averages and the median must lie within the
+ * range of the window. A second engine of the same type, fed with the negated samples and read
+ * with another window size in between, must not disturb the first one.
+ *
+ * @tparam T The data type for input values.
+ * @tparam U The data type for average values.
+ * @tparam W The window size type of the engine.
+ * @tparam I The order statistic index of the engine.
+ * @param data The encoded trial.
+ * @param size The number of bytes in the buffer.
+ * @return True if the engine agreed with the reference on every output, false otherwise.
+ */
+template<typename T, typename U, typename W = uint8_t, typename I = SkipList<U, typename WindowTraits<U, W>::Sum>>
+bool runDifferentialTrial(const uint8_t* data, size_t size) {
+  if (size < DIFFERENTIAL_HEADER)
+    return true;
+
+  uint16_t window_size = decodeWindowSize<W>(data);
+  uint8_t shift = data[1] & 0x0F;
+  uint8_t consecutive_matches = (data[1] >> 4) + 1;
+  float smoothing_factor = data[2] / 255.0f;
+  T threshold = T(int16_t(data[3] | data[4] << 8) >> shift);
+
+  MovingAverage<T, U, W, I> filter;
+  MovingAverage<T, U, W, I> neighbour;
+  ReferenceFilter<T, U> reference(window_size);
+  filter.begin();
+  neighbour.begin();
+
+  uint16_t sample = 0;
+  for (size_t i = DIFFERENTIAL_HEADER; i + 1 < size; i += 2, sample++) {
+    T input = T(int16_t(data[i] | data[i + 1] << 8) >> shift);
+    filter.add(input);
+    reference.add(input);
+    neighbour.add(-input);
+    neighbour.readAverage(window_size / 2 + 1);
+    neighbour.readMovingMedian(window_size / 2 + 1);
+    neighbour.readExponentialAverage(1 - smoothing_factor);
+    neighbour.detectedPeak(-threshold, consecutive_matches);
+
+    if (!windowedOutputsAgree("Add", filter, reference, window_size, smoothing_factor, sample))
+      return false;
+
+    U expected = reference.readExponentialAverage(smoothing_factor);
+    U actual = filter.readExponentialAverage(smoothing_factor);
+    if (!outputsAgree(expected, actual, true)) {
+      printMismatch("Add", "EMA", sample, window_size, expected, actual);
+      return false;
+    }
+
+    bool expected_peak = reference.detectedPeak(threshold, consecutive_matches);
+    bool actual_peak = filter.detectedPeak(threshold, consecutive_matches);
+    if (expected_peak != actual_peak) {
+      printMismatch("Add", "Peak", sample, window_size, int(expected_peak), int(actual_peak));
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief Runs one trial through the batch paths.
+ *
+ * Feeds the same samples to three engines: one data point at a time with add() and a windowed
+ * read, in blocks with addBatch() from an interleaved buffer, part of them while the engine is
+ * disabled, and through a DmaIngestion buffer as channel 0 of DIFFERENTIAL_CHANNELS. Each engine
+ * is compared with the reference after every data point, block and half buffer. The other
+ * channels hold the negated and the halved samples, so a wrong stride shows up as a mismatch.
+ *
+ * Layout of the buffer, as for runDifferentialTrial(), except:
+ * - byte 3: the blocks are 1 to byte 3 % 64 + 1 data points long, picked by the first sample.
+ * - byte 4: byte 4 % DIFFERENTIAL_CHANNELS + 1 is the stride of the interleaved buffer.
+ *
+ * @tparam T The data type for input values.
+ * @tparam U The data type for average values.
+ * @tparam W The window size type of the engines.
+ * @tparam I The order statistic index of the engines.
+ * @param data The encoded trial.
+ * @param size The number of bytes in the buffer.
+ * @return True if all engines agreed with the reference on every output, false otherwise.
+ */
+template<typename T, typename U, typename W = uint8_t, typename I = SkipList<U, typename WindowTraits<U, W>::Sum>>
+bool runBatchTrial(const uint8_t* data, size_t size) {
+  if (size < DIFFERENTIAL_HEADER + 2)
+    return true;
+
+  typedef MovingAverage<T, U, W, I> Filter;
+  uint16_t window_size = decodeWindowSize<W>(data);
+  uint8_t shift = data[1] & 0x0F;
+  float smoothing_factor = data[2] / 255.0f;
+  uint8_t longest_block = data[3] % 64 + 1;
+  uint8_t stride = data[4] % DIFFERENTIAL_CHANNELS + 1;
+
+  size_t count = (size - DIFFERENTIAL_HEADER) / 2;
+  T* samples = new T[count * stride];
+  for (size_t k = 0; k < count; k++) {
+    const uint8_t* bytes = data + DIFFERENTIAL_HEADER + 2 * k;
+    T input = T(int16_t(bytes[0] | bytes[1] << 8) >> shift);
+    for (uint8_t lane = 0; lane < stride; lane++) {
+      samples[k * stride + lane] = lane == 0 ? input : lane == 1 ? T(-input) : T(input / 2);
+    }
+  }
+
+  Filter single;
+  Filter batch;
+  Filter channels[DIFFERENTIAL_CHANNELS];
+  DmaIngestion<Filter, T, DIFFERENTIAL_SCANS, DIFFERENTIAL_CHANNELS> dma(channels);
+  ReferenceFilter<T, U> reference(window_size);
+  single.begin();
+  batch.begin();
+  batch.reconfigure(window_size);
+  for (uint8_t channel = 0; channel < DIFFERENTIAL_CHANNELS; channel++) {
+    channels[channel].begin();
+    channels[channel].reconfigure(window_size);
+  }
+
+  bool agreed = true;
+  size_t block_start = 0;
+  size_t block_end = 1 + data[DIFFERENTIAL_HEADER] % longest_block;
+  for (size_t k = 0; k < count && agreed; k++) {
+    T input = samples[k * stride];
+    reference.add(input);
+    single.add(input);
+    agreed = windowedOutputsAgree("Add", single, reference, window_size, smoothing_factor, k);
+
+    if (agreed && k + 1 >= block_end) {
+      // Blocks starting at odd data points arrive while the engine is disabled and still count
+      if (block_start % 2 != 0)
+        batch.end();
+      batch.addBatch(samples + block_start * stride, k + 1 - block_start, stride);
+      batch.begin();
+      agreed = windowedOutputsAgree("Batch", batch, reference, window_size, smoothing_factor, k);
+      block_start = k + 1;
+      block_end = block_start + 1 + (block_start < count ? data[DIFFERENTIAL_HEADER + 2 * block_start] % longest_block : 0);
+    }
+
+    if (agreed && (k + 1) % DIFFERENTIAL_SCANS == 0) {
+      uint8_t half = ((k + 1) / DIFFERENTIAL_SCANS - 1) % 2;
+      T* scans = dma.buffer() + half * DIFFERENTIAL_SCANS * DIFFERENTIAL_CHANNELS;
+      for (uint16_t scan = 0; scan < DIFFERENTIAL_SCANS; scan++) {
+        T value = samples[(k + 1 - DIFFERENTIAL_SCANS + scan) * stride];
+        scans[scan * DIFFERENTIAL_CHANNELS] = value;
+        scans[scan * DIFFERENTIAL_CHANNELS + 1] = T(-value);
+        scans[scan * DIFFERENTIAL_CHANNELS + 2] = T(value / 2);
+      }
+      if (half == 0)
+        dma.onHalfComplete();
+      else
+        dma.onComplete();
+      agreed = windowedOutputsAgree("DMA", channels[0], reference, window_size, smoothing_factor, k);
+    }
+  }
+
+  delete[] samples;
+  return agreed;
+}
+
+/**
+ * @brief Compares the windowed outputs, the cumulative average and the EMA with the reference.
+ *
+ * @param exact_ema Whether the EMA must match exactly, false after prime() for floating point types.
+ * @return True if the engine agreed with the reference on every output, false otherwise.
+ */
+template<typename T, typename U, typename W, typename I>
+bool lifecycleOutputsAgree(MovingAverage<T, U, W, I>& filter, ReferenceFilter<T, U>& reference, uint16_t window_size,
+                           float smoothing_factor, uint16_t sample, bool exact_ema) {
+  if (!windowedOutputsAgree("Lifecycle", filter, reference, window_size, smoothing_factor, sample))
+    return false;
+
+  U expected = reference.readExponentialAverage(smoothing_factor);
+  U actual = filter.readExponentialAverage(smoothing_factor);
+  if (!outputsAgree(expected, actual, exact_ema)) {
+    printMismatch("Lifecycle", "EMA", sample, window_size, expected, actual);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Runs one trial with resets, window changes and primed bursts in the middle of the stream.
+ *
+ * Every few samples the engine and the reference are cleared with reset(), given a new window
+ * size with reconfigure(), or loaded with the next burst of samples by prime(), and both are
+ * compared after every sample and burst, including the EMA. After prime() the EMA starts at the
+ * mean, which floating point types may round differently than the reference.
+ *
+ * Layout of the buffer, as for runDifferentialTrial(), except:
+ * - byte 3: an operation follows every byte 3 % 32 + 1 samples.
+ * - byte 4: if odd, the trial starts with reconfigure() and a burst of (byte 4 / 2) % 64 + 1
+ *   samples loaded by prime() before any read.
+ * - the sample that precedes an operation picks it: a reset if its low byte modulo 4 is 0, a burst
+ *   of high byte % 64 + 1 samples if it is 1, otherwise a new window size decoded from both of its
+ *   bytes like the first one.
+ *
+ * @tparam T The data type for input values.
+ * @tparam U The data type for average values.
+ * @tparam W The window size type of the engine.
+ * @tparam I The order statistic index of the engine.
+ * @param data The encoded trial.
+ * @param size The number of bytes in the buffer.
+ * @return True if the engine agreed with the reference on every output, false otherwise.
+ */
+template<typename T, typename U, typename W = uint8_t, typename I = SkipList<U, typename WindowTraits<U, W>::Sum>>
+bool runLifecycleTrial(const uint8_t* data, size_t size) {
+  if (size < DIFFERENTIAL_HEADER + 2)
+    return true;
+
+  uint16_t window_size = decodeWindowSize<W>(data);
+  uint8_t shift = data[1] & 0x0F;
+  float smoothing_factor = data[2] / 255.0f;
+  uint8_t period = data[3] % 32 + 1;
+
+  size_t count = (size - DIFFERENTIAL_HEADER) / 2;
+  T* samples = new T[count];
+  for (size_t k = 0; k < count; k++) {
+    const uint8_t* bytes = data + DIFFERENTIAL_HEADER + 2 * k;
+    samples[k] = T(int16_t(bytes[0] | bytes[1] << 8) >> shift);
+  }
+
+  MovingAverage<T, U, W, I> filter;
+  ReferenceFilter<T, U> reference(window_size);
+  filter.begin();
+
+  size_t k = 0;
+  bool exact_ema = true;
+  bool agreed = true;
+  if (data[4] & 1) {
+    k = (data[4] >> 1) % 64 + 1;
+    k = k < count ? k : count;
+    filter.reconfigure(window_size);
+    filter.prime(samples, k);
+    reference.prime(samples, k);
+    exact_ema = false;
+    agreed = lifecycleOutputsAgree(filter, reference, window_size, smoothing_factor, k - 1, exact_ema);
+  }
+
+  for (; k < count && agreed; k++) {
+    filter.add(samples[k]);
+    reference.add(samples[k]);
+    agreed = lifecycleOutputsAgree(filter, reference, window_size, smoothing_factor, k, exact_ema);
+    if (!agreed || (k + 1) % period != 0)
+      continue;
+
+    const uint8_t* bytes = data + DIFFERENTIAL_HEADER + 2 * k;
+    if (bytes[0] % 4 == 0) {
+      filter.reset();
+      reference.reset();
+      exact_ema = true;
+    } else if (bytes[0] % 4 == 1) {
+      size_t burst = bytes[1] % 64 + 1;
+      burst = burst < count - k - 1 ? burst : count - k - 1;
+      if (burst == 0)
+        continue;
+      filter.prime(samples + k + 1, burst);
+      reference.prime(samples + k + 1, burst);
+      exact_ema = false;
+      k += burst;
+      agreed = lifecycleOutputsAgree(filter, reference, window_size, smoothing_factor, k, exact_ema);
+    } else {
+      const uint8_t window_bytes[6] = { bytes[0], 0, 0, 0, 0, bytes[1] };
+      window_size = decodeWindowSize<W>(window_bytes);
+      filter.reconfigure(window_size);
+      reference.reconfigure(window_size);
+    }
+  }
+
+  delete[] samples;
+  return agreed;
+}
+
+#if defined(MOVINGAVERAGE_FUZZER)
+#include <stdlib.h>
+
+/**
+ * @brief libFuzzer entry point, aborts on the first disagreement.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  if (!runDifferentialTrial<int16_t, int16_t>(data, size) || !runDifferentialTrial<int32_t, int32_t>(data, size)
+      || !runDifferentialTrial<float, float>(data, size) || !runBatchTrial<int16_t, int16_t>(data, size)
+      || !runLifecycleTrial<int16_t, int16_t>(data, size))
+    abort();
+  return 0;
+}
+#endif
+
+#endif  // DIFFERENTIALTRIAL_H
@@ -0,0 +1,472 @@
+/**
+ * @file ReferenceFilters.h
+ *
+ * @brief Slow, obviously correct reference implementations of the MovingAverage filters.
+ *
+ * Every output is recomputed from the raw sample history on each call, without running sums,
+ * incremental indices or other state that an optimisation could get wrong. The results follow the
+ * documented semantics of the MovingAverage methods, so any difference to an optimised engine is a
+ * bug in one of the two.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef REFERENCEFILTERS_H
+#define REFERENCEFILTERS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * @brief Reference filter keeping the samples of one window and the total of all samples.
+ *
+ * Sorted reads sort a copy of the window with qsort() on every call.
+ *
+ * @tparam T The data type for input values.
+ * @tparam U The data type for average values.
+ */
+template<typename T, typename U>
+class ReferenceFilter {
+public:
+  ReferenceFilter(uint16_t window_size);
+  ~ReferenceFilter();
+  ReferenceFilter(const ReferenceFilter&) = delete;
+  ReferenceFilter& operator=(const ReferenceFilter&) = delete;
+
+  void reset();
+  void reconfigure(uint16_t window_size);
+  void prime(const T* samples, size_t n);
+  void add(T input);
+  bool detectedPeak(T threshold, uint8_t consecutive_matches);
+  U readAverage() const;
+  U readCumulativeAverage() const;
+  U readWeightedAverage() const;
+  float readSlope() const;
+  U readTrend() const;
+  U readExponentialAverage(float smoothing_factor);
+  U readMovingMedian() const;
+  U readHampel(float threshold) const;
+  U readTrimmedMean(float trim_fraction) const;
+  U readWinsorizedMean(float trim_fraction) const;
+  U readPercentile(float percentile) const;
+  U readMinimum() const;
+  U readMaximum() const;
+
+private:
+  typedef decltype(U() + 0LL) Sum;
+
+  uint16_t window_size;
+  uint32_t num_samples;
+  uint32_t window_start;
+  Sum total;
+  U* history;
+  U* sorted;
+  Sum* deviations;
+  U exponential_moving_average;
+  T input;
+  uint8_t peak_matches;
+
+  uint16_t windowLength() const;
+  U sample(uint16_t age) const;
+  void sortWindow() const;
+  uint16_t trimCount(float trim_fraction) const;
+
+  template<typename V>
+  static int compare(const void* a, const void* b);
+};
+
+/**
+ * @brief Constructs an empty reference filter.
+ *
+ * @param window_size The size of the window used by the windowed filters.
+ */
+template<typename T, typename U>
+ReferenceFilter<T, U>::ReferenceFilter(uint16_t window_size)
+  : window_size(window_size), num_samples(0), window_start(0), total(0), history(new U[window_size]), sorted(new U[window_size]),
+    deviations(new Sum[window_size]), exponential_moving_average(0), input(0), peak_matches(0) {}
+
+/**
+ * @brief Destroys the reference filter and releases the window.
+ */
+template<typename T, typename U>
+ReferenceFilter<T, U>::~ReferenceFilter() {
+  delete[] this->history;
+  delete[] this->sorted;
+  delete[] this->deviations;
+}
+
+/**
+ * @brief Forgets all samples, keeping the window size.
+ */
+template<typename T, typename U>
+void ReferenceFilter<T, U>::reset() {
+  this->num_samples = 0;
+  this->window_start = 0;
+  this->total = 0;
+  this->exponential_moving_average = 0;
+  this->input = 0;
+  this->peak_matches = 0;
+}
+
+/**
+ * @brief Changes the window size, keeping the newest samples that fit into the new window.
+ *
+ * Older samples leave the window for good, it grows again only with new samples.
+ *
+ * @param window_size The new size of the window, 0 is treated as 1.
+ */
+template<typename T, typename U>
+void ReferenceFilter<T, U>::reconfigure(uint16_t window_size) {
+  window_size = window_size ? window_size : 1;
+  uint16_t count = this->windowLength() < window_size ? this->windowLength() : window_size;
+  U* history = new U[window_size];
+  for (uint16_t age = 0; age < count; age++) {
+    history[(this->num_samples - 1 - age) % window_size] = this->sample(age);
+  }
+
+  delete[] this->history;
+  delete[] this->sorted;
+  delete[] this->deviations;
+  this->history = history;
+  this->sorted = new U[window_size];
+  this->deviations = new Sum[window_size];
+  this->window_size = window_size;
+  this->window_start = this->num_samples - count;
+}
+
+/**
+ * @brief Forgets all samples, adds a burst and starts the EMA at its mean.
+ *
+ * @param samples The samples, oldest first.
+ * @param n The number of samples.
+ */
+template<typename T, typename U>
+void ReferenceFilter<T, U>::prime(const T* samples, size_t n) {
+  this->reset();
+  for (size_t i = 0; i < n; i++) {
+    this->add(samples[i]);
+  }
+  this->exponential_moving_average = this->readCumulativeAverage();
+}
+
+/**
+ * @brief Appends a sample to the history.
+ *
+ * @param input The new data point.
+ */
+template<typename T, typename U>
+void ReferenceFilter<T, U>::add(T input) {
+  this->input = input;
+  this->history[this->num_samples % this->window_size] = input;
+  this->total += U(input);
+  this->num_samples++;
+}
+
+/**
+ * @brief Counts consecutive samples at or above the threshold.
+ *
+ * @param threshold The threshold value to detect peaks.
+ * @param consecutive_matches The number of consecutive matches that make a peak.
+ * @return True if a peak is detected, false otherwise.
+ */
+template<typename T, typename U>
+bool ReferenceFilter<T, U>::detectedPeak(T threshold, uint8_t consecutive_matches) {
+  this->peak_matches = this->input >= threshold ? this->peak_matches + 1 : 0;
+  if (this->peak_matches >= consecutive_matches) {
+    this->peak_matches = 0;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Sums the window and divides by its length.
+ *
+ * @return The Simple Moving Average.
+ */
+template<typename T, typename U>
+U ReferenceFilter<T, U>::readAverage() const {
+  Sum sum = 0;
+  for (uint16_t age = 0; age < this->windowLength(); age++) {
+    sum += this->sample(age);
+  }
+  return sum / Sum(this->windowLength());
+}
+
+/**
+ * @brief Divides the total of all samples by their number.
+ *
+ * @return The Cumulative Average.
+ */
+template<typename T, typename U>
+U ReferenceFilter<T, U>::readCumulativeAverage() const {
+  return this->total / Sum(this->num_samples);
+}
+
+/**
+ * @brief Weighs the window with 1 for the oldest up to its length for the newest sample.
+ *
+ * @return The Weighted Moving Average.
+ */
+template<typename T, typename U>
+U ReferenceFilter<T, U>::readWeightedAverage() const {
+  uint16_t length = this->windowLength();
+  Sum weighted_sum = 0;
+  Sum weight_total = 0;
+  for (uint16_t age = 0; age < length; age++) {
+    Sum weight = length - age;
+    weighted_sum += Sum(this->sample(age)) * weight;
+    weight_total += weight;
+  }
+  return weighted_sum / weight_total;
+}
+
+/**
+ * @brief Fits a line by least squares from the centred positions and samples.
+ *
+ * @return The slope per sample, 0 for fewer than 2 samples.
+ */
+template<typename T, typename U>
+float ReferenceFilter<T, U>::readSlope() const {
+  uint16_t length = this->windowLength();
+  if (length < 2)
+    return 0;
+
+  double mean = 0;
+  for (uint16_t age = 0; age < length; age++) {
+    mean += double(this->sample(age));
+  }
+  mean /= length;
+
+  double covariance = 0;
+  double variance = 0;
+  for (uint16_t age = 0; age < length; age++) {
+    double position = (length - 1) / 2.0 - age;
+    covariance += position * (double(this->sample(age)) - mean);
+    variance += position * position;
+  }
+  return float(covariance / variance);
+}
+
+/**
+ * @brief Evaluates the least-squares line at the newest sample.
+ *
+ * Weighs the sample at position i (1 being the oldest) with 3 i - (length + 1), the weight of the
+ * line's end point, over length (length + 1) / 2, and saturates integral results at the range of U.
+ *
+ * @return The trend.
+ */
+template<typename T, typename U>
+U ReferenceFilter<T, U>::readTrend() const {
+  uint16_t length = this->windowLength();
+  Sum numerator = 0;
+  for (uint16_t age = 0; age < length; age++) {
+    Sum position = length - age;
+    numerator += Sum(this->sample(age)) * (3 * position - (length + 1));
+  }
+  Sum trend = numerator / (Sum(length) * (length + 1) / 2);
+
+  if (U(0.5) == U(0)) {
+    unsigned long long bits = ~0ULL >> (64 - 8 * sizeof(U));
+    Sum highest = Sum(U(-1) < U(0) ? bits >> 1 : bits);
+    Sum lowest = U(-1) < U(0) ? -highest - 1 : 0;
+    trend = trend > highest ? highest : trend < lowest ? lowest : trend;
+  }
+  return U(trend);
+}
+
+/**
+ * @brief Blends the newest sample into the previous average.
+ *
+ * @param smoothing_factor The weight of the newest sample.
+ * @return The Exponential Moving Average.
+ */
+template<typename T, typename U>
+U ReferenceFilter<T, U>::readExponentialAverage(float smoothing_factor) {
+  this->exponential_moving_average = smoothing_factor * this->input + (1 - smoothing_factor) * this->exponential_moving_average;
+  return this->exponential_moving_average;
+}
+
+/**
+ * @brief Sorts a copy of the window and picks the upper middle value.
+ *
+ * @return The Moving Median.
+ */
+template<typename T, typename U>
+U ReferenceFilter<T, U>::readMovingMedian() const {
+  this->sortWindow();
+  return this->sorted[this->windowLength() / 2];
+}
+
+/**
+ * @brief Sorts the absolute deviations from the median and replaces the input if it is an outlier.
+ *
+ * @param threshold The number of scaled MADs beyond which an input is an outlier.
+ * @return The Hampel filtered input.
+ */
+template<typename T, typename U>
+U ReferenceFilter<T, U>::readHampel(float threshold) const {
+  uint16_t length = this->windowLength();
+  U median = this->readMovingMedian();
+  for (uint16_t i = 0; i < length; i++) {
+    Sum deviation = Sum(this->sample(i)) - Sum(median);
+    this->deviations[i] = deviation < 0 ? -deviation : deviation;
+  }
+  qsort(this->deviations, length, sizeof(Sum), compare<Sum>);
+
+  Sum deviation = Sum(this->input) - Sum(median);
+  deviation = deviation < 0 ? -deviation : deviation;
+  return float(deviation) > threshold * 1.4826f * float(this->deviations[length / 2]) ? median : U(this->input);
+}
+
+/**
+ * @brief Sorts a copy of the window and averages all but the trimmed samples at both ends.
+ *
+ * @param trim_fraction The fraction of samples discarded at each end.
+ * @return The Trimmed Mean.
+ */
+template<typename T, typename U>
+U ReferenceFilter<T, U>::readTrimmedMean(float trim_fraction) const {
+  uint16_t length = this->windowLength();
+  uint16_t trim = this->trimCount(trim_fraction);
+  this->sortWindow();
+
+  Sum sum = 0;
+  for (uint16_t i = trim; i < length - trim; i++) {
+    sum += this->sorted[i];
+  }
+  return sum / Sum(length - 2 * trim);
+}
+
+/**
+ * @brief Sorts a copy of the window, clamps the samples at both ends and averages the window.
+ *
+ * @param trim_fraction The fraction of samples clamped at each end.
+ * @return The Winsorized Mean.
+ */
+template<typename T, typename U>
+U ReferenceFilter<T, U>::readWinsorizedMean(float trim_fraction) const {
+  uint16_t length = this->windowLength();
+  uint16_t trim = this->trimCount(trim_fraction);
+  this->sortWindow();
+
+  Sum sum = 0;
+  for (uint16_t i = 0; i < length; i++) {
+    sum += i < trim ? this->sorted[trim] : i >= length - trim ? this->sorted[length - 1 - trim] : this->sorted[i];
+  }
+  return sum / Sum(length);
+}
+
+/**
+ * @brief Sorts a copy of the window and picks the nearest-rank percentile.
+ *
+ * @param percentile The percentile, in the interval [0; 100].
+ * @return The smallest sample with at least percentile % of the window less than or equal to it.
+ */
+template<typename T, typename U>
+U ReferenceFilter<T, U>::readPercentile(float percentile) const {
+  uint16_t length = this->windowLength();
+  this->sortWindow();
+
+  float position = percentile * 0.01f * length;
+  for (uint16_t rank = 1; rank < length; rank++) {
+    if (position <= rank)
+      return this->sorted[rank - 1];
+  }
+  return this->sorted[length - 1];
+}
+
+/**
+ * @brief Scans the window for its smallest sample.
+ *
+ * @return The minimum of the window.
+ */
+template<typename T, typename U>
+U ReferenceFilter<T, U>::readMinimum() const {
+  U minimum = this->sample(0);
+  for (uint16_t age = 1; age < this->windowLength(); age++) {
+    if (this->sample(age) < minimum)
+      minimum = this->sample(age);
+  }
+  return minimum;
+}
+
+/**
+ * @brief Scans the window for its largest sample.
+ *
+ * @return The maximum of the window.
+ */
+template<typename T, typename U>
+U ReferenceFilter<T, U>::readMaximum() const {
+  U maximum = this->sample(0);
+  for (uint16_t age = 1; age < this->windowLength(); age++) {
+    if (this->sample(age) > maximum)
+      maximum = this->sample(age);
+  }
+  return maximum;
+}
+
+/**
+ * @brief Returns the number of samples in the window.
+ *
+ * @return The window length, at most the window size.
+ */
+template<typename T, typename U>
+uint16_t ReferenceFilter<T, U>::windowLength() const {
+  uint32_t length = this->num_samples - this->window_start;
+  return length < this->window_size ? length : this->window_size;
+}
+
+/**
+ * @brief Returns a past sample.
+ *
+ * @param age The age of the sample, 0 being the newest.
+ * @return The sample.
+ */
+template<typename T, typename U>
+U ReferenceFilter<T, U>::sample(uint16_t age) const {
+  return this->history[(this->num_samples - 1 - age) % this->window_size];
+}
+
+/**
+ * @brief Copies the window to the sorted buffer and sorts it.
+ */
+template<typename T, typename U>
+void ReferenceFilter<T, U>::sortWindow() const {
+  for (uint16_t i = 0; i < this->windowLength(); i++) {
+    this->sorted[i] = this->sample(i);
+  }
+  qsort(this->sorted, this->windowLength(), sizeof(U), compare<U>);
+}
+
+/**
+ * @brief Converts a trim fraction to a number of samples, leaving at least one in the middle.
+ *
+ * @param trim_fraction The fraction of samples at each end of the window.
+ * @return The number of samples.
+ */
+template<typename T, typename U>
+uint16_t ReferenceFilter<T, U>::trimCount(float trim_fraction) const {
+  uint16_t length = this->windowLength();
+  uint16_t trim = uint16_t(trim_fraction * length);
+  return 2 * trim < length ? trim : (length - 1) / 2;
+}
+
+/**
+ * @brief Orders two values for qsort().
+ *
+ * @return -1, 0 or 1 if the first value is less than, equal to or greater than the second.
+ */
+template<typename T, typename U>
+template<typename V>
+int ReferenceFilter<T, U>::compare(const void* a, const void* b) {
+  V first = *static_cast<const V*>(a);
+  V second = *static_cast<const V*>(b);
+  return first < second ? -1 : first > second ? 1 : 0;
+}
+
+#endif  // REFERENCEFILTERS_H
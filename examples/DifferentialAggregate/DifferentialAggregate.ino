@@ -0,0 +1,228 @@
+/**
+ * @brief Compares the SlidingAggregator against rescanning the window.
+ *
+ * Random sample streams are added to aggregators one by one and in strided blocks, with a reset
+ * part way through, and after every data point or block the aggregate is compared with the window
+ * scanned from scratch: its minimum, its maximum and its oldest data point. The last one does not
+ * commute, so it also checks that the blocks are combined oldest first. Windows of odd and even
+ * size are checked, from 2 data points to several blocks longer than the trial. Every disagreement
+ * is printed, together with a running count of trials and failures.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <SlidingAggregator.h>
+
+// Samples per trial and a window longer than that, smaller on AVR
+#if defined(__AVR__)
+#define DIFFERENTIAL_SAMPLES 150
+#define DIFFERENTIAL_LONG_WINDOW 160
+#else
+#define DIFFERENTIAL_SAMPLES 600
+#define DIFFERENTIAL_LONG_WINDOW 1000
+#endif
+
+uint8_t trial[2 + 2 * DIFFERENTIAL_SAMPLES];  // Header bytes followed by up to DIFFERENTIAL_SAMPLES samples
+uint32_t trials = 0;
+uint32_t failures = 0;
+
+/**
+ * @brief The oldest data point of the window, a monoid that does not commute.
+ */
+struct OldestMonoid {
+  typedef int32_t Value;
+
+  static Value identity() {
+    return INT32_MIN;
+  }
+
+  static Value combine(Value older, Value newer) {
+    return older != INT32_MIN ? older : newer;
+  }
+};
+
+/**
+ * @brief Aggregates a window by scanning it, oldest first.
+ *
+ * @tparam M The monoid whose aggregate is computed.
+ */
+template<typename M>
+struct NaiveAggregate;
+
+template<typename T>
+struct NaiveAggregate<MinMonoid<T>> {
+  static T read(const T* window, size_t n) {
+    T minimum = window[0];
+    for (size_t i = 1; i < n; i++) {
+      if (window[i] < minimum)
+        minimum = window[i];
+    }
+    return minimum;
+  }
+};
+
+template<typename T>
+struct NaiveAggregate<MaxMonoid<T>> {
+  static T read(const T* window, size_t n) {
+    T maximum = window[0];
+    for (size_t i = 1; i < n; i++) {
+      if (window[i] > maximum)
+        maximum = window[i];
+    }
+    return maximum;
+  }
+};
+
+template<>
+struct NaiveAggregate<OldestMonoid> {
+  static int32_t read(const int32_t* window, size_t) {
+    return window[0];
+  }
+};
+
+/**
+ * @brief Compares the aggregate with a scan of the window.
+ *
+ * @param path The path that fed the aggregator, printed with a mismatch.
+ * @param aggregator The aggregator.
+ * @param samples The samples added since the last reset, oldest first.
+ * @param count The number of samples added since the last reset, at least 1.
+ * @return True if the aggregate and the size agree, false otherwise.
+ */
+template<typename M, uint16_t N>
+bool aggregateAgrees(const char* path, const SlidingAggregator<M, N>& aggregator, const typename M::Value* samples, size_t count) {
+  size_t n = count < N ? count : N;
+  typename M::Value expected = NaiveAggregate<M>::read(samples + count - n, n);
+  typename M::Value actual = aggregator.read();
+  if (actual == expected && aggregator.size() == n)
+    return true;
+
+  Serial.print("Mismatch:");
+  Serial.print(path);
+  Serial.print("\tsample:");
+  Serial.print(count);
+  Serial.print("\twindow:");
+  Serial.print(N);
+  Serial.print("\texpected:");
+  Serial.print(expected);
+  Serial.print("\tactual:");
+  Serial.print(actual);
+  Serial.print("\n");
+  return false;
+}
+
+/**
+ * @brief Runs one trial.
+ *
+ * Layout of the buffer:
+ * - byte 0: low 2 bits + 1 are the stride of the batch path, the upper bits modulo 32 + 1 its
+ *   block length.
+ * - byte 1: low nibble right-shifts the samples to narrow their range and produce ties, high
+ *   nibble times 16 is the sample after which both aggregators are reset, none if 0.
+ * - remaining byte pairs: the samples, signed 16-bit, scaled to quarters for floating point types.
+ *
+ * @tparam M The monoid.
+ * @tparam N The number of data points in the window.
+ * @param data The encoded trial.
+ * @param size The number of bytes in the buffer.
+ * @return True if both paths agreed with the scan throughout, false otherwise.
+ */
+template<typename M, uint16_t N>
+bool runAggregateTrial(const uint8_t* data, size_t size) {
+  typedef typename M::Value Value;
+  if (size < 4)
+    return true;
+
+  size_t stride = (data[0] & 0x03) + 1;
+  size_t block = (data[0] >> 2) % 32 + 1;
+  uint8_t shift = data[1] & 0x0F;
+  size_t reset_at = (data[1] >> 4) * 16;
+
+  size_t count = (size - 2) / 2;
+  Value* samples = new Value[count];
+  Value* interleaved = new Value[count * stride];
+  for (size_t i = 0; i < count; i++) {
+    int16_t value = int16_t(data[2 + 2 * i] | data[3 + 2 * i] << 8) >> shift;
+    samples[i] = FilterTraits<Value>::INTEGRAL ? Value(value) : Value(value / 4.0);
+    for (size_t channel = 0; channel < stride; channel++) {
+      interleaved[i * stride + channel] = channel == 0 ? samples[i] : Value(-samples[i]);
+    }
+  }
+
+  SlidingAggregator<M, N>* single = new SlidingAggregator<M, N>();
+  SlidingAggregator<M, N>* batch = new SlidingAggregator<M, N>();
+  single->begin();
+  batch->begin();
+
+  bool agreed = true;
+  size_t start = 0;
+  for (size_t i = 0; i < count && agreed; i++) {
+    single->add(samples[i]);
+    agreed = aggregateAgrees("add", *single, samples + start, i + 1 - start);
+    if (i + 1 == reset_at) {
+      single->reset();
+      start = i + 1;
+    }
+  }
+
+  start = 0;
+  for (size_t i = 0; i < count && agreed;) {
+    size_t end = i + block < count ? i + block : count;
+    if (i < reset_at && end > reset_at)
+      end = reset_at;
+    batch->addBatch(interleaved + i * stride, end - i, stride);
+    agreed = aggregateAgrees("addBatch", *batch, samples + start, end - start);
+    if (end == reset_at) {
+      batch->reset();
+      start = end;
+    }
+    i = end;
+  }
+
+  delete single;
+  delete batch;
+  delete[] samples;
+  delete[] interleaved;
+  return agreed;
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  randomSeed(42);      // Make the trials reproducible
+}
+
+void loop() {
+  size_t size = random(2, sizeof(trial) + 1);  // Random number of samples
+  for (size_t i = 0; i < size; i++) {
+    trial[i] = random(0, 256);
+  }
+
+  // Run the same trial for several monoids and windows of odd and even size
+  if (!runAggregateTrial<MinMonoid<int16_t>, 2>(trial, size))
+    failures++;
+  if (!runAggregateTrial<MinMonoid<int16_t>, 17>(trial, size))
+    failures++;
+  if (!runAggregateTrial<MaxMonoid<int16_t>, 64>(trial, size))
+    failures++;
+  if (!runAggregateTrial<MaxMonoid<int16_t>, 3>(trial, size))
+    failures++;
+  if (!runAggregateTrial<MinMonoid<float>, 8>(trial, size))
+    failures++;
+  if (!runAggregateTrial<MaxMonoid<float>, 33>(trial, size))
+    failures++;
+  if (!runAggregateTrial<OldestMonoid, 9>(trial, size))
+    failures++;
+  if (!runAggregateTrial<OldestMonoid, DIFFERENTIAL_LONG_WINDOW>(trial, size))
+    failures++;
+  trials++;
+
+  if (trials % 100 == 0) {
+    Serial.print("Trials:");
+    Serial.print(trials);
+    Serial.print("\tFailures:");
+    Serial.print(failures);
+    Serial.print("\n");
+  }
+}
@@ -0,0 +1,221 @@
+/**
+ * @brief Compares the CompressedHistory against the raw samples it was fed.
+ *
+ * Random sample streams of several shapes, full range noise, random walks, constant runs and
+ * ramps, are appended to histories with small stores and few summaries, so blocks are compressed,
+ * lose their compressed data and are dropped. After every data point all compressed and raw data
+ * points are decoded with readSamples() and must equal the newest samples bit for bit, and the
+ * average, minimum and maximum of a window of the newest data points must equal those of the
+ * samples, with the window rounded up to whole blocks where only summaries remain. The size and
+ * the cumulative average are checked as well. Every disagreement is printed, together with a
+ * running count of trials and failures.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <CompressedHistory.h>
+
+#if defined(__AVR__)
+#define DIFFERENTIAL_SAMPLES 120
+#else
+#define DIFFERENTIAL_SAMPLES 600
+#endif
+
+uint8_t trial[3 + 2 * DIFFERENTIAL_SAMPLES];  // Header bytes followed by up to DIFFERENTIAL_SAMPLES samples
+uint32_t trials = 0;
+uint32_t failures = 0;
+
+/**
+ * @brief Prints a mismatch between the history and the samples.
+ */
+void printMismatch(const char* read, size_t sample, uint32_t window, double expected, double actual) {
+  Serial.print("Mismatch:");
+  Serial.print(read);
+  Serial.print("\tsample:");
+  Serial.print(sample);
+  Serial.print("\twindow:");
+  Serial.print(window);
+  Serial.print("\texpected:");
+  Serial.print(expected);
+  Serial.print("\tactual:");
+  Serial.print(actual);
+  Serial.print("\n");
+}
+
+/**
+ * @brief Compares every read of the history with the samples appended so far.
+ *
+ * @param history The history.
+ * @param samples The samples, oldest first.
+ * @param count The number of samples appended, at least 1.
+ * @param max_blocks The number of summaries the history keeps.
+ * @param window The number of newest data points to aggregate.
+ * @param decoded A buffer for count data points.
+ * @return True if all reads agree, false otherwise.
+ */
+template<typename T, uint16_t B>
+bool historyAgrees(const CompressedHistory<T, B>& history, const T* samples, size_t count, uint32_t max_blocks, uint32_t window, T* decoded) {
+  typedef typename FilterTraits<T>::Total Total;
+
+  uint32_t raw = count % B;
+  uint32_t blocks = count / B < max_blocks ? count / B : max_blocks;
+  uint32_t size = blocks * B + raw;
+  if (history.size() != size) {
+    printMismatch("size", count, 0, size, history.size());
+    return false;
+  }
+
+  // The newest compressed blocks and the raw block decode to the newest samples
+  uint32_t available = history.readSamples(decoded, size);
+  if (available < raw || available > size || (available - raw) % B != 0) {
+    printMismatch("readSamples", count, size, size, available);
+    return false;
+  }
+  if (memcmp(decoded, samples + count - available, available * sizeof(T)) != 0) {
+    printMismatch("readSamples", count, available, 0, 1);
+    return false;
+  }
+
+  // Beyond the decodable data points, whole blocks are aggregated from their summaries
+  uint32_t length = window;
+  if (length > available)
+    length = available + (length - available + B - 1) / B * B;
+  if (length > size)
+    length = size;
+
+  Total sum = 0;
+  T low = samples[count - 1];
+  T high = samples[count - 1];
+  for (size_t i = count - length; i < count; i++) {
+    sum += Total(samples[i]);
+    low = samples[i] < low ? samples[i] : low;
+    high = samples[i] > high ? samples[i] : high;
+  }
+  T average = T(sum / Total(length));
+  if (history.readAverage(window) != average) {
+    printMismatch("readAverage", count, window, double(average), double(history.readAverage(window)));
+    return false;
+  }
+  if (history.readMinimum(window) != low || history.readMaximum(window) != high) {
+    printMismatch("readMinimum", count, window, double(low), double(history.readMinimum(window)));
+    printMismatch("readMaximum", count, window, double(high), double(history.readMaximum(window)));
+    return false;
+  }
+
+  Total total = 0;
+  for (size_t i = 0; i < count; i++) {
+    total += Total(samples[i]);
+  }
+  T cumulative = T(total / Total(count));
+  if (history.readCumulativeAverage() != cumulative) {
+    printMismatch("readCumulativeAverage", count, 0, double(cumulative), double(history.readCumulativeAverage()));
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Runs one trial.
+ *
+ * Layout of the buffer:
+ * - byte 0: size of the store, times 2 bytes, at least 1 byte.
+ * - byte 1: low 2 bits select the shape of the stream: full range noise, a random walk, constant
+ *   runs or ramps with jumps; the upper bits modulo 16 plus 1 are the number of summaries.
+ * - byte 2: right-shifts the steps of walks and ramps, modulo 16.
+ * - remaining byte pairs: the noise, steps or jumps of the stream.
+ *
+ * Integral samples wrap around the range of T, floating point samples are the integer values
+ * scaled by 1/8.
+ *
+ * @tparam T The data type of the history.
+ * @tparam B The number of data points per block.
+ * @param data The encoded trial.
+ * @param size The number of bytes in the buffer.
+ * @return True if the history agreed with the samples after every data point, false otherwise.
+ */
+template<typename T, uint16_t B>
+bool runArchiveTrial(const uint8_t* data, size_t size) {
+  if (size < 5)
+    return true;
+
+  size_t store_size = data[0] * 2 + 1;
+  uint8_t shape = data[1] & 0x03;
+  uint32_t max_blocks = (data[1] >> 2) % 16 + 1;
+  uint8_t shift = data[2] % 16;
+
+  size_t count = (size - 3) / 2;
+  T* samples = new T[count];
+  T* decoded = new T[count];
+  int32_t value = 0;
+  int32_t slope = 0;
+  for (size_t i = 0; i < count; i++) {
+    uint16_t bits = uint16_t(data[3 + 2 * i] | data[4 + 2 * i] << 8);
+    int32_t step = int16_t(bits) >> shift;
+    if (shape == 0)
+      value = int32_t(uint32_t(bits) * 0x9E3779B1u);
+    else if (shape == 1)
+      value += step;
+    else if (shape == 2)
+      value = (bits & 0xFF) < 32 ? step : value;
+    else if ((bits & 0xFF) < 16)
+      slope = step >> 4;
+    value = shape == 3 ? value + slope : value;
+    samples[i] = FilterTraits<T>::INTEGRAL ? T(value) : T(value / 8.0);
+  }
+
+  CompressedHistory<T, B>* history = new CompressedHistory<T, B>(store_size, max_blocks);
+  history->begin();
+
+  bool agreed = true;
+  for (size_t i = 0; i < count && agreed; i++) {
+    history->add(samples[i]);
+    uint32_t window = uint32_t(i * 37 % (i + 2 * B)) + 1;
+    agreed = historyAgrees(*history, samples, i + 1, max_blocks, window, decoded);
+  }
+
+  delete history;
+  delete[] samples;
+  delete[] decoded;
+  return agreed;
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  randomSeed(42);      // Make the trials reproducible
+}
+
+void loop() {
+  size_t size = random(3, sizeof(trial) + 1);  // Random number of samples
+  for (size_t i = 0; i < size; i++) {
+    trial[i] = random(0, 256);
+  }
+
+  // Run the same trial for both codecs, every integral width and several block sizes
+  if (!runArchiveTrial<int16_t, 16>(trial, size))
+    failures++;
+  if (!runArchiveTrial<int16_t, 2>(trial, size))
+    failures++;
+  if (!runArchiveTrial<uint16_t, 33>(trial, size))
+    failures++;
+  if (!runArchiveTrial<int8_t, 8>(trial, size))
+    failures++;
+  if (!runArchiveTrial<int32_t, 16>(trial, size))
+    failures++;
+  if (!runArchiveTrial<uint32_t, 7>(trial, size))
+    failures++;
+  if (!runArchiveTrial<float, 16>(trial, size))
+    failures++;
+  if (!runArchiveTrial<double, 9>(trial, size))
+    failures++;
+  trials++;
+
+  if (trials % 100 == 0) {
+    Serial.print("Trials:");
+    Serial.print(trials);
+    Serial.print("\tFailures:");
+    Serial.print(failures);
+    Serial.print("\n");
+  }
+}
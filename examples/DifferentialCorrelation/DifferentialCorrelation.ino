@@ -0,0 +1,233 @@
+/**
+ * @brief Compares the CorrelationFilter against a two-pass reference.
+ *
+ * Random pairs are added to one filter pair by pair and to another in blocks of random length, and
+ * after every pair or block the covariance and correlation of both are compared with those of the
+ * window computed in double, first the means and then the sum of the products of the deviations.
+ * The running sums use n Σxy - Σx Σy instead, so the check covers their cancellation, the
+ * eviction from the rings and the recomputation of floating point sums. Every disagreement is
+ * printed, together with a running count of trials and failures.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <CorrelationFilter.h>
+
+#if defined(__AVR__)
+#define DIFFERENTIAL_PAIRS 64
+#else
+#define DIFFERENTIAL_PAIRS 300
+#endif
+
+uint8_t trial[2 + 4 * DIFFERENTIAL_PAIRS];  // Header bytes followed by up to DIFFERENTIAL_PAIRS pairs
+double reference_x[DIFFERENTIAL_PAIRS];
+double reference_y[DIFFERENTIAL_PAIRS];
+uint32_t trials = 0;
+uint32_t failures = 0;
+
+/**
+ * @brief Two-pass covariance and correlation of the pairs in the window.
+ */
+struct ReferenceMoments {
+  double covariance;
+  double correlation;
+  double deviation;  // Square root of the product of both variances, the scale of the covariance
+
+  ReferenceMoments(size_t count, uint16_t window) {
+    size_t first = count > window ? count - window : 0;
+    size_t n = count - first;
+    double mean_x = 0;
+    double mean_y = 0;
+    for (size_t i = first; i < count; i++) {
+      mean_x += reference_x[i];
+      mean_y += reference_y[i];
+    }
+    mean_x /= n;
+    mean_y /= n;
+
+    double xy = 0;
+    double xx = 0;
+    double yy = 0;
+    for (size_t i = first; i < count; i++) {
+      xy += (reference_x[i] - mean_x) * (reference_y[i] - mean_y);
+      xx += (reference_x[i] - mean_x) * (reference_x[i] - mean_x);
+      yy += (reference_y[i] - mean_y) * (reference_y[i] - mean_y);
+    }
+    this->covariance = xy / n;
+    this->deviation = sqrt(xx * yy) / n;
+    this->correlation = xx > 0 && yy > 0 ? xy / sqrt(xx * yy) : 0;
+  }
+};
+
+/**
+ * @brief Converts a decoded 16-bit value into the data type of the trial.
+ *
+ * Unsigned values are offset to be positive, 32-bit values scaled up so their products use most of
+ * the double mantissa, and floating point values have fractional parts. All of them are exact in
+ * both the filter and the reference.
+ */
+template<typename T>
+T convert(int16_t value) {
+  if (T(0.25) != T(0))
+    return T(value / 4.0);
+  if (T(-1) > T(0))
+    return T(int32_t(value) + 32768);
+  if (sizeof(T) > 2)
+    return T(int32_t(value) * 256);
+  return T(value);
+}
+
+/**
+ * @brief Compares the covariance and correlation of a filter with the reference.
+ *
+ * @param path The path that fed the filter, printed with a mismatch.
+ * @param filter The filter.
+ * @param count The number of pairs added so far.
+ * @return True if both reads agree, false otherwise.
+ */
+template<typename T, uint16_t N>
+bool momentsAgree(const char* path, const CorrelationFilter<T, N>& filter, size_t count) {
+  ReferenceMoments reference(count, N);
+  double covariance = filter.readCovariance();
+  double correlation = filter.readCorrelation();
+  double covariance_error = covariance > reference.covariance ? covariance - reference.covariance : reference.covariance - covariance;
+  double correlation_error = correlation > reference.correlation ? correlation - reference.correlation : reference.correlation - correlation;
+  if (covariance_error <= 1e-4 * reference.deviation + 1e-6 && correlation_error <= 1e-4)
+    return true;
+
+  Serial.print("Mismatch:");
+  Serial.print(path);
+  Serial.print("\tpairs:");
+  Serial.print(count);
+  Serial.print("\twindow:");
+  Serial.print(N);
+  Serial.print("\texpected:");
+  Serial.print(reference.covariance);
+  Serial.print(",");
+  Serial.print(reference.correlation);
+  Serial.print("\tactual:");
+  Serial.print(covariance);
+  Serial.print(",");
+  Serial.print(correlation);
+  Serial.print("\n");
+  return false;
+}
+
+/**
+ * @brief Runs one trial.
+ *
+ * Layout of the buffer:
+ * - byte 0: block length of the batch path, modulo 2 N, plus 1, so blocks may exceed the window.
+ * - byte 1: low 2 bits select how y follows x: independent, x plus noise, -x, or x constant; the
+ *   high nibble right-shifts the values to narrow their range.
+ * - remaining groups of 4 bytes: the 16-bit values of x and y.
+ *
+ * @tparam T The data type for input values.
+ * @tparam N The number of pairs in the window.
+ * @param data The encoded trial.
+ * @param size The number of bytes in the buffer.
+ * @return True if both filters agreed with the reference throughout, false otherwise.
+ */
+template<typename T, uint16_t N>
+bool runCorrelationTrial(const uint8_t* data, size_t size) {
+  if (size < 6)
+    return true;
+
+  size_t block = data[0] % (2 * N) + 1;
+  uint8_t mode = data[1] & 0x03;
+  uint8_t shift = data[1] >> 4;
+
+  size_t count = (size - 2) / 4;
+  T* x = new T[count];
+  T* y = new T[count];
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t* pair = data + 2 + 4 * i;
+    int16_t value_x = int16_t(pair[0] | pair[1] << 8) >> shift;
+    int16_t value_y = int16_t(pair[2] | pair[3] << 8) >> shift;
+    if (mode == 1)
+      value_y = int16_t(value_x / 2 + (value_y >> 4));
+    else if (mode == 2)
+      value_y = int16_t(-(value_x / 2));
+    else if (mode == 3)
+      value_x = int16_t(data[2] | data[3] << 8) >> shift;
+    x[i] = convert<T>(value_x);
+    y[i] = convert<T>(value_y);
+    reference_x[i] = double(x[i]);
+    reference_y[i] = double(y[i]);
+  }
+
+  CorrelationFilter<T, N>* single = new CorrelationFilter<T, N>();
+  CorrelationFilter<T, N>* batch = new CorrelationFilter<T, N>();
+  single->begin();
+  batch->begin();
+
+  bool agreed = true;
+  for (size_t i = 0; i < count && agreed; i++) {
+    single->add(x[i], y[i]);
+    agreed = momentsAgree("add", *single, i + 1);
+  }
+  for (size_t i = 0; i < count && agreed; i += block) {
+    size_t n = count - i < block ? count - i : block;
+    batch->addBatch(x + i, y + i, n);
+    agreed = momentsAgree("addBatch", *batch, i + n);
+  }
+
+  // The static kernel over the whole series, in the window of all pairs
+  if (agreed && count <= 32768) {
+    ReferenceMoments reference(count, uint16_t(count));
+    double correlation = CorrelationFilter<T, N>::correlation(x, y, count);
+    if ((correlation > reference.correlation ? correlation - reference.correlation : reference.correlation - correlation) > 1e-4) {
+      Serial.print("Mismatch:correlation()\tpairs:");
+      Serial.print(count);
+      Serial.print("\texpected:");
+      Serial.print(reference.correlation);
+      Serial.print("\tactual:");
+      Serial.print(correlation);
+      Serial.print("\n");
+      agreed = false;
+    }
+  }
+
+  delete single;
+  delete batch;
+  delete[] x;
+  delete[] y;
+  return agreed;
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  randomSeed(42);      // Make the trials reproducible
+}
+
+void loop() {
+  size_t size = random(2, sizeof(trial) + 1);  // Random number of pairs
+  for (size_t i = 0; i < size; i++) {
+    trial[i] = random(0, 256);
+  }
+
+  // Run the same trial for exact integer sums, double sums and several windows
+  if (!runCorrelationTrial<int16_t, 32>(trial, size))
+    failures++;
+  if (!runCorrelationTrial<int16_t, 5>(trial, size))
+    failures++;
+  if (!runCorrelationTrial<uint16_t, 17>(trial, size))
+    failures++;
+  if (!runCorrelationTrial<int32_t, 32>(trial, size))
+    failures++;
+  if (!runCorrelationTrial<float, 32>(trial, size))
+    failures++;
+  if (!runCorrelationTrial<float, 7>(trial, size))
+    failures++;
+  trials++;
+
+  if (trials % 100 == 0) {
+    Serial.print("Trials:");
+    Serial.print(trials);
+    Serial.print("\tFailures:");
+    Serial.print(failures);
+    Serial.print("\n");
+  }
+}
@@ -0,0 +1,111 @@
+/**
+ * @brief Compares the ExponentialFilter against a double precision reference.
+ *
+ * Random trials with random time constants and sample streams are run through the fixed point
+ * ExponentialFilter and the plain recurrence average += alpha * (input - average) in double, with
+ * the smoothing factor the filter reports. Signed, unsigned and floating point types are checked,
+ * as unsigned averages must fall as well as rise. Every disagreement is printed, together with a
+ * running count of trials and failures.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <ExponentialFilter.h>
+
+uint8_t trial[2 + 2 * 300];  // Header bytes followed by up to 300 samples
+uint32_t trials = 0;
+uint32_t failures = 0;
+
+/**
+ * @brief Runs one trial.
+ *
+ * Layout of the buffer:
+ * - byte 0: time constant in sample periods, modulo 65 (0 passes every data point through).
+ * - byte 1: low nibble right-shifts the samples to narrow their range.
+ * - remaining byte pairs: the samples, offset to be centred around 0 for signed types.
+ *
+ * With at most 64 sample periods the smoothing factor is at least 1/64, so the rounding of the
+ * 8 fractional bits accumulates to less than 1/8 and integral averages are within 1 of the
+ * reference.
+ *
+ * @tparam T The data type for input values.
+ * @tparam U The data type for average values.
+ * @param data The encoded trial.
+ * @param size The number of bytes in the buffer.
+ * @return True if the filter agreed with the reference after every sample, false otherwise.
+ */
+template<typename T, typename U>
+bool runExponentialTrial(const uint8_t* data, size_t size) {
+  if (size < 2)
+    return true;
+
+  uint8_t periods = data[0] % 65;
+  uint8_t shift = data[1] & 0x0F;
+  int32_t offset = T(-1) < T(0) ? 0x8000L >> shift : 0;
+
+  ExponentialFilter<T, U> filter;
+  filter.begin();
+  filter.setTimeConstant(periods * 0.001f, 0.001f);
+  double alpha = filter.readSmoothingFactor() / 32768.0;
+  double reference = 0;
+  double tolerance = U(0.5) == U(0) ? 1 : 1e-3;
+
+  uint16_t sample = 0;
+  for (size_t i = 2; i + 1 < size; i += 2, sample++) {
+    T input = T(int32_t(uint16_t(data[i] | data[i + 1] << 8) >> shift) - offset);
+    filter.add(input);
+    reference = sample == 0 ? double(input) : reference + alpha * (double(input) - reference);
+
+    double actual = double(filter.read());
+    double difference = actual > reference ? actual - reference : reference - actual;
+    if (difference > tolerance * (1 + (U(0.5) == U(0) ? 0 : (reference < 0 ? -reference : reference)))) {
+      Serial.print("Mismatch:EMA\tsample:");
+      Serial.print(sample);
+      Serial.print("\tperiods:");
+      Serial.print(periods);
+      Serial.print("\texpected:");
+      Serial.print(reference);
+      Serial.print("\tactual:");
+      Serial.print(actual);
+      Serial.print("\n");
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  randomSeed(42);      // Make the trials reproducible
+}
+
+void loop() {
+  size_t size = random(2, sizeof(trial) + 1);  // Random number of samples
+  for (size_t i = 0; i < size; i++) {
+    trial[i] = random(0, 256);
+  }
+
+  // Run the same trial for signed, unsigned and floating point filters
+  if (!runExponentialTrial<int16_t, int16_t>(trial, size))
+    failures++;
+  if (!runExponentialTrial<uint16_t, uint16_t>(trial, size))
+    failures++;
+  if (!runExponentialTrial<int32_t, int32_t>(trial, size))
+    failures++;
+  if (!runExponentialTrial<uint32_t, uint32_t>(trial, size))
+    failures++;
+  if (!runExponentialTrial<float, float>(trial, size))
+    failures++;
+  trials++;
+
+  if (trials % 100 == 0) {
+    Serial.print("Trials:");
+    Serial.print(trials);
+    Serial.print("\tFailures:");
+    Serial.print(failures);
+    Serial.print("\n");
+  }
+}
@@ -0,0 +1,204 @@
+/**
+ * @brief Compares the FirFilter against a direct convolution of the newest data points.
+ *
+ * Random sample streams are added to FIR filters with random kernels in RAM and with fixed kernels
+ * in program memory, and after every data point read() is compared with the newest data points
+ * convolved with a RAM copy of the kernel in the widest type, so the windows are checked while
+ * they fill as well as when full. Some kernels sum to the largest total their accumulator can take,
+ * and a share of the integral samples is set to the lowest or highest value of the type, so the
+ * narrow 16-bit and 32-bit accumulators are driven to their limits. The sums are exact, so every
+ * read must match exactly. Every disagreement is printed, together with a running count of trials
+ * and failures.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <FirFilter.h>
+
+#if defined(__AVR__)
+#define DIFFERENTIAL_SAMPLES 100
+#else
+#define DIFFERENTIAL_SAMPLES 600
+#endif
+
+#define DIFFERENTIAL_TAPS 33  // Kernel bytes in every trial, the longest RAM kernel
+
+uint8_t trial[1 + DIFFERENTIAL_TAPS + 2 * DIFFERENTIAL_SAMPLES];  // Header and kernel bytes followed by up to DIFFERENTIAL_SAMPLES samples
+uint32_t trials = 0;
+uint32_t failures = 0;
+
+// Kernels in program memory and the RAM copies the reference reads. The edge kernels sum to 2^16
+// and 2^8, the largest totals whose products with the lowest sample still fit 32 and 16 bits.
+const FilterKernel<uint16_t, 15> binomial_ram = FilterCore::binomialKernel<uint16_t, 15>();
+const FilterKernel<uint16_t, 15> binomial_flash PROGMEM = FilterCore::binomialKernel<uint16_t, 15>();
+const FilterKernel<uint16_t, 2> edge16_ram = { { 32768, 32768 } };
+const FilterKernel<uint16_t, 2> edge16_flash PROGMEM = { { 32768, 32768 } };
+const FilterKernel<uint8_t, 2> edge8_ram = { { 128, 128 } };
+const FilterKernel<uint8_t, 2> edge8_flash PROGMEM = { { 128, 128 } };
+const FilterKernel<float, 4> decay_ram = { { 0.125f, 0.25f, 0.5f, 1.0f } };
+const FilterKernel<float, 4> decay_flash PROGMEM = { { 0.125f, 0.25f, 0.5f, 1.0f } };
+
+/**
+ * @brief Convolves the newest data points with the newest coefficients, in the widest type.
+ *
+ * @param kernel The N coefficients in RAM, the first weighing the oldest data point.
+ * @param samples The samples added so far, oldest first.
+ * @param count The number of samples added so far, at least 1.
+ * @return The convolution normalised by the sum of the coefficients in use, 0 if that is 0.
+ */
+template<typename U, typename C, uint8_t N>
+U referenceFir(const C* kernel, const U* samples, size_t count) {
+  typedef typename FilterTraits<U>::Total Total;
+
+  size_t n = count < N ? count : N;
+  Total sum = 0;
+  Total weight_total = 0;
+  for (size_t i = 0; i < n; i++) {
+    C weight = kernel[N - n + i];
+    sum += Total(weight) * samples[count - n + i];
+    weight_total += weight;
+  }
+  return weight_total != 0 ? U(sum / weight_total) : U(0);
+}
+
+/**
+ * @brief Runs one trial through one filter.
+ *
+ * Layout of the buffer:
+ * - byte 0: low nibble, an integral sample whose low nibble is below it becomes the lowest or
+ *   highest value of T, by its next bit.
+ * - bytes 1 to DIFFERENTIAL_TAPS: the coefficients of random kernels, see runRamTrial().
+ * - remaining byte pairs: the samples, signed 16-bit, shifted to the range of 8-bit types, offset
+ *   to be positive for unsigned types, widened for 32-bit types and scaled to quarters for floating
+ *   point types.
+ *
+ * @tparam T The data type of the filter.
+ * @tparam C The data type of the kernel coefficients.
+ * @tparam N The number of taps.
+ * @tparam Storage The storage trait the filter reads the kernel with.
+ * @tparam S The accumulator of the filter.
+ * @param name The filter, printed with a mismatch.
+ * @param kernel The kernel the filter reads, in RAM or program memory depending on Storage.
+ * @param reference_kernel The same kernel in RAM.
+ * @param data The encoded trial.
+ * @param size The number of bytes in the buffer.
+ * @return True if every read agreed with the convolution, false otherwise.
+ */
+template<typename T, typename C, uint8_t N, typename Storage, typename S>
+bool runFirTrial(const char* name, const C* kernel, const C* reference_kernel, const uint8_t* data, size_t size) {
+  if (size < 3 + DIFFERENTIAL_TAPS)
+    return true;
+
+  uint8_t saturate = data[0] & 0x0F;
+  size_t count = (size - 1 - DIFFERENTIAL_TAPS) / 2;
+  T* samples = new T[count];
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t* bytes = data + 1 + DIFFERENTIAL_TAPS + 2 * i;
+    int16_t value = int16_t(bytes[0] | bytes[1] << 8);
+    if (FilterTraits<T>::INTEGRAL && (bytes[0] & 0x0F) < saturate)
+      samples[i] = (bytes[0] & 0x10) != 0 ? FilterCore::highest<T>() : FilterCore::lowest<T>();
+    else if (!FilterTraits<T>::INTEGRAL)
+      samples[i] = T(value / 4.0);
+    else if (sizeof(T) == 1)
+      samples[i] = T(value >> 8);
+    else if (T(-1) > T(0))
+      samples[i] = T(int32_t(value) + 32768);
+    else if (sizeof(T) == 4)
+      samples[i] = T(int32_t(uint32_t(int32_t(value)) << 16 | bytes[0]));
+    else
+      samples[i] = T(value);
+  }
+
+  FirFilter<T, T, C, N, Storage, S> filter(kernel);
+  filter.begin();
+  bool agreed = filter.read() == T(0);
+  for (size_t i = 0; i < count && agreed; i++) {
+    filter.add(samples[i]);
+    T expected = referenceFir<T, C, N>(reference_kernel, samples, i + 1);
+    T actual = filter.read();
+    if (expected == actual)
+      continue;
+
+    Serial.print("Mismatch:");
+    Serial.print(name);
+    Serial.print("\tsample:");
+    Serial.print(i + 1);
+    Serial.print("\texpected:");
+    Serial.print(expected);
+    Serial.print("\tactual:");
+    Serial.print(actual);
+    Serial.print("\n");
+    agreed = false;
+  }
+
+  delete[] samples;
+  return agreed;
+}
+
+/**
+ * @brief Runs one trial through a filter with a random kernel in RAM.
+ *
+ * Coefficient i is byte i + 1 scaled to 0 to the largest coefficient, so the kernel sums to at most
+ * N times that.
+ *
+ * @param largest The largest coefficient.
+ */
+template<typename T, typename C, uint8_t N, typename S>
+bool runRamTrial(const char* name, C largest, const uint8_t* data, size_t size) {
+  static_assert(N <= DIFFERENTIAL_TAPS, "The trial holds DIFFERENTIAL_TAPS coefficients");
+  if (size < 1 + DIFFERENTIAL_TAPS)
+    return true;
+
+  C kernel[N];
+  for (uint8_t i = 0; i < N; i++) {
+    kernel[i] = FilterTraits<C>::INTEGRAL ? C(uint32_t(data[1 + i]) * largest / 255) : C(data[1 + i] * (largest / 255));
+  }
+  return runFirTrial<T, C, N, RamStorage, S>(name, kernel, kernel, data, size);
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  randomSeed(42);      // Make the trials reproducible
+}
+
+void loop() {
+  size_t size = random(1 + DIFFERENTIAL_TAPS, sizeof(trial) + 1);  // Random number of samples
+  for (size_t i = 0; i < size; i++) {
+    trial[i] = random(0, 256);
+  }
+
+  // Random kernels in RAM, with the default accumulator and with narrow ones up to their limits
+  if (!runRamTrial<int16_t, uint16_t, 16, int64_t>("RAM-int16", 65535, trial, size))
+    failures++;
+  if (!runRamTrial<int16_t, uint16_t, 16, int32_t>("RAM-int16-acc32", 4096, trial, size))
+    failures++;
+  if (!runRamTrial<int8_t, uint8_t, 5, int16_t>("RAM-int8-acc16", 51, trial, size))
+    failures++;
+  if (!runRamTrial<uint16_t, uint8_t, 33, uint64_t>("RAM-uint16", 255, trial, size))
+    failures++;
+  if (!runRamTrial<int32_t, uint16_t, 8, int64_t>("RAM-int32", 65535, trial, size))
+    failures++;
+  if (!runRamTrial<float, float, 7, double>("RAM-float", 2.0f, trial, size))
+    failures++;
+
+  // Fixed kernels in program memory
+  if (!runFirTrial<int16_t, uint16_t, 15, ProgmemStorage, int32_t>("PROGMEM-binomial-acc32", binomial_flash.coefficients, binomial_ram.coefficients, trial, size))
+    failures++;
+  if (!runFirTrial<int16_t, uint16_t, 2, ProgmemStorage, int32_t>("PROGMEM-edge-acc32", edge16_flash.coefficients, edge16_ram.coefficients, trial, size))
+    failures++;
+  if (!runFirTrial<int8_t, uint8_t, 2, ProgmemStorage, int16_t>("PROGMEM-edge-acc16", edge8_flash.coefficients, edge8_ram.coefficients, trial, size))
+    failures++;
+  if (!runFirTrial<float, float, 4, ProgmemStorage, double>("PROGMEM-float", decay_flash.coefficients, decay_ram.coefficients, trial, size))
+    failures++;
+  trials++;
+
+  if (trials % 100 == 0) {
+    Serial.print("Trials:");
+    Serial.print(trials);
+    Serial.print("\tFailures:");
+    Serial.print(failures);
+    Serial.print("\n");
+  }
+}
@@ -0,0 +1,219 @@
+/**
+ * @brief Compares the WindowHistory against scanning the newest data points.
+ *
+ * Random sample streams are added to histories one by one and in strided blocks, with a reset
+ * part way through, and after every data point or block the average, minimum and maximum of
+ * several windows are compared with those of the newest data points scanned from scratch. The
+ * windows include 1, the whole history and sizes beyond the data points available, so queries
+ * that wrap around the ring and trees over a history that is not a power of two are covered. The
+ * sums of the samples are exact, so all reads must match exactly. Every disagreement is printed,
+ * together with a running count of trials and failures.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <WindowHistory.h>
+
+#if defined(__AVR__)
+#define DIFFERENTIAL_SAMPLES 150
+#else
+#define DIFFERENTIAL_SAMPLES 600
+#endif
+
+uint8_t trial[3 + 2 * DIFFERENTIAL_SAMPLES];  // Header bytes followed by up to DIFFERENTIAL_SAMPLES samples
+uint32_t trials = 0;
+uint32_t failures = 0;
+
+/**
+ * @brief Average, minimum and maximum of the newest data points, computed by scanning them.
+ */
+template<typename T>
+struct ReferenceWindow {
+  T average;
+  T minimum;
+  T maximum;
+
+  /**
+   * @param samples The samples added since the last reset, oldest first.
+   * @param count The number of samples added since the last reset, at least 1.
+   * @param length The number of newest samples in the window, at least 1 and at most count.
+   */
+  ReferenceWindow(const T* samples, size_t count, size_t length) {
+    typename FilterTraits<T>::Total sum = 0;
+    this->minimum = samples[count - 1];
+    this->maximum = samples[count - 1];
+    for (size_t i = count - length; i < count; i++) {
+      sum += samples[i];
+      this->minimum = samples[i] < this->minimum ? samples[i] : this->minimum;
+      this->maximum = samples[i] > this->maximum ? samples[i] : this->maximum;
+    }
+    this->average = T(sum / typename FilterTraits<T>::Total(length));
+  }
+};
+
+/**
+ * @brief Compares the reads of several windows with the reference.
+ *
+ * @param path The path that fed the history, printed with a mismatch.
+ * @param history The history.
+ * @param samples The samples added since the last reset, oldest first.
+ * @param count The number of samples added since the last reset, at least 1.
+ * @param windows The window sizes to check.
+ * @param num_windows The number of window sizes.
+ * @return True if every read and the size agree, false otherwise.
+ */
+template<typename T, uint16_t N>
+bool windowsAgree(const char* path, const WindowHistory<T, N>& history, const T* samples, size_t count, const uint16_t* windows, uint8_t num_windows) {
+  size_t available = count < N ? count : N;
+  for (uint8_t w = 0; w < num_windows; w++) {
+    size_t length = windows[w] < available ? windows[w] : available;
+    ReferenceWindow<T> reference(samples, count, length);
+    T average = history.readAverage(windows[w]);
+    T minimum = history.readMinimum(windows[w]);
+    T maximum = history.readMaximum(windows[w]);
+    if (average == reference.average && minimum == reference.minimum && maximum == reference.maximum && history.size() == available)
+      continue;
+
+    Serial.print("Mismatch:");
+    Serial.print(path);
+    Serial.print("\tsample:");
+    Serial.print(count);
+    Serial.print("\thistory:");
+    Serial.print(N);
+    Serial.print("\twindow:");
+    Serial.print(windows[w]);
+    Serial.print("\texpected:");
+    Serial.print(reference.average);
+    Serial.print(",");
+    Serial.print(reference.minimum);
+    Serial.print(",");
+    Serial.print(reference.maximum);
+    Serial.print("\tactual:");
+    Serial.print(average);
+    Serial.print(",");
+    Serial.print(minimum);
+    Serial.print(",");
+    Serial.print(maximum);
+    Serial.print("\n");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Runs one trial.
+ *
+ * Layout of the buffer:
+ * - byte 0: low 2 bits + 1 are the stride of the batch path, the upper bits modulo 32 + 1 its
+ *   block length.
+ * - byte 1: low nibble right-shifts the samples to narrow their range and produce ties, high
+ *   nibble times 16 is the sample after which both histories are reset, none if 0.
+ * - byte 2: a window size, modulo N plus 1; its half is checked as well.
+ * - remaining byte pairs: the samples, signed 16-bit, offset to be positive for unsigned types and
+ *   scaled to quarters for floating point types.
+ *
+ * @tparam T The data type of the history.
+ * @tparam N The number of data points in the history.
+ * @param data The encoded trial.
+ * @param size The number of bytes in the buffer.
+ * @return True if both paths agreed with the reference throughout, false otherwise.
+ */
+template<typename T, uint16_t N>
+bool runHistoryTrial(const uint8_t* data, size_t size) {
+  if (size < 5)
+    return true;
+
+  size_t stride = (data[0] & 0x03) + 1;
+  size_t block = (data[0] >> 2) % 32 + 1;
+  uint8_t shift = data[1] & 0x0F;
+  size_t reset_at = (data[1] >> 4) * 16;
+  uint16_t window = data[2] % N + 1;
+  const uint16_t windows[] = { 1, window, uint16_t(window / 2 + 1), N, uint16_t(N + 7) };
+
+  size_t count = (size - 3) / 2;
+  T* samples = new T[count];
+  T* interleaved = new T[count * stride];
+  for (size_t i = 0; i < count; i++) {
+    int16_t value = int16_t(data[3 + 2 * i] | data[4 + 2 * i] << 8) >> shift;
+    if (!FilterTraits<T>::INTEGRAL)
+      samples[i] = T(value / 4.0);
+    else if (T(-1) > T(0))
+      samples[i] = T(int32_t(value) + 32768);
+    else
+      samples[i] = T(value);
+    for (size_t channel = 0; channel < stride; channel++) {
+      interleaved[i * stride + channel] = channel == 0 ? samples[i] : T(0);
+    }
+  }
+
+  WindowHistory<T, N>* single = new WindowHistory<T, N>();
+  WindowHistory<T, N>* batch = new WindowHistory<T, N>();
+  single->begin();
+  batch->begin();
+
+  bool agreed = true;
+  size_t start = 0;
+  for (size_t i = 0; i < count && agreed; i++) {
+    single->add(samples[i]);
+    agreed = windowsAgree("add", *single, samples + start, i + 1 - start, windows, 5);
+    if (i + 1 == reset_at) {
+      single->reset();
+      start = i + 1;
+    }
+  }
+
+  start = 0;
+  for (size_t i = 0; i < count && agreed;) {
+    size_t end = i + block < count ? i + block : count;
+    if (i < reset_at && end > reset_at)
+      end = reset_at;
+    batch->addBatch(interleaved + i * stride, end - i, stride);
+    agreed = windowsAgree("addBatch", *batch, samples + start, end - start, windows, 5);
+    if (end == reset_at) {
+      batch->reset();
+      start = end;
+    }
+    i = end;
+  }
+
+  delete single;
+  delete batch;
+  delete[] samples;
+  delete[] interleaved;
+  return agreed;
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  randomSeed(42);      // Make the trials reproducible
+}
+
+void loop() {
+  size_t size = random(3, sizeof(trial) + 1);  // Random number of samples
+  for (size_t i = 0; i < size; i++) {
+    trial[i] = random(0, 256);
+  }
+
+  // Run the same trial for several types and histories of power of two and other sizes
+  if (!runHistoryTrial<int16_t, 64>(trial, size))
+    failures++;
+  if (!runHistoryTrial<int16_t, 37>(trial, size))
+    failures++;
+  if (!runHistoryTrial<uint16_t, 100>(trial, size))
+    failures++;
+  if (!runHistoryTrial<int32_t, 2>(trial, size))
+    failures++;
+  if (!runHistoryTrial<float, 50>(trial, size))
+    failures++;
+  trials++;
+
+  if (trials % 100 == 0) {
+    Serial.print("Trials:");
+    Serial.print(trials);
+    Serial.print("\tFailures:");
+    Serial.print(failures);
+    Serial.print("\n");
+  }
+}
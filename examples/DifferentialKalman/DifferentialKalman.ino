@@ -0,0 +1,186 @@
+/**
+ * @brief Compares the Kalman filters against double precision references.
+ *
+ * Random trials with random noise ratios and sample streams are run through KalmanFilter and
+ * KalmanVelocityFilter and through the textbook predict and update equations in double, which
+ * keep tracking the covariance instead of freezing the gains at their steady state. Signed,
+ * unsigned and floating point types are checked, as unsigned estimates must fall as well as rise.
+ * Every disagreement is printed, together with a running count of trials and failures.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <KalmanFilter.h>
+
+uint8_t trial[2 + 2 * 300];  // Header bytes followed by up to 300 samples
+uint32_t trials = 0;
+uint32_t failures = 0;
+
+/**
+ * @brief Random walk Kalman filter in double.
+ */
+struct ReferenceKalman {
+  double estimate;
+  double variance;
+
+  void add(double input, double process_noise, double measurement_noise, bool first) {
+    if (first) {
+      this->estimate = input;
+      this->variance = measurement_noise;
+      return;
+    }
+    double predicted = this->variance + process_noise;
+    double gain = predicted / (predicted + measurement_noise);
+    this->estimate += gain * (input - this->estimate);
+    this->variance = (1 - gain) * predicted;
+  }
+};
+
+/**
+ * @brief Constant velocity Kalman filter in double.
+ */
+struct ReferenceVelocityKalman {
+  double position;
+  double velocity;
+  double p[3];  // Position variance, covariance, velocity variance
+
+  void add(double input, double acceleration_noise, double measurement_noise, bool first) {
+    if (first) {
+      this->position = input;
+      this->velocity = 0;
+      this->p[0] = measurement_noise;
+      this->p[1] = 0;
+      this->p[2] = measurement_noise;
+      return;
+    }
+    double p00 = this->p[0] + 2 * this->p[1] + this->p[2] + acceleration_noise / 4;
+    double p01 = this->p[1] + this->p[2] + acceleration_noise / 2;
+    double p11 = this->p[2] + acceleration_noise;
+    double innovation = p00 + measurement_noise;
+    double position_gain = p00 / innovation;
+    double velocity_gain = p01 / innovation;
+
+    this->position += this->velocity;
+    double residual = input - this->position;
+    this->position += position_gain * residual;
+    this->velocity += velocity_gain * residual;
+    this->p[0] = (1 - position_gain) * p00;
+    this->p[1] = (1 - position_gain) * p01;
+    this->p[2] = p11 - velocity_gain * p01;
+  }
+};
+
+/**
+ * @brief Checks an output against its reference and prints a mismatch.
+ *
+ * The filters freeze their gains once they change by less than 1e-5 and round them to Q15, so
+ * the outputs may differ by 1 plus 0.2 % of the range of the samples.
+ */
+bool agrees(const char* output, uint16_t sample, double expected, double actual, double range) {
+  double difference = actual > expected ? actual - expected : expected - actual;
+  if (difference <= 1 + 2e-3 * range)
+    return true;
+
+  Serial.print("Mismatch:");
+  Serial.print(output);
+  Serial.print("\tsample:");
+  Serial.print(sample);
+  Serial.print("\texpected:");
+  Serial.print(expected);
+  Serial.print("\tactual:");
+  Serial.print(actual);
+  Serial.print("\n");
+  return false;
+}
+
+/**
+ * @brief Runs one trial.
+ *
+ * Layout of the buffer:
+ * - byte 0: the process noise is 2^-(byte 0 % 13) times the measurement noise of 1.
+ * - byte 1: low nibble right-shifts the samples to narrow their range.
+ * - remaining byte pairs: the samples, offset to be centred around 0 for signed types.
+ *
+ * @tparam T The data type for input values.
+ * @tparam U The data type for filtered values.
+ * @param data The encoded trial.
+ * @param size The number of bytes in the buffer.
+ * @return True if the filters agreed with the references after every sample, false otherwise.
+ */
+template<typename T, typename U>
+bool runKalmanTrial(const uint8_t* data, size_t size) {
+  if (size < 2)
+    return true;
+
+  float process_noise = ldexp(1.0, -(data[0] % 13));
+  uint8_t shift = data[1] & 0x0F;
+  bool signed_type = T(-1) < T(0);
+  int32_t offset = signed_type ? 0x8000L >> shift : 0;
+  double range = double(0xFFFFL >> shift);
+
+  KalmanFilter<T, U> filter;
+  KalmanVelocityFilter<T, U> velocity_filter;
+  ReferenceKalman reference = {};
+  ReferenceVelocityKalman velocity_reference = {};
+  filter.begin();
+  filter.setNoise(process_noise, 1);
+  velocity_filter.begin();
+  velocity_filter.setNoise(process_noise, 1);
+
+  uint16_t sample = 0;
+  for (size_t i = 2; i + 1 < size; i += 2, sample++) {
+    T input = T(int32_t(uint16_t(data[i] | data[i + 1] << 8) >> shift) - offset);
+    filter.add(input);
+    velocity_filter.add(input);
+    reference.add(double(input), process_noise, 1, sample == 0);
+    velocity_reference.add(double(input), process_noise, 1, sample == 0);
+
+    if (!agrees("KF", sample, reference.estimate, double(filter.read()), range))
+      return false;
+
+    // The constant velocity model overshoots the samples, which 16-bit types only read back inside
+    // the range of the samples, and falling velocities wrap for unsigned types
+    double position = velocity_reference.position + offset;
+    if (position > -0.5 && position < range + 0.5 && !agrees("KF-Position", sample, velocity_reference.position, double(velocity_filter.read()), range))
+      return false;
+    if (signed_type && !agrees("KF-Velocity", sample, velocity_reference.velocity, double(velocity_filter.readVelocity()), range))
+      return false;
+  }
+
+  return true;
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  randomSeed(42);      // Make the trials reproducible
+}
+
+void loop() {
+  size_t size = random(2, sizeof(trial) + 1);  // Random number of samples
+  for (size_t i = 0; i < size; i++) {
+    trial[i] = random(0, 256);
+  }
+
+  // Run the same trial for signed, unsigned and floating point filters
+  if (!runKalmanTrial<int16_t, int16_t>(trial, size))
+    failures++;
+  if (!runKalmanTrial<uint16_t, uint16_t>(trial, size))
+    failures++;
+  if (!runKalmanTrial<int32_t, int32_t>(trial, size))
+    failures++;
+  if (!runKalmanTrial<uint32_t, uint32_t>(trial, size))
+    failures++;
+  if (!runKalmanTrial<float, float>(trial, size))
+    failures++;
+  trials++;
+
+  if (trials % 100 == 0) {
+    Serial.print("Trials:");
+    Serial.print(trials);
+    Serial.print("\tFailures:");
+    Serial.print(failures);
+    Serial.print("\n");
+  }
+}
@@ -0,0 +1,289 @@
+/**
+ * @brief Compares the lock-free queues against a plain FIFO reference.
+ *
+ * Random sequences of push, pop, batch and drain operations are run through SpscQueue and
+ * MpscQueue, with both counter backends, and through a reference that shifts its array on every
+ * pop. The items are consecutive numbers, so every success, count and popped item must match and
+ * any reordering, loss or duplication is a mismatch. The sequences are long enough for the
+ * positions of 8-bit counters to wrap. Every disagreement is printed, together with a running
+ * count of trials and failures.
+ *
+ * On a host with threads, define DIFFERENTIALQUEUE_THREADS to also run one producer thread per
+ * SpscQueue and three per MpscQueue against a consumer that checks the order of every producer.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <BoundedQueue.h>
+
+#if defined(DIFFERENTIALQUEUE_THREADS)
+#include <thread>
+#endif
+
+#define DIFFERENTIAL_QUEUE 16
+
+uint8_t trial[768];  // One operation per byte
+uint32_t trials = 0;
+uint32_t failures = 0;
+
+/**
+ * @brief FIFO reference that shifts its items on every pop.
+ */
+struct ReferenceQueue {
+  uint16_t items[DIFFERENTIAL_QUEUE];
+  size_t count;
+
+  bool push(uint16_t item) {
+    if (this->count == DIFFERENTIAL_QUEUE)
+      return false;
+    this->items[this->count++] = item;
+    return true;
+  }
+
+  bool pop(uint16_t& item) {
+    if (this->count == 0)
+      return false;
+    item = this->items[0];
+    for (size_t i = 1; i < this->count; i++) {
+      this->items[i - 1] = this->items[i];
+    }
+    this->count--;
+    return true;
+  }
+};
+
+/**
+ * @brief Filter stand-in that records the items drained into it.
+ */
+struct DrainRecorder {
+  uint16_t items[DIFFERENTIAL_QUEUE];
+  size_t count;
+
+  void addBatch(const uint16_t* samples, size_t n, size_t stride = 1) {
+    for (size_t i = 0; i < n; i++) {
+      this->items[this->count++] = samples[i * stride];
+    }
+  }
+};
+
+/**
+ * @brief Drains into a recorder with drainInto(), which only the SpscQueue offers.
+ */
+template<size_t N, typename C>
+size_t drain(SpscQueue<uint16_t, N, C>& queue, DrainRecorder& recorder, size_t n) {
+  return queue.drainInto(recorder, n);
+}
+
+/**
+ * @brief Drains into a recorder with popBatch().
+ */
+template<size_t N, typename C>
+size_t drain(MpscQueue<uint16_t, N, C>& queue, DrainRecorder& recorder, size_t n) {
+  size_t popped = queue.popBatch(recorder.items, n);
+  recorder.count = popped;
+  return popped;
+}
+
+/**
+ * @brief Compares size() and empty(), which only the SpscQueue offers.
+ */
+template<size_t N, typename C>
+bool sizeAgrees(const SpscQueue<uint16_t, N, C>& queue, size_t expected) {
+  return queue.size() == expected && queue.empty() == (expected == 0);
+}
+
+template<size_t N, typename C>
+bool sizeAgrees(const MpscQueue<uint16_t, N, C>&, size_t) {
+  return true;
+}
+
+/**
+ * @brief Prints a mismatch between the queue and the reference.
+ */
+void printMismatch(const char* name, const char* operation, size_t step, size_t expected, size_t actual) {
+  Serial.print("Mismatch:");
+  Serial.print(name);
+  Serial.print("\t");
+  Serial.print(operation);
+  Serial.print("\tstep:");
+  Serial.print(step);
+  Serial.print("\texpected:");
+  Serial.print(expected);
+  Serial.print("\tactual:");
+  Serial.print(actual);
+  Serial.print("\n");
+}
+
+/**
+ * @brief Runs one trial.
+ *
+ * Every byte is an operation, picked by its low 3 bits: 0-1 push, 2 pushBatch, 3-4 pop,
+ * 5 popBatch, 6 drain, 7 a push that is immediately popped again. The upper 5 bits + 1 are the
+ * batch length, up to twice the capacity.
+ *
+ * @tparam Q The queue type, holding uint16_t items with a capacity of DIFFERENTIAL_QUEUE.
+ * @param name The name printed with a mismatch.
+ * @param data The encoded trial.
+ * @param size The number of bytes in the buffer.
+ * @return True if the queue agreed with the reference after every operation, false otherwise.
+ */
+template<typename Q>
+bool runQueueTrial(const char* name, const uint8_t* data, size_t size) {
+  Q queue;
+  ReferenceQueue reference = {};
+  uint16_t next_item = 0;
+  bool agreed = true;
+
+  for (size_t step = 0; step < size && agreed; step++) {
+    uint8_t operation = data[step] & 0x07;
+    size_t length = (data[step] >> 3) % (2 * DIFFERENTIAL_QUEUE) + 1;
+    uint16_t batch[2 * DIFFERENTIAL_QUEUE];
+
+    if (operation <= 1 || operation == 7) {
+      bool expected = reference.push(next_item);
+      bool actual = queue.push(next_item);
+      next_item++;
+      if (expected != actual) {
+        printMismatch(name, "push", step, expected, actual);
+        agreed = false;
+      }
+    } else if (operation == 2) {
+      size_t expected = 0;
+      for (size_t i = 0; i < length; i++) {
+        batch[i] = uint16_t(next_item + i);
+        expected += reference.push(batch[i]);
+      }
+      size_t actual = queue.pushBatch(batch, length);
+      next_item += uint16_t(actual);
+      if (expected != actual) {
+        printMismatch(name, "pushBatch", step, expected, actual);
+        agreed = false;
+      }
+    }
+
+    if (agreed && (operation == 3 || operation == 4 || operation == 7)) {
+      uint16_t expected = 0xFFFF;
+      uint16_t actual = 0xFFFF;
+      bool expected_popped = reference.pop(expected);
+      bool actual_popped = queue.pop(actual);
+      if (expected_popped != actual_popped || expected != actual) {
+        printMismatch(name, "pop", step, expected, actual);
+        agreed = false;
+      }
+    } else if (agreed && (operation == 5 || operation == 6)) {
+      DrainRecorder recorder = {};
+      size_t n = length < DIFFERENTIAL_QUEUE ? length : DIFFERENTIAL_QUEUE;
+      size_t actual = operation == 5 ? queue.popBatch(recorder.items, n) : drain(queue, recorder, n);
+      size_t expected = 0;
+      for (uint16_t item; expected < n && reference.pop(item); expected++) {
+        if (agreed && recorder.items[expected] != item) {
+          printMismatch(name, operation == 5 ? "popBatch item" : "drain item", step, item, recorder.items[expected]);
+          agreed = false;
+        }
+      }
+      if (agreed && expected != actual) {
+        printMismatch(name, operation == 5 ? "popBatch" : "drain", step, expected, actual);
+        agreed = false;
+      }
+    }
+
+    if (agreed && !sizeAgrees(queue, reference.count)) {
+      printMismatch(name, "size", step, reference.count, 0);
+      agreed = false;
+    }
+  }
+
+  return agreed;
+}
+
+#if defined(DIFFERENTIALQUEUE_THREADS)
+/**
+ * @brief Streams numbered items from producer threads through a queue and checks their order.
+ *
+ * Each producer pushes its id in the upper byte and a running number in the lower 24 bits,
+ * yielding while the queue is full. The consumer requires the numbers of every producer to arrive
+ * consecutively and all items to arrive exactly once.
+ *
+ * @tparam Q The queue type, holding uint32_t items.
+ * @param name The name printed with the result.
+ * @param producers The number of producer threads, at most 4.
+ * @return True if every item arrived once and in order, false otherwise.
+ */
+template<typename Q>
+bool runThreadTrial(const char* name, uint8_t producers) {
+  const uint32_t items = 200000;
+  static Q queue;
+  std::thread threads[4];
+  for (uint8_t id = 0; id < producers; id++) {
+    threads[id] = std::thread([id, items]() {
+      for (uint32_t i = 0; i < items; i++) {
+        while (!queue.push(uint32_t(id) << 24 | i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  uint32_t expected[4] = {};
+  bool ordered = true;
+  for (uint32_t received = 0; received < items * producers;) {
+    uint32_t item;
+    if (!queue.pop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    uint8_t id = item >> 24;
+    ordered = ordered && id < producers && (item & 0xFFFFFF) == expected[id];
+    expected[id]++;
+    received++;
+  }
+  for (uint8_t id = 0; id < producers; id++) {
+    threads[id].join();
+  }
+
+  Serial.print("Threads:");
+  Serial.print(name);
+  Serial.print(ordered ? "\tordered\n" : "\tout of order\n");
+  return ordered;
+}
+#endif
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  randomSeed(42);      // Make the trials reproducible
+
+#if defined(DIFFERENTIALQUEUE_THREADS)
+  if (!runThreadTrial<SpscQueue<uint32_t, 64>>("SPSC", 1))
+    failures++;
+  if (!runThreadTrial<MpscQueue<uint32_t, 64>>("MPSC", 3))
+    failures++;
+#endif
+}
+
+void loop() {
+  size_t size = random(1, sizeof(trial) + 1);  // Random number of operations
+  for (size_t i = 0; i < size; i++) {
+    trial[i] = random(0, 256);
+  }
+
+  // Run the same trial for both queues and both counter backends
+  if (!runQueueTrial<SpscQueue<uint16_t, DIFFERENTIAL_QUEUE>>("SPSC", trial, size))
+    failures++;
+  if (!runQueueTrial<SpscQueue<uint16_t, DIFFERENTIAL_QUEUE, VolatileCounter<uint8_t>>>("SPSC-Volatile", trial, size))
+    failures++;
+  if (!runQueueTrial<MpscQueue<uint16_t, DIFFERENTIAL_QUEUE>>("MPSC", trial, size))
+    failures++;
+  if (!runQueueTrial<MpscQueue<uint16_t, DIFFERENTIAL_QUEUE, VolatileCounter<uint8_t>>>("MPSC-Volatile", trial, size))
+    failures++;
+  trials++;
+
+  if (trials % 100 == 0) {
+    Serial.print("Trials:");
+    Serial.print(trials);
+    Serial.print("\tFailures:");
+    Serial.print(failures);
+    Serial.print("\n");
+  }
+}
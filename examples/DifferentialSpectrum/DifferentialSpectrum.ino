@@ -0,0 +1,212 @@
+/**
+ * @brief Compares the SlidingDft bins against the Goertzel algorithm over the window.
+ *
+ * Random sample streams are added to a MovingAverage with attached bins, one by one or in blocks,
+ * and after every data point or block the magnitude and phase of each bin are compared with the
+ * Goertzel algorithm in double precision over the data points of the window, oldest first. The
+ * Goertzel output of the last data point carries its phase, so it checks the rotation of the sums
+ * to the newest data point as well as their updates, the restart of the phasors when the ring
+ * wraps, attaching to a filled ring and the recomputation of floating point bins. Every
+ * disagreement is printed, together with a running count of trials and failures.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+*/
+
+#include <MovingAverage.h>
+
+#if defined(__AVR__)
+#define DIFFERENTIAL_SAMPLES 150
+#else
+#define DIFFERENTIAL_SAMPLES 600
+#endif
+
+#define DIFFERENTIAL_BINS 3
+
+uint8_t trial[5 + 2 * DIFFERENTIAL_SAMPLES];  // Header bytes followed by up to DIFFERENTIAL_SAMPLES samples
+double history[DIFFERENTIAL_SAMPLES];         // Every sample of the trial, oldest first
+uint32_t trials = 0;
+uint32_t failures = 0;
+
+/**
+ * @brief Amplitude and phase of one bin of the window, computed with the Goertzel algorithm.
+ */
+struct ReferenceBin {
+  double magnitude;
+  double phase;
+
+  /**
+   * @param count The number of samples added so far.
+   * @param length The length of the window N.
+   * @param index The bin index k, reduced modulo N.
+   */
+  ReferenceBin(size_t count, size_t length, size_t index) {
+    size_t first = count > length ? count - length : 0;
+    double omega = 2.0 * M_PI * double(index) / double(length);
+    double coefficient = 2.0 * cos(omega);
+    double s1 = 0;
+    double s2 = 0;
+    for (size_t i = first; i < count; i++) {
+      double s0 = history[i] + coefficient * s1 - s2;
+      s2 = s1;
+      s1 = s0;
+    }
+
+    // s1 - e^(-i omega) s2 is the DFT sum rotated to the newest data point, missing ones count as 0
+    double re = s1 - cos(omega) * s2;
+    double im = sin(omega) * s2;
+    double scale = index == 0 || 2 * index == length ? 1.0 : 2.0;
+    this->magnitude = scale * sqrt(re * re + im * im) / double(length);
+    this->phase = atan2(im, re);
+  }
+};
+
+/**
+ * @brief Compares every bin with the reference.
+ *
+ * The magnitude must agree within a small fraction of the range of the samples. The phase is only
+ * compared for bins of at least a twentieth of the range, below that it is dominated by rounding.
+ *
+ * @param path The path that fed the filter, printed with a mismatch.
+ * @param spectrum The bins.
+ * @param bins The bin indices passed to the constructor.
+ * @param length The length of the window N.
+ * @param count The number of samples added so far.
+ * @param range The largest magnitude of a sample.
+ * @return True if all bins agree, false otherwise.
+ */
+template<typename U>
+bool binsAgree(const char* path, const SlidingDft<U>& spectrum, const uint32_t* bins, size_t length, size_t count, double range) {
+  for (uint8_t b = 0; b < DIFFERENTIAL_BINS; b++) {
+    ReferenceBin reference(count, length, bins[b] % length);
+    double magnitude = spectrum.readMagnitude(b);
+    double phase = spectrum.readPhase(b);
+    double phase_error = fabs(phase - reference.phase);
+    if (phase_error > M_PI)
+      phase_error = 2 * M_PI - phase_error;
+
+    bool magnitude_agrees = fabs(magnitude - reference.magnitude) <= 1e-4 * range + 1e-6;
+    bool phase_agrees = reference.magnitude < 0.05 * range || phase_error <= 1e-2;
+    if (magnitude_agrees && phase_agrees)
+      continue;
+
+    Serial.print("Mismatch:");
+    Serial.print(path);
+    Serial.print("\tsample:");
+    Serial.print(count);
+    Serial.print("\twindow:");
+    Serial.print(length);
+    Serial.print("\tbin:");
+    Serial.print(bins[b] % length);
+    Serial.print("\texpected:");
+    Serial.print(reference.magnitude);
+    Serial.print(",");
+    Serial.print(reference.phase);
+    Serial.print("\tactual:");
+    Serial.print(magnitude);
+    Serial.print(",");
+    Serial.print(phase);
+    Serial.print("\n");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Runs one trial.
+ *
+ * Layout of the buffer:
+ * - byte 0: window size, at least 1.
+ * - byte 1: low nibble right-shifts the samples to narrow their range, high nibble times 8 is
+ *   the number of samples added before the bins are attached.
+ * - byte 2: block length of the batch path, modulo 64, plus 1.
+ * - bytes 3-4: two bin indices, the third bin is 1.
+ * - remaining byte pairs: the samples, signed 16-bit, scaled to quarters for floating point types.
+ *
+ * @tparam U The data type of the filter and the bins.
+ * @param data The encoded trial.
+ * @param size The number of bytes in the buffer.
+ * @return True if both paths agreed with the reference throughout, false otherwise.
+ */
+template<typename U>
+bool runSpectrumTrial(const uint8_t* data, size_t size) {
+  if (size < 7)
+    return true;
+
+  uint8_t window_size = data[0] > 0 ? data[0] : 1;
+  uint8_t shift = data[1] & 0x0F;
+  size_t attach_at = (data[1] >> 4) * 8;
+  size_t block = data[2] % 64 + 1;
+  const uint32_t bins[DIFFERENTIAL_BINS] = { data[3], data[4], 1 };
+
+  size_t count = (size - 5) / 2;
+  U* samples = new U[count];
+  double range = 0;
+  for (size_t i = 0; i < count; i++) {
+    int16_t value = int16_t(data[5 + 2 * i] | data[6 + 2 * i] << 8) >> shift;
+    samples[i] = FilterTraits<U>::INTEGRAL ? U(value) : U(value / 4.0);
+    history[i] = double(samples[i]);
+    range = fabs(history[i]) > range ? fabs(history[i]) : range;
+  }
+
+  MovingAverage<U, U>* filter = new MovingAverage<U, U>();
+  SlidingDft<U>* spectrum = new SlidingDft<U>(bins, DIFFERENTIAL_BINS);
+  filter->begin();
+  filter->reconfigure(window_size);
+
+  // One data point at a time, attached after the first samples; the windowed read moves the data
+  // point into the ring
+  bool agreed = true;
+  for (size_t i = 0; i < count && agreed; i++) {
+    filter->add(samples[i]);
+    filter->readAverage(window_size);
+    if (i + 1 == attach_at || (i == 0 && attach_at == 0))
+      filter->attach(spectrum);
+    if (i + 1 >= attach_at)
+      agreed = binsAgree("add", *spectrum, bins, window_size, i + 1, range);
+  }
+
+  // In blocks, attached to an empty filter
+  filter->reset();
+  filter->attach(spectrum);
+  for (size_t i = 0; i < count && agreed; i += block) {
+    size_t n = count - i < block ? count - i : block;
+    filter->addBatch(samples + i, n);
+    agreed = binsAgree("addBatch", *spectrum, bins, window_size, i + n, range);
+  }
+
+  delete filter;
+  delete spectrum;
+  delete[] samples;
+  return agreed;
+}
+
+void setup() {
+  Serial.begin(9600);  // Initialize serial communication
+  randomSeed(42);      // Make the trials reproducible
+}
+
+void loop() {
+  size_t size = random(5, sizeof(trial) + 1);  // Random number of samples
+  for (size_t i = 0; i < size; i++) {
+    trial[i] = random(0, 256);
+  }
+
+  // Run the same trial for fixed point, float and double bins
+  if (!runSpectrumTrial<int16_t>(trial, size))
+    failures++;
+  if (!runSpectrumTrial<float>(trial, size))
+    failures++;
+  if (!runSpectrumTrial<int32_t>(trial, size))
+    failures++;
+  trials++;
+
+  if (trials % 100 == 0) {
+    Serial.print("Trials:");
+    Serial.print(trials);
+    Serial.print("\tFailures:");
+    Serial.print(failures);
+    Serial.print("\n");
+  }
+}
@@ -0,0 +1,615 @@
+/**
+ * @file BlockedOrderStatistic.h
+ *
+ * @brief Cache-friendly order statistic container made of sorted blocks.
+ *
+ * This header provides a `BlockedOrderStatistic` class template with the interface of the
+ * `SkipList`, as an alternative order statistic index for large windows. Values are kept in sorted
+ * leaf blocks of up to B values stored contiguously in a fixed pool, and a directory holds the
+ * blocks in order together with the prefix counts and sums of the blocks. A query binary-searches
+ * the directory, which touches a few cache lines even for thousands of values, and then works
+ * inside a single block, while a skip list follows a link per step.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef BLOCKEDORDERSTATISTIC_H
+#define BLOCKEDORDERSTATISTIC_H
+
+#include <stdint.h>
+#include "FilterTraits.h"
+
+/**
+ * @brief Sorted multiset of values in blocks, indexable by rank.
+ *
+ * A two-level B+-tree: the blocks are the leaves, and the inner level is the directory of block
+ * ids in sorted order, the largest value of every block and two Fenwick trees over the directory
+ * positions holding the counts and the sums of the blocks. Locating a value binary-searches the
+ * largest values, locating a rank or a prefix sum descends the Fenwick trees, both in
+ * O(log(n / B)), and the work inside a block costs O(B). Inserting into a full block splits it in
+ * halves. A block that drops below half full is merged with a neighbour if both fit into one block,
+ * otherwise the two share their values evenly, so every block is at least half full and the pool
+ * of 2 n / B + 1 blocks allocated by the constructor always suffices. Only these structural changes
+ * move directory entries and rebuild the trees, in O(n / B), which is no more than the O(B) work
+ * inside a block for windows of up to B^2 values.
+ *
+ * @tparam T The data type of the values.
+ * @tparam B The capacity of a block, 4 to 255.
+ * @tparam S The data type of the block sums (default: the Sum type of FilterTraits).
+ */
+template<typename T, uint8_t B = 64, typename S = typename FilterTraits<T>::Sum>
+class BlockedOrderStatistic {
+public:
+  typedef S Sum;
+
+  static_assert(B >= 4, "A block must hold at least 4 values");
+
+  explicit BlockedOrderStatistic(int capacity);
+  ~BlockedOrderStatistic();
+
+  static BlockedOrderStatistic* forWindow(int window_size);
+
+  void insert(T val);
+  bool remove(T val);
+  void clear();
+  void build(const T* sorted, int number);
+  T getMedian() const;
+  bool at(int index, T& value) const;
+  int rankOf(T val) const;
+  int size() const;
+  Sum sumSmallest(int number) const;
+
+  BlockedOrderStatistic(const BlockedOrderStatistic&) = delete;
+  BlockedOrderStatistic& operator=(const BlockedOrderStatistic&) = delete;
+
+private:
+  struct Block {
+    T values[B];
+  };
+
+  Block* pool;
+  uint8_t* counts;  // Number of values of every block, by block id
+  Sum* sums;        // Sum of the values of every block, by block id
+  int* spare;       // Stack of unused block ids
+  int* order;       // Block ids in ascending order of their values, by position
+  T* lasts;         // Largest value of every block, by position
+  int* count_tree;  // Fenwick tree of the block counts, by position + 1
+  Sum* sum_tree;    // Fenwick tree of the block sums, by position + 1
+  int capacity;
+  int max_blocks;
+  int num_blocks;
+  int num_spare;
+  int count;
+
+  int findBlock(T val) const;
+  int locate(int& rank, Sum* total) const;
+  static uint8_t lowerBound(const T* values, uint8_t length, T val);
+  void adjust(int position, int count_change, Sum sum_change);
+  void rebuildTrees();
+  void openPosition(int position);
+  void closePosition(int position);
+  void split(int position);
+  void rebalance(int position);
+};
+
+/**
+ * @brief Constructs an empty BlockedOrderStatistic object.
+ *
+ * Allocates the pool of blocks and the directory, the only allocation of the container.
+ *
+ * @param capacity The maximum number of values in the container.
+ */
+template<typename T, uint8_t B, typename S>
+BlockedOrderStatistic<T, B, S>::BlockedOrderStatistic(int capacity)
+  : capacity(capacity > 0 ? capacity : 1), num_blocks(0), num_spare(0), count(0) {
+  this->max_blocks = this->capacity / (B / 2) + 1;
+  this->pool = new Block[this->max_blocks];
+  this->counts = new uint8_t[this->max_blocks];
+  this->sums = new Sum[this->max_blocks];
+  this->spare = new int[this->max_blocks];
+  this->order = new int[this->max_blocks];
+  this->lasts = new T[this->max_blocks];
+  this->count_tree = new int[this->max_blocks + 1];
+  this->sum_tree = new Sum[this->max_blocks + 1];
+  this->clear();
+}
+
+/**
+ * @brief Destructs a BlockedOrderStatistic object.
+ */
+template<typename T, uint8_t B, typename S>
+BlockedOrderStatistic<T, B, S>::~BlockedOrderStatistic() {
+  delete[] this->pool;
+  delete[] this->counts;
+  delete[] this->sums;
+  delete[] this->spare;
+  delete[] this->order;
+  delete[] this->lasts;
+  delete[] this->count_tree;
+  delete[] this->sum_tree;
+}
+
+/**
+ * @brief Creates an empty container for a window.
+ *
+ * @param window_size The number of values the container will hold.
+ * @return The new container, to be released with delete.
+ */
+template<typename T, uint8_t B, typename S>
+BlockedOrderStatistic<T, B, S>* BlockedOrderStatistic<T, B, S>::forWindow(int window_size) {
+  return new BlockedOrderStatistic(window_size);
+}
+
+/**
+ * @brief Inserts a value, keeping duplicates.
+ *
+ * If the container already holds capacity values, the value is dropped.
+ *
+ * @param val The value to be inserted.
+ */
+template<typename T, uint8_t B, typename S>
+void BlockedOrderStatistic<T, B, S>::insert(T val) {
+  if (this->count == this->capacity)
+    return;
+
+  if (this->num_blocks == 0) {
+    this->openPosition(0);
+    this->lasts[0] = val;
+    this->rebuildTrees();
+  }
+
+  int position = this->findBlock(val);
+  if (position == this->num_blocks)
+    position--;
+
+  int block = this->order[position];
+  T* values = this->pool[block].values;
+  uint8_t index = this->counts[block];
+  while (index > 0 && val < values[index - 1]) {
+    values[index] = values[index - 1];
+    index--;
+  }
+  values[index] = val;
+
+  this->counts[block]++;
+  this->sums[block] += Sum(val);
+  this->lasts[position] = values[this->counts[block] - 1];
+  this->adjust(position, 1, Sum(val));
+  this->count++;
+
+  if (this->counts[block] == B)
+    this->split(position);
+}
+
+/**
+ * @brief Removes one occurrence of a value.
+ *
+ * @param val The value to be removed.
+ * @return True if the value was found and removed, false otherwise.
+ */
+template<typename T, uint8_t B, typename S>
+bool BlockedOrderStatistic<T, B, S>::remove(T val) {
+  int position = this->findBlock(val);
+  if (position == this->num_blocks)
+    return false;
+
+  int block = this->order[position];
+  T* values = this->pool[block].values;
+  uint8_t index = lowerBound(values, this->counts[block], val);
+  if (index == this->counts[block] || values[index] != val)
+    return false;
+
+  for (uint8_t i = index + 1; i < this->counts[block]; i++) {
+    values[i - 1] = values[i];
+  }
+  this->counts[block]--;
+  this->sums[block] -= Sum(val);
+  this->adjust(position, -1, -Sum(val));
+  this->count--;
+
+  if (this->counts[block] == 0 && this->num_blocks == 1) {
+    this->closePosition(0);
+    this->rebuildTrees();
+  } else {
+    if (this->counts[block] > 0)
+      this->lasts[position] = values[this->counts[block] - 1];
+    if (this->counts[block] < B / 2 && this->num_blocks > 1)
+      this->rebalance(position);
+  }
+  return true;
+}
+
+/**
+ * @brief Removes all values.
+ *
+ * Returns every block to the pool, in O(n / B).
+ */
+template<typename T, uint8_t B, typename S>
+void BlockedOrderStatistic<T, B, S>::clear() {
+  for (int block = 0; block < this->max_blocks; block++) {
+    this->spare[block] = this->max_blocks - 1 - block;
+  }
+  this->num_spare = this->max_blocks;
+  this->num_blocks = 0;
+  this->count = 0;
+  this->rebuildTrees();
+}
+
+/**
+ * @brief Replaces the contents by values in ascending order.
+ *
+ * Spreads the values evenly over blocks filled to about three quarters, leaving room for
+ * insertions before the first split, and builds the trees once. Costs O(n) instead of O(n B).
+ *
+ * @param sorted The values in ascending order.
+ * @param number The number of values, at most the capacity.
+ */
+template<typename T, uint8_t B, typename S>
+void BlockedOrderStatistic<T, B, S>::build(const T* sorted, int number) {
+  this->clear();
+  if (number > this->capacity)
+    number = this->capacity;
+  if (number <= 0)
+    return;
+
+  // As many blocks of three quarters as possible, but every block between half and not quite full
+  int blocks = (number + (B - B / 4) - 1) / (B - B / 4);
+  int most = number / (B / 2);
+  int fewest = (number + B - 2) / (B - 1);
+  blocks = blocks > most ? most : blocks;
+  blocks = blocks < fewest ? fewest : blocks;
+  blocks = blocks < 1 ? 1 : blocks;
+
+  int first = 0;
+  for (int position = 0; position < blocks; position++) {
+    int length = number / blocks + (position < number % blocks ? 1 : 0);
+    int block = this->spare[--this->num_spare];
+    T* values = this->pool[block].values;
+    Sum sum = 0;
+    for (int i = 0; i < length; i++) {
+      values[i] = sorted[first + i];
+      sum += Sum(values[i]);
+    }
+    first += length;
+    this->counts[block] = uint8_t(length);
+    this->sums[block] = sum;
+    this->order[position] = block;
+    this->lasts[position] = values[length - 1];
+  }
+  this->num_blocks = blocks;
+  this->count = number;
+  this->rebuildTrees();
+}
+
+/**
+ * @brief Retrieves the median value.
+ *
+ * For an even number of values, the upper of the two middle values is returned.
+ *
+ * @return The median value, or T() if the container is empty.
+ */
+template<typename T, uint8_t B, typename S>
+T BlockedOrderStatistic<T, B, S>::getMedian() const {
+  T median = T();
+  this->at(this->count / 2, median);
+  return median;
+}
+
+/**
+ * @brief Retrieves the value at the specified index.
+ *
+ * Descends the tree of counts to the block holding the index, in O(log(n / B)).
+ *
+ * @param index The index of the value to retrieve, 0 being the smallest value.
+ * @param value Receives the value at the specified index, unchanged if the index is out of range.
+ * @return True if the index is in range, false otherwise.
+ */
+template<typename T, uint8_t B, typename S>
+bool BlockedOrderStatistic<T, B, S>::at(int index, T& value) const {
+  if (index < 0 || index >= this->count)
+    return false;
+
+  int position = this->locate(index, nullptr);
+  value = this->pool[this->order[position]].values[index];
+  return true;
+}
+
+/**
+ * @brief Returns the rank of a value.
+ *
+ * Binary-searches the block, then the values inside it, and adds the prefix count of the block.
+ *
+ * @param val The value to rank, not necessarily in the container.
+ * @return The number of values smaller than val.
+ */
+template<typename T, uint8_t B, typename S>
+int BlockedOrderStatistic<T, B, S>::rankOf(T val) const {
+  int position = this->findBlock(val);
+  if (position == this->num_blocks)
+    return this->count;
+
+  int rank = 0;
+  for (int i = position; i > 0; i -= i & -i) {
+    rank += this->count_tree[i];
+  }
+  int block = this->order[position];
+  return rank + lowerBound(this->pool[block].values, this->counts[block], val);
+}
+
+/**
+ * @brief Returns the number of values.
+ *
+ * @return The number of values.
+ */
+template<typename T, uint8_t B, typename S>
+int BlockedOrderStatistic<T, B, S>::size() const {
+  return this->count;
+}
+
+/**
+ * @brief Sums the smallest values.
+ *
+ * Descends the trees of counts and sums to the block holding the rank, in O(log(n / B)), and adds
+ * the values of that block below the rank.
+ *
+ * @param number The number of smallest values to sum, clamped to the size.
+ * @return The sum of the smallest values.
+ */
+template<typename T, uint8_t B, typename S>
+typename BlockedOrderStatistic<T, B, S>::Sum BlockedOrderStatistic<T, B, S>::sumSmallest(int number) const {
+  if (number <= 0)
+    return 0;
+  if (number > this->count)
+    number = this->count;
+
+  Sum total = 0;
+  int position = this->locate(number, &total);
+  if (position < this->num_blocks) {
+    const T* values = this->pool[this->order[position]].values;
+    for (int i = 0; i < number; i++) {
+      total += Sum(values[i]);
+    }
+  }
+  return total;
+}
+
+/**
+ * @brief Finds the first block whose largest value is not less than a value.
+ *
+ * Binary search over the directory of largest values.
+ *
+ * @param val The value to locate.
+ * @return The position of the block, or the number of blocks if all values are smaller.
+ */
+template<typename T, uint8_t B, typename S>
+int BlockedOrderStatistic<T, B, S>::findBlock(T val) const {
+  int low = 0;
+  int high = this->num_blocks;
+  while (low < high) {
+    int middle = (low + high) / 2;
+    if (this->lasts[middle] < val)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+/**
+ * @brief Finds the block holding a rank by descending the tree of counts.
+ *
+ * @param rank The rank, 0 being the smallest value. Receives the rank within the block.
+ * @param total Receives the sum of the blocks before the block, if not nullptr.
+ * @return The position of the last block whose prefix count does not exceed the rank.
+ */
+template<typename T, uint8_t B, typename S>
+int BlockedOrderStatistic<T, B, S>::locate(int& rank, Sum* total) const {
+  int step = 1;
+  while (step * 2 <= this->num_blocks)
+    step *= 2;
+
+  int position = 0;
+  for (; step > 0; step /= 2) {
+    int next = position + step;
+    if (next <= this->num_blocks && this->count_tree[next] <= rank) {
+      position = next;
+      rank -= this->count_tree[next];
+      if (total != nullptr)
+        *total += this->sum_tree[next];
+    }
+  }
+  return position;
+}
+
+/**
+ * @brief Returns the index of the first value in a sorted run that is not less than a value.
+ *
+ * @param values The sorted values.
+ * @param length The number of values.
+ * @param val The value to locate.
+ * @return The index, or length if all values are smaller.
+ */
+template<typename T, uint8_t B, typename S>
+uint8_t BlockedOrderStatistic<T, B, S>::lowerBound(const T* values, uint8_t length, T val) {
+  uint8_t low = 0;
+  uint8_t high = length;
+  while (low < high) {
+    uint8_t middle = uint8_t((low + high) / 2);
+    if (values[middle] < val)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+/**
+ * @brief Changes the count and the sum of a block in the trees, in O(log(n / B)).
+ *
+ * @param position The position of the block.
+ * @param count_change The change of its count.
+ * @param sum_change The change of its sum.
+ */
+template<typename T, uint8_t B, typename S>
+void BlockedOrderStatistic<T, B, S>::adjust(int position, int count_change, Sum sum_change) {
+  for (int i = position + 1; i <= this->num_blocks; i += i & -i) {
+    this->count_tree[i] += count_change;
+    this->sum_tree[i] += sum_change;
+  }
+}
+
+/**
+ * @brief Rebuilds the trees from the counts and sums of the blocks, in O(n / B).
+ */
+template<typename T, uint8_t B, typename S>
+void BlockedOrderStatistic<T, B, S>::rebuildTrees() {
+  for (int i = 1; i <= this->num_blocks; i++) {
+    int block = this->order[i - 1];
+    this->count_tree[i] = this->counts[block];
+    this->sum_tree[i] = this->sums[block];
+  }
+  for (int i = 1; i <= this->num_blocks; i++) {
+    int parent = i + (i & -i);
+    if (parent <= this->num_blocks) {
+      this->count_tree[parent] += this->count_tree[i];
+      this->sum_tree[parent] += this->sum_tree[i];
+    }
+  }
+}
+
+/**
+ * @brief Inserts an empty block from the pool into the directory.
+ *
+ * The trees must be rebuilt afterwards.
+ *
+ * @param position The position of the new block.
+ */
+template<typename T, uint8_t B, typename S>
+void BlockedOrderStatistic<T, B, S>::openPosition(int position) {
+  for (int i = this->num_blocks; i > position; i--) {
+    this->order[i] = this->order[i - 1];
+    this->lasts[i] = this->lasts[i - 1];
+  }
+  int block = this->spare[--this->num_spare];
+  this->counts[block] = 0;
+  this->sums[block] = 0;
+  this->order[position] = block;
+  this->num_blocks++;
+}
+
+/**
+ * @brief Removes a block from the directory and returns it to the pool.
+ *
+ * The trees must be rebuilt afterwards.
+ *
+ * @param position The position of the block.
+ */
+template<typename T, uint8_t B, typename S>
+void BlockedOrderStatistic<T, B, S>::closePosition(int position) {
+  this->spare[this->num_spare++] = this->order[position];
+  this->num_blocks--;
+  for (int i = position; i < this->num_blocks; i++) {
+    this->order[i] = this->order[i + 1];
+    this->lasts[i] = this->lasts[i + 1];
+  }
+}
+
+/**
+ * @brief Splits a full block into two halves.
+ *
+ * @param position The position of the block.
+ */
+template<typename T, uint8_t B, typename S>
+void BlockedOrderStatistic<T, B, S>::split(int position) {
+  this->openPosition(position + 1);
+
+  const uint8_t half = B / 2;
+  int block = this->order[position];
+  int next = this->order[position + 1];
+  T* values = this->pool[block].values;
+  T* moved = this->pool[next].values;
+  Sum moved_sum = 0;
+  for (uint8_t i = half; i < B; i++) {
+    moved[i - half] = values[i];
+    moved_sum += Sum(values[i]);
+  }
+
+  this->counts[block] = half;
+  this->counts[next] = B - half;
+  this->sums[block] -= moved_sum;
+  this->sums[next] = moved_sum;
+  this->lasts[position] = values[half - 1];
+  this->lasts[position + 1] = moved[B - half - 1];
+  this->rebuildTrees();
+}
+
+/**
+ * @brief Restores a block that dropped below half full, with its successor or predecessor.
+ *
+ * Merges both blocks if they fit into one, otherwise moves values across so that each holds half
+ * of their values.
+ *
+ * @param position The position of the block.
+ */
+template<typename T, uint8_t B, typename S>
+void BlockedOrderStatistic<T, B, S>::rebalance(int position) {
+  int left = position + 1 < this->num_blocks ? position : position - 1;
+  int first = this->order[left];
+  int second = this->order[left + 1];
+  T* lower = this->pool[first].values;
+  T* upper = this->pool[second].values;
+  int total = this->counts[first] + this->counts[second];
+
+  if (total < B) {
+    for (uint8_t i = 0; i < this->counts[second]; i++) {
+      lower[this->counts[first] + i] = upper[i];
+    }
+    this->counts[first] = uint8_t(total);
+    this->sums[first] += this->sums[second];
+    this->lasts[left] = lower[total - 1];
+    this->closePosition(left + 1);
+    this->rebuildTrees();
+    return;
+  }
+
+  uint8_t target = uint8_t(total / 2);
+  if (this->counts[first] < target) {
+    // Move the smallest values of the upper block to the end of the lower block
+    uint8_t moved = target - this->counts[first];
+    Sum moved_sum = 0;
+    for (uint8_t i = 0; i < moved; i++) {
+      lower[this->counts[first] + i] = upper[i];
+      moved_sum += Sum(upper[i]);
+    }
+    for (uint8_t i = moved; i < this->counts[second]; i++) {
+      upper[i - moved] = upper[i];
+    }
+    this->counts[first] += moved;
+    this->counts[second] -= moved;
+    this->sums[first] += moved_sum;
+    this->sums[second] -= moved_sum;
+  } else {
+    // Move the largest values of the lower block to the front of the upper block
+    uint8_t moved = this->counts[first] - target;
+    Sum moved_sum = 0;
+    for (uint8_t i = this->counts[second]; i > 0; i--) {
+      upper[i - 1 + moved] = upper[i - 1];
+    }
+    for (uint8_t i = 0; i < moved; i++) {
+      upper[i] = lower[target + i];
+      moved_sum += Sum(upper[i]);
+    }
+    this->counts[first] -= moved;
+    this->counts[second] += moved;
+    this->sums[first] -= moved_sum;
+    this->sums[second] += moved_sum;
+  }
+  this->lasts[left] = lower[this->counts[first] - 1];
+  this->rebuildTrees();
+}
+
+#endif  // BLOCKEDORDERSTATISTIC_H
@@ -0,0 +1,582 @@
+/**
+ * @file BoundedQueue.h
+ *
+ * @brief Lock-free bounded queues between producers and filters.
+ *
+ * This header provides a single-producer `SpscQueue` and a multi-producer `MpscQueue`, both with a
+ * fixed power-of-two capacity, no allocation and batch operations, to hand data points from an
+ * interrupt, a DMA callback or another thread to the code that adds them to the filters. The
+ * positions are kept in counters of a pluggable backend: `AtomicCounter` uses `std::atomic` with
+ * acquire/release ordering for hosts and cores with exclusive load/store, `VolatileCounter` uses a
+ * volatile variable, compiler barriers and short critical sections for single-core MCUs such as AVR
+ * and Cortex-M0+, where `<atomic>` is missing or not lock-free.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef BOUNDEDQUEUE_ATOMIC
+#if !defined(__AVR__) && (!defined(__arm__) || defined(__ARM_FEATURE_LDREX))
+#define BOUNDEDQUEUE_ATOMIC 1
+#else
+#define BOUNDEDQUEUE_ATOMIC 0
+#endif
+#endif
+
+#ifndef BOUNDEDQUEUE_CACHE_LINE
+#if defined(__AVR__)
+#define BOUNDEDQUEUE_CACHE_LINE 1
+#elif defined(__arm__)
+#define BOUNDEDQUEUE_CACHE_LINE 32
+#else
+#define BOUNDEDQUEUE_CACHE_LINE 64
+#endif
+#endif
+
+#if BOUNDEDQUEUE_ATOMIC
+#include <atomic>
+#endif
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#endif
+
+/**
+ * @brief Masks interrupts for the lifetime of the object and restores the previous state.
+ *
+ * On AVR the status register is saved, on ARM the PRIMASK register. On hosts this is a no-op.
+ */
+class QueueCriticalSection {
+public:
+  QueueCriticalSection();
+  ~QueueCriticalSection();
+
+private:
+#if defined(__AVR__)
+  uint8_t state;
+#elif defined(__arm__)
+  uint32_t state;
+#endif
+};
+
+inline QueueCriticalSection::QueueCriticalSection() {
+#if defined(__AVR__)
+  this->state = SREG;
+  cli();
+#elif defined(__arm__)
+  __asm__ __volatile__("mrs %0, primask\n\tcpsid i" : "=r"(this->state) : : "memory");
+#endif
+}
+
+inline QueueCriticalSection::~QueueCriticalSection() {
+#if defined(__AVR__)
+  SREG = this->state;
+#elif defined(__arm__)
+  __asm__ __volatile__("msr primask, %0" : : "r"(this->state) : "memory");
+#endif
+}
+
+/**
+ * @brief Queue position in a volatile variable, for single-core MCUs.
+ *
+ * Loads are followed and stores preceded by a compiler barrier, which gives acquire and release
+ * ordering on a single core, where an interrupt sees memory in program order. Positions wider than
+ * the native word of AVR are read and written with interrupts masked, so they are never torn, and
+ * compare-and-swap always runs with interrupts masked. On hosts, where there is nothing to mask,
+ * it is only safe within one thread, e.g. to compare its cost with AtomicCounter.
+ *
+ * @tparam I The unsigned data type of the positions.
+ */
+template<typename I>
+class VolatileCounter {
+public:
+  typedef I Index;
+
+  VolatileCounter();
+
+  I load() const;
+  I loadRelaxed() const;
+  void store(I position);
+  bool compareExchange(I& expected, I desired);
+
+private:
+  volatile I value;
+};
+
+template<typename I>
+VolatileCounter<I>::VolatileCounter()
+  : value(0) {}
+
+/**
+ * @brief Reads the position with acquire ordering.
+ *
+ * @return The position.
+ */
+template<typename I>
+I VolatileCounter<I>::load() const {
+  I position = this->loadRelaxed();
+  __asm__ __volatile__("" ::: "memory");
+  return position;
+}
+
+/**
+ * @brief Reads the position without ordering, e.g. a position only its owner writes.
+ *
+ * @return The position.
+ */
+template<typename I>
+I VolatileCounter<I>::loadRelaxed() const {
+#if defined(__AVR__)
+  if (sizeof(I) > 1) {
+    QueueCriticalSection section;
+    return this->value;
+  }
+#endif
+  return this->value;
+}
+
+/**
+ * @brief Writes the position with release ordering.
+ *
+ * @param position The new position.
+ */
+template<typename I>
+void VolatileCounter<I>::store(I position) {
+  __asm__ __volatile__("" ::: "memory");
+#if defined(__AVR__)
+  if (sizeof(I) > 1) {
+    QueueCriticalSection section;
+    this->value = position;
+    return;
+  }
+#endif
+  this->value = position;
+}
+
+/**
+ * @brief Replaces the position if it still equals the expected one.
+ *
+ * @param expected The expected position, receives the current position on failure.
+ * @param desired The new position.
+ * @return True if the position was replaced, false otherwise.
+ */
+template<typename I>
+bool VolatileCounter<I>::compareExchange(I& expected, I desired) {
+  QueueCriticalSection section;
+  I current = this->value;
+  if (current != expected) {
+    expected = current;
+    return false;
+  }
+  this->value = desired;
+  return true;
+}
+
+#if BOUNDEDQUEUE_ATOMIC
+/**
+ * @brief Queue position in a `std::atomic`, for hosts and multi-core or cached targets.
+ *
+ * @tparam I The unsigned data type of the positions.
+ */
+template<typename I>
+class AtomicCounter {
+public:
+  typedef I Index;
+
+  AtomicCounter();
+
+  I load() const;
+  I loadRelaxed() const;
+  void store(I position);
+  bool compareExchange(I& expected, I desired);
+
+private:
+  std::atomic<I> value;
+};
+
+template<typename I>
+AtomicCounter<I>::AtomicCounter()
+  : value(0) {}
+
+/**
+ * @brief Reads the position with acquire ordering.
+ *
+ * @return The position.
+ */
+template<typename I>
+I AtomicCounter<I>::load() const {
+  return this->value.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Reads the position without ordering, e.g. a position only its owner writes.
+ *
+ * @return The position.
+ */
+template<typename I>
+I AtomicCounter<I>::loadRelaxed() const {
+  return this->value.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Writes the position with release ordering.
+ *
+ * @param position The new position.
+ */
+template<typename I>
+void AtomicCounter<I>::store(I position) {
+  this->value.store(position, std::memory_order_release);
+}
+
+/**
+ * @brief Replaces the position if it still equals the expected one.
+ *
+ * @param expected The expected position, receives the current position on failure.
+ * @param desired The new position.
+ * @return True if the position was replaced, false otherwise.
+ */
+template<typename I>
+bool AtomicCounter<I>::compareExchange(I& expected, I desired) {
+  return this->value.compare_exchange_weak(expected, desired, std::memory_order_relaxed, std::memory_order_relaxed);
+}
+
+typedef AtomicCounter<uint32_t> QueueCounter;  // Default backend of the queues
+#else
+typedef VolatileCounter<uint8_t> QueueCounter;  // Default backend of the queues, up to 128 slots
+#endif
+
+/**
+ * @brief Bounded single-producer single-consumer queue.
+ *
+ * The producer owns the tail and the consumer the head, each in its own cache line together with
+ * the producer's or consumer's cached copy of the other position, so neither core invalidates the
+ * other's line while the queue is neither full nor empty. A push or pop is a slot copy and one
+ * release store; the batch operations copy up to two contiguous runs and publish them with a single
+ * store. The positions run freely and wrap at the range of the index type, which must exceed N.
+ *
+ * Objects with cache-line alignment should be global or static, `new` before C++17 ignores it.
+ *
+ * @tparam T The data type of the items.
+ * @tparam N The capacity, a power of two.
+ * @tparam C The counter backend, AtomicCounter or VolatileCounter (default: QueueCounter).
+ */
+template<typename T, size_t N, typename C = QueueCounter>
+class SpscQueue {
+public:
+  typedef typename C::Index Index;
+
+  static_assert(N > 0 && (N & (N - 1)) == 0, "The capacity must be a power of two");
+  static_assert(N <= size_t(Index(~Index(0))), "The index type is too narrow for the capacity");
+
+  SpscQueue();
+
+  bool push(const T& item);
+  size_t pushBatch(const T* items, size_t n);
+  bool pop(T& item);
+  size_t popBatch(T* items, size_t n);
+  template<typename F>
+  size_t drainInto(F& filter, size_t n = N);
+  size_t size() const;
+  bool empty() const;
+
+private:
+  alignas(BOUNDEDQUEUE_CACHE_LINE) C tail;
+  Index cached_head;
+  alignas(BOUNDEDQUEUE_CACHE_LINE) C head;
+  Index cached_tail;
+  alignas(BOUNDEDQUEUE_CACHE_LINE) T items[N];
+
+  static const Index MASK = Index(N - 1);
+};
+
+template<typename T, size_t N, typename C>
+SpscQueue<T, N, C>::SpscQueue()
+  : cached_head(0), cached_tail(0) {}
+
+/**
+ * @brief Appends an item, called by the producer only.
+ *
+ * @param item The item.
+ * @return True if the item was appended, false if the queue is full.
+ */
+template<typename T, size_t N, typename C>
+bool SpscQueue<T, N, C>::push(const T& item) {
+  Index tail = this->tail.loadRelaxed();
+  if (Index(tail - this->cached_head) == N) {
+    this->cached_head = this->head.load();
+    if (Index(tail - this->cached_head) == N)
+      return false;
+  }
+  this->items[tail & MASK] = item;
+  this->tail.store(Index(tail + 1));
+  return true;
+}
+
+/**
+ * @brief Appends as many items as fit, called by the producer only.
+ *
+ * @param items The items, oldest first.
+ * @param n The number of items.
+ * @return The number of items appended, from the front of items.
+ */
+template<typename T, size_t N, typename C>
+size_t SpscQueue<T, N, C>::pushBatch(const T* items, size_t n) {
+  Index tail = this->tail.loadRelaxed();
+  size_t space = N - Index(tail - this->cached_head);
+  if (space < n) {
+    this->cached_head = this->head.load();
+    space = N - Index(tail - this->cached_head);
+  }
+  if (n > space)
+    n = space;
+
+  size_t first = tail & MASK;
+  for (size_t i = 0; i < n; i++) {
+    this->items[first] = items[i];
+    first = (first + 1) & MASK;
+  }
+  this->tail.store(Index(tail + n));
+  return n;
+}
+
+/**
+ * @brief Removes the oldest item, called by the consumer only.
+ *
+ * @param item Receives the item, unchanged if the queue is empty.
+ * @return True if an item was removed, false if the queue is empty.
+ */
+template<typename T, size_t N, typename C>
+bool SpscQueue<T, N, C>::pop(T& item) {
+  Index head = this->head.loadRelaxed();
+  if (head == this->cached_tail) {
+    this->cached_tail = this->tail.load();
+    if (head == this->cached_tail)
+      return false;
+  }
+  item = this->items[head & MASK];
+  this->head.store(Index(head + 1));
+  return true;
+}
+
+/**
+ * @brief Removes up to n of the oldest items, called by the consumer only.
+ *
+ * @param items Receives the items, oldest first.
+ * @param n The maximum number of items.
+ * @return The number of items removed.
+ */
+template<typename T, size_t N, typename C>
+size_t SpscQueue<T, N, C>::popBatch(T* items, size_t n) {
+  Index head = this->head.loadRelaxed();
+  size_t available = Index(this->cached_tail - head);
+  if (available < n) {
+    this->cached_tail = this->tail.load();
+    available = Index(this->cached_tail - head);
+  }
+  if (n > available)
+    n = available;
+
+  size_t first = head & MASK;
+  for (size_t i = 0; i < n; i++) {
+    items[i] = this->items[first];
+    first = (first + 1) & MASK;
+  }
+  this->head.store(Index(head + n));
+  return n;
+}
+
+/**
+ * @brief Adds up to n of the oldest items to a filter, called by the consumer only.
+ *
+ * Hands the items to the filter's addBatch() in place, in at most two contiguous runs, and frees
+ * their slots once the filter has read them.
+ *
+ * @param filter The filter, e.g. a MovingAverage.
+ * @param n The maximum number of items (default: all).
+ * @return The number of items added.
+ */
+template<typename T, size_t N, typename C>
+template<typename F>
+size_t SpscQueue<T, N, C>::drainInto(F& filter, size_t n) {
+  Index head = this->head.loadRelaxed();
+  this->cached_tail = this->tail.load();
+  size_t available = Index(this->cached_tail - head);
+  if (n > available)
+    n = available;
+
+  size_t first = head & MASK;
+  size_t run = N - first < n ? N - first : n;
+  if (run > 0)
+    filter.addBatch(this->items + first, run);
+  if (n > run)
+    filter.addBatch(this->items, n - run);
+  this->head.store(Index(head + n));
+  return n;
+}
+
+/**
+ * @brief Returns the number of items, exact only when called by the producer or the consumer.
+ *
+ * @return The number of items.
+ */
+template<typename T, size_t N, typename C>
+size_t SpscQueue<T, N, C>::size() const {
+  Index head = this->head.load();
+  return Index(this->tail.load() - head);
+}
+
+/**
+ * @brief Returns whether the queue holds no items.
+ *
+ * @return True if the queue is empty, false otherwise.
+ */
+template<typename T, size_t N, typename C>
+bool SpscQueue<T, N, C>::empty() const {
+  return this->size() == 0;
+}
+
+/**
+ * @brief Bounded multi-producer single-consumer queue.
+ *
+ * Every slot carries a sequence number (Vyukov's bounded queue): producers claim a slot by a
+ * compare-and-swap on the tail, write the item and publish the slot through its sequence number,
+ * so a producer interrupted between claiming and publishing never blocks the others. The consumer
+ * stops at the first unpublished slot. A full queue fails the push instead of waiting. Costs one
+ * counter per slot on top of the items.
+ *
+ * @tparam T The data type of the items.
+ * @tparam N The capacity, a power of two of at least 2.
+ * @tparam C The counter backend, AtomicCounter or VolatileCounter (default: QueueCounter).
+ */
+template<typename T, size_t N, typename C = QueueCounter>
+class MpscQueue {
+public:
+  typedef typename C::Index Index;
+
+  static_assert(N > 1 && (N & (N - 1)) == 0, "The capacity must be a power of two of at least 2");
+  static_assert(N <= size_t(Index(~Index(0))) / 2 + 1, "The index type is too narrow for the capacity");
+
+  MpscQueue();
+
+  bool push(const T& item);
+  size_t pushBatch(const T* items, size_t n);
+  bool pop(T& item);
+  size_t popBatch(T* items, size_t n);
+
+private:
+  alignas(BOUNDEDQUEUE_CACHE_LINE) C tail;
+  alignas(BOUNDEDQUEUE_CACHE_LINE) Index head;
+  alignas(BOUNDEDQUEUE_CACHE_LINE) C sequences[N];
+  T items[N];
+
+  static const Index MASK = Index(N - 1);
+};
+
+/**
+ * @brief Constructs an empty MpscQueue object.
+ *
+ * Slot i is free for the position i.
+ */
+template<typename T, size_t N, typename C>
+MpscQueue<T, N, C>::MpscQueue()
+  : head(0) {
+  for (size_t i = 0; i < N; i++) {
+    this->sequences[i].store(Index(i));
+  }
+}
+
+/**
+ * @brief Appends an item, called by any producer.
+ *
+ * @param item The item.
+ * @return True if the item was appended, false if the queue is full.
+ */
+template<typename T, size_t N, typename C>
+bool MpscQueue<T, N, C>::push(const T& item) {
+  return this->pushBatch(&item, 1) == 1;
+}
+
+/**
+ * @brief Appends as many items as fit, called by any producer.
+ *
+ * Counts the free slots from the tail, claims them with a single compare-and-swap and publishes
+ * them in order, so the items stay contiguous even with other producers. As the consumer frees
+ * slots in order, the free slots always form a run from the tail.
+ *
+ * @param items The items, oldest first.
+ * @param n The number of items.
+ * @return The number of items appended, from the front of items.
+ */
+template<typename T, size_t N, typename C>
+size_t MpscQueue<T, N, C>::pushBatch(const T* items, size_t n) {
+  if (n == 0)
+    return 0;
+
+  Index tail = this->tail.loadRelaxed();
+  size_t count;
+  for (;;) {
+    count = 0;
+    while (count < n && count < N && this->sequences[(tail + count) & MASK].load() == Index(tail + count))
+      count++;
+
+    if (count > 0) {
+      if (this->tail.compareExchange(tail, Index(tail + count)))
+        break;
+    } else if (Index(tail - this->sequences[tail & MASK].load()) < N) {
+      return 0;  // The slot still holds the item of the previous lap
+    } else {
+      tail = this->tail.loadRelaxed();  // Another producer claimed the slot
+    }
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    Index position = Index(tail + i);
+    this->items[position & MASK] = items[i];
+    this->sequences[position & MASK].store(Index(position + 1));
+  }
+  return count;
+}
+
+/**
+ * @brief Removes the oldest item, called by the consumer only.
+ *
+ * @param item Receives the item, unchanged if the queue is empty.
+ * @return True if an item was removed, false if the queue is empty or its oldest slot is not yet
+ * published.
+ */
+template<typename T, size_t N, typename C>
+bool MpscQueue<T, N, C>::pop(T& item) {
+  C& sequence = this->sequences[this->head & MASK];
+  if (sequence.load() != Index(this->head + 1))
+    return false;
+  item = this->items[this->head & MASK];
+  sequence.store(Index(this->head + N));
+  this->head++;
+  return true;
+}
+
+/**
+ * @brief Removes up to n of the oldest published items, called by the consumer only.
+ *
+ * @param items Receives the items, oldest first.
+ * @param n The maximum number of items.
+ * @return The number of items removed.
+ */
+template<typename T, size_t N, typename C>
+size_t MpscQueue<T, N, C>::popBatch(T* items, size_t n) {
+  size_t popped = 0;
+  while (popped < n && this->pop(items[popped]))
+    popped++;
+  return popped;
+}
+
+#endif  // BOUNDEDQUEUE_H
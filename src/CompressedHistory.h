@@ -0,0 +1,795 @@
+/**
+ * @file CompressedHistory.h
+ *
+ * @brief Template class for a long-term history in compressed blocks with per-block aggregates.
+ *
+ * This header provides a `CompressedHistory` class template for keeping weeks or months of a
+ * stream in little memory, e.g. on a gateway. The newest data points are kept raw in the block
+ * being filled. Every full block is compressed Gorilla-style, integral data as delta-of-delta and
+ * floating point data as XOR of consecutive values, into a byte store of fixed size, and its sum,
+ * minimum and maximum are kept as a summary. When the store is full, the oldest blocks lose their
+ * compressed data and only their summaries remain, and when the summaries are full, the oldest
+ * summary is dropped. Aggregates over the newest data points are read from the summaries, so only
+ * the oldest, partially covered block is decompressed.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef COMPRESSEDHISTORY_H
+#define COMPRESSEDHISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "FilterCore.h"
+#include "FilterTraits.h"
+#include "SlidingAggregator.h"
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+/**
+ * @brief Writes bit fields into a byte buffer, most significant bit first.
+ */
+class BitWriter {
+public:
+  explicit BitWriter(uint8_t* bytes)
+    : bytes(bytes), position(0) {}
+
+  /**
+   * @brief Appends the lowest bits of a value.
+   *
+   * @param value The value.
+   * @param bits The number of bits, at most 64.
+   */
+  void write(uint64_t value, uint8_t bits) {
+    while (bits > 0) {
+      size_t index = this->position >> 3;
+      uint8_t free = uint8_t(8 - (this->position & 7));
+      uint8_t count = bits < free ? bits : free;
+      uint8_t chunk = uint8_t((value >> (bits - count)) & ((1u << count) - 1));
+      if (free == 8)
+        this->bytes[index] = 0;
+      this->bytes[index] |= uint8_t(chunk << (free - count));
+      this->position += count;
+      bits -= count;
+    }
+  }
+
+  /**
+   * @brief Returns the number of bytes written, including the last partial byte.
+   */
+  size_t size() const {
+    return (this->position + 7) >> 3;
+  }
+
+private:
+  uint8_t* bytes;
+  size_t position;  // In bits
+};
+
+/**
+ * @brief Reads the bit fields written by BitWriter.
+ */
+class BitReader {
+public:
+  explicit BitReader(const uint8_t* bytes)
+    : bytes(bytes), position(0) {}
+
+  /**
+   * @brief Reads a field of bits.
+   *
+   * @param bits The number of bits, at most 64.
+   * @return The bits in the lowest bits of the result.
+   */
+  uint64_t read(uint8_t bits) {
+    uint64_t value = 0;
+    while (bits > 0) {
+      uint8_t available = uint8_t(8 - (this->position & 7));
+      uint8_t count = bits < available ? bits : available;
+      uint8_t byte = this->bytes[this->position >> 3];
+      value = (value << count) | ((byte >> (available - count)) & ((1u << count) - 1));
+      this->position += count;
+      bits -= count;
+    }
+    return value;
+  }
+
+private:
+  const uint8_t* bytes;
+  size_t position;  // In bits
+};
+
+/**
+ * @brief The unsigned type holding the bits of a floating point type.
+ *
+ * @tparam SIZE The size of the floating point type in bytes, 4 or 8.
+ */
+template<uint8_t SIZE>
+struct CodecBits {
+  typedef uint32_t Type;
+};
+
+template<>
+struct CodecBits<8> {
+  typedef uint64_t Type;
+};
+
+/**
+ * @brief Compresses a block of integral data points as delta-of-delta, as in Gorilla.
+ *
+ * The first data point is stored in full. Every following data point stores the change of the
+ * difference to its predecessor, in 1 bit if the slope is unchanged and in 9, 12 or 16 bits for
+ * small changes, so slowly varying sensor data takes one to two bytes per data point.
+ *
+ * @tparam T The data type, integral and at most 32 bits wide.
+ * @tparam INTEGRAL Whether T is integral.
+ */
+template<typename T, bool INTEGRAL = FilterTraits<T>::INTEGRAL>
+struct BlockCodec {
+  static_assert(sizeof(T) <= 4, "Integral data points must be at most 32 bits wide");
+
+  static const uint8_t BITS = 8 * sizeof(T);
+  static const uint8_t LONG_BITS = 12;        // The longest class of small changes
+  static const uint8_t WIDE_BITS = BITS + 2;  // Any delta-of-delta of T
+  static const size_t MAX_BITS_PER_VALUE = 4 + (WIDE_BITS > LONG_BITS ? WIDE_BITS : LONG_BITS);
+  static_assert(MAX_BITS_PER_VALUE >= 4 + LONG_BITS && MAX_BITS_PER_VALUE >= 4 + WIDE_BITS, "A data point may take the widest class the encoder emits");
+
+  static void encode(const T* values, uint16_t n, BitWriter& writer) {
+    writer.write(uint64_t(int64_t(values[0])), BITS);
+    int64_t previous = int64_t(values[0]);
+    int64_t delta = 0;
+    for (uint16_t i = 1; i < n; i++) {
+      int64_t next_delta = int64_t(values[i]) - previous;
+      int64_t change = next_delta - delta;
+      if (change == 0) {
+        writer.write(0, 1);
+      } else if (fits(change, 7)) {
+        writer.write(0x2, 2);
+        writer.write(uint64_t(change), 7);
+      } else if (fits(change, 9)) {
+        writer.write(0x6, 3);
+        writer.write(uint64_t(change), 9);
+      } else if (fits(change, LONG_BITS)) {
+        writer.write(0xE, 4);
+        writer.write(uint64_t(change), LONG_BITS);
+      } else {
+        writer.write(0xF, 4);
+        writer.write(uint64_t(change), WIDE_BITS);
+      }
+      previous = int64_t(values[i]);
+      delta = next_delta;
+    }
+  }
+
+  template<typename F>
+  static void decode(BitReader& reader, uint16_t n, F& consumer) {
+    int64_t value = extend(reader.read(BITS), BITS, FilterCore::lowest<T>() < T(0));
+    int64_t delta = 0;
+    consumer(T(value));
+    for (uint16_t i = 1; i < n; i++) {
+      uint8_t width = 0;
+      if (reader.read(1) != 0) {
+        width = reader.read(1) == 0 ? 7 : reader.read(1) == 0 ? 9 : reader.read(1) == 0 ? LONG_BITS : WIDE_BITS;
+      }
+      if (width != 0)
+        delta += extend(reader.read(width), width, true);
+      value += delta;
+      consumer(T(value));
+    }
+  }
+
+private:
+  static bool fits(int64_t value, uint8_t bits) {
+    int64_t limit = int64_t(1) << (bits - 1);
+    return value >= -limit && value < limit;
+  }
+
+  static int64_t extend(uint64_t bits, uint8_t width, bool is_signed) {
+    if (is_signed && width < 64 && (bits >> (width - 1)) != 0)
+      return int64_t(bits | (~uint64_t(0) << width));
+    return int64_t(bits);
+  }
+};
+
+/**
+ * @brief Compresses a block of floating point data points as XOR of consecutive values, as in Gorilla.
+ *
+ * A repeated value takes 1 bit. Otherwise the XOR with the previous value is stored without its
+ * leading and trailing zero bits, reusing the previous window of meaningful bits when it fits.
+ *
+ * @tparam T The data type, float or double.
+ */
+template<typename T>
+struct BlockCodec<T, false> {
+  static_assert(sizeof(T) == 4 || sizeof(T) == 8, "Floating point data points must be 32 or 64 bits wide");
+
+  typedef typename CodecBits<sizeof(T)>::Type Bits;
+
+  static const uint8_t BITS = 8 * sizeof(T);
+  static const uint8_t LENGTH_BITS = sizeof(T) == 4 ? 5 : 6;
+  static const size_t MAX_BITS_PER_VALUE = 2 + 5 + LENGTH_BITS + BITS;
+
+  static void encode(const T* values, uint16_t n, BitWriter& writer) {
+    Bits previous = bitsOf(values[0]);
+    writer.write(previous, BITS);
+    uint8_t leading = 0xFF;  // No window of meaningful bits yet
+    uint8_t trailing = 0;
+    for (uint16_t i = 1; i < n; i++) {
+      Bits current = bitsOf(values[i]);
+      Bits difference = current ^ previous;
+      previous = current;
+      if (difference == 0) {
+        writer.write(0, 1);
+        continue;
+      }
+
+      uint8_t next_leading = uint8_t(__builtin_clzll(uint64_t(difference)) - (64 - BITS));
+      uint8_t next_trailing = uint8_t(__builtin_ctzll(uint64_t(difference)));
+      if (next_leading > 31)
+        next_leading = 31;
+      if (leading != 0xFF && next_leading >= leading && next_trailing >= trailing) {
+        writer.write(0x2, 2);
+        writer.write(difference >> trailing, uint8_t(BITS - leading - trailing));
+      } else {
+        uint8_t significant = uint8_t(BITS - next_leading - next_trailing);
+        writer.write(0x3, 2);
+        writer.write(next_leading, 5);
+        writer.write(significant - 1, LENGTH_BITS);
+        writer.write(difference >> next_trailing, significant);
+        leading = next_leading;
+        trailing = next_trailing;
+      }
+    }
+  }
+
+  template<typename F>
+  static void decode(BitReader& reader, uint16_t n, F& consumer) {
+    Bits value = Bits(reader.read(BITS));
+    consumer(valueOf(value));
+    uint8_t leading = 0;
+    uint8_t trailing = 0;
+    for (uint16_t i = 1; i < n; i++) {
+      if (reader.read(1) != 0) {
+        if (reader.read(1) != 0) {
+          leading = uint8_t(reader.read(5));
+          uint8_t significant = uint8_t(reader.read(LENGTH_BITS) + 1);
+          trailing = uint8_t(BITS - leading - significant);
+        }
+        value ^= Bits(reader.read(uint8_t(BITS - leading - trailing))) << trailing;
+      }
+      consumer(valueOf(value));
+    }
+  }
+
+private:
+  static Bits bitsOf(T value) {
+    Bits bits;
+    memcpy(&bits, &value, sizeof(T));
+    return bits;
+  }
+
+  static T valueOf(Bits bits) {
+    T value;
+    memcpy(&value, &bits, sizeof(T));
+    return value;
+  }
+};
+
+/**
+ * @brief Template class for a long-term history of a stream in bounded memory.
+ *
+ * The history has three tiers, from new to old: the block of B raw data points being filled, the
+ * blocks still compressed in the store, and blocks of which only the summary remains. Appending
+ * is O(1), plus the compression of B data points once per block. Reading the sum, minimum or
+ * maximum of the newest k data points walks the summaries of the covered blocks, O(k / B), and
+ * decompresses the oldest one if it is covered only in part. Once k reaches blocks without
+ * compressed data, it is rounded up to whole blocks. The cumulative average of all data points
+ * ever added is kept apart and costs O(1).
+ *
+ * The store and the summaries are allocated once by the constructor. A summary takes 18 bytes on
+ * AVR and 24 bytes on 32-bit and 64-bit targets for 16-bit data, the object itself holds the raw
+ * block and a scratch buffer for compressing it.
+ *
+ * @tparam T The data type for input values and averages (default: int16_t).
+ * @tparam B The number of data points per block (default: 256).
+ */
+template<typename T = int16_t, uint16_t B = 256>
+class CompressedHistory {
+public:
+  static_assert(B >= 2, "A block must hold at least two data points");
+
+  CompressedHistory(size_t store_size, uint32_t max_blocks);
+  ~CompressedHistory();
+
+  void begin();
+  void end();
+  void reset();
+  void add(T input);
+  void addBatch(const T* samples, size_t n, size_t stride = 1);
+  void print();
+  T readAverage(uint32_t count) const;
+  T readMinimum(uint32_t count) const;
+  T readMaximum(uint32_t count) const;
+  T readCumulativeAverage() const;
+  uint32_t readSamples(T* output, uint32_t count) const;
+  uint32_t size() const;
+  size_t readStoredBytes() const;
+
+  CompressedHistory(const CompressedHistory&) = delete;
+  CompressedHistory& operator=(const CompressedHistory&) = delete;
+
+private:
+  typedef BlockCodec<T> Codec;
+  typedef typename FilterTraits<T>::Total Total;
+
+  static const size_t MAX_BLOCK_BYTES = (Codec::BITS + (size_t(B) - 1) * Codec::MAX_BITS_PER_VALUE + 7) / 8;
+  static_assert(MAX_BLOCK_BYTES <= 65535, "A compressed block must fit 65535 bytes");
+
+  struct Summary {
+    Total sum;
+    uint32_t offset;  // Of the compressed data in the store
+    uint16_t length;  // Of the compressed data, 0 if it has been dropped
+    T low;
+    T high;
+  };
+
+  struct Aggregate {
+    Total sum;
+    uint32_t count;
+    T low;
+    T high;
+
+    void operator()(T value);
+    void add(const Summary& summary);
+  };
+
+  struct Tail {
+    Aggregate* aggregate;
+    uint16_t skip;
+
+    void operator()(T value);
+  };
+
+  struct Extractor {
+    T* output;
+    uint16_t skip;
+
+    void operator()(T value);
+  };
+
+  // Running state of all data points ever added.
+  Total cumulative_sum;
+  uint64_t num_samples;
+
+  // Newest tier, the block being filled.
+  T raw[B];
+  uint16_t num_raw;
+
+  // Older tiers, a ring of summaries and a ring of compressed blocks in the same order.
+  Summary* summaries;
+  uint32_t max_blocks;
+  uint32_t first_block;  // Oldest summary
+  uint32_t num_blocks;
+  uint32_t num_compressed;  // The newest summaries with compressed data
+  uint8_t* store;
+  size_t store_size;
+  size_t store_head;  // Where the next block is written
+  size_t stored_bytes;
+  uint8_t scratch[MAX_BLOCK_BYTES];
+  bool enabled;
+
+  void flush();
+  void reserve(size_t length);
+  void dropCompressed();
+  Aggregate query(uint32_t count) const;
+  const Summary& block(uint32_t age) const;
+  template<typename F>
+  void decode(const Summary& summary, F& consumer) const;
+};
+
+/**
+ * @brief Constructs a new CompressedHistory object.
+ *
+ * @param store_size The size of the store of compressed blocks in bytes.
+ * @param max_blocks The number of blocks whose summaries are kept, including the compressed ones.
+ */
+template<typename T, uint16_t B>
+CompressedHistory<T, B>::CompressedHistory(size_t store_size, uint32_t max_blocks)
+  : cumulative_sum(0), num_samples(0), num_raw(0), summaries(new Summary[max_blocks ? max_blocks : 1]),
+    max_blocks(max_blocks ? max_blocks : 1), first_block(0), num_blocks(0), num_compressed(0),
+    store(new uint8_t[store_size ? store_size : 1]), store_size(store_size), store_head(0), stored_bytes(0),
+    enabled(false) {}
+
+/**
+ * @brief Destructs a CompressedHistory object.
+ *
+ * Releases the store and the summaries.
+ */
+template<typename T, uint16_t B>
+CompressedHistory<T, B>::~CompressedHistory() {
+  delete[] this->summaries;
+  delete[] this->store;
+}
+
+/**
+ * @brief Enables the CompressedHistory object.
+ */
+template<typename T, uint16_t B>
+void CompressedHistory<T, B>::begin() {
+  this->enabled = true;
+}
+
+/**
+ * @brief Disables the CompressedHistory object.
+ */
+template<typename T, uint16_t B>
+void CompressedHistory<T, B>::end() {
+  this->enabled = false;
+}
+
+/**
+ * @brief Clears the history and the cumulative average, keeping the memory.
+ */
+template<typename T, uint16_t B>
+void CompressedHistory<T, B>::reset() {
+  this->cumulative_sum = 0;
+  this->num_samples = 0;
+  this->num_raw = 0;
+  this->first_block = 0;
+  this->num_blocks = 0;
+  this->num_compressed = 0;
+  this->store_head = 0;
+  this->stored_bytes = 0;
+}
+
+/**
+ * @brief Appends a data point.
+ *
+ * Compresses the raw block once it holds B data points.
+ *
+ * @param input The new data point.
+ */
+template<typename T, uint16_t B>
+void CompressedHistory<T, B>::add(T input) {
+  if (!this->enabled)
+    return;
+
+  this->cumulative_sum += Total(input);
+  this->num_samples++;
+  this->raw[this->num_raw++] = input;
+  if (this->num_raw == B)
+    this->flush();
+}
+
+/**
+ * @brief Appends a block of data points, e.g. half of a DMA buffer.
+ *
+ * @param samples The first data point, oldest first.
+ * @param n The number of data points.
+ * @param stride The distance between two data points, e.g. the number of interleaved channels.
+ */
+template<typename T, uint16_t B>
+void CompressedHistory<T, B>::addBatch(const T* samples, size_t n, size_t stride) {
+  for (size_t i = 0; i < n; i++) {
+    this->add(samples[i * stride]);
+  }
+}
+
+/**
+ * @brief Prints the cumulative average and the size of the history.
+ */
+template<typename T, uint16_t B>
+void CompressedHistory<T, B>::print() {
+  while (!Serial) {
+  }
+
+  Serial.print("CA:");
+  Serial.print(this->readCumulativeAverage());
+  Serial.print("\tSamples:");
+  Serial.print(this->size());
+  Serial.print("\tBytes:");
+  Serial.print(this->readStoredBytes());
+  Serial.print("\n");
+}
+
+/**
+ * @brief Returns the average of the newest data points.
+ *
+ * Integral averages truncate toward zero, as those of MovingAverage.
+ *
+ * @param count The number of newest data points, clamped to the history and rounded up to whole
+ * blocks where only summaries remain.
+ * @return The average, 0 if the history is empty.
+ */
+template<typename T, uint16_t B>
+T CompressedHistory<T, B>::readAverage(uint32_t count) const {
+  Aggregate aggregate = this->query(count);
+  return aggregate.count == 0 ? T(0) : T(aggregate.sum / Total(aggregate.count));
+}
+
+/**
+ * @brief Returns the minimum of the newest data points.
+ *
+ * @param count The number of newest data points, as for readAverage().
+ * @return The minimum, 0 if the history is empty.
+ */
+template<typename T, uint16_t B>
+T CompressedHistory<T, B>::readMinimum(uint32_t count) const {
+  Aggregate aggregate = this->query(count);
+  return aggregate.count == 0 ? T(0) : aggregate.low;
+}
+
+/**
+ * @brief Returns the maximum of the newest data points.
+ *
+ * @param count The number of newest data points, as for readAverage().
+ * @return The maximum, 0 if the history is empty.
+ */
+template<typename T, uint16_t B>
+T CompressedHistory<T, B>::readMaximum(uint32_t count) const {
+  Aggregate aggregate = this->query(count);
+  return aggregate.count == 0 ? T(0) : aggregate.high;
+}
+
+/**
+ * @brief Returns the average of all data points ever added, including dropped blocks.
+ *
+ * @return The cumulative average, 0 if no data point has been added.
+ */
+template<typename T, uint16_t B>
+T CompressedHistory<T, B>::readCumulativeAverage() const {
+  return this->num_samples == 0 ? T(0) : T(this->cumulative_sum / Total(this->num_samples));
+}
+
+/**
+ * @brief Decompresses the newest data points, e.g. to export them.
+ *
+ * @param output The buffer for the data points, oldest first.
+ * @param count The number of newest data points wanted.
+ * @return The number of data points written, less than count if the history holds fewer raw or
+ * compressed data points.
+ */
+template<typename T, uint16_t B>
+uint32_t CompressedHistory<T, B>::readSamples(T* output, uint32_t count) const {
+  uint32_t available = uint32_t(this->num_compressed) * B + this->num_raw;
+  if (count > available)
+    count = available;
+
+  uint32_t from_raw = count < this->num_raw ? count : this->num_raw;
+  uint32_t remaining = count - from_raw;
+  uint32_t blocks = (remaining + B - 1) / B;
+  T* position = output;
+  for (uint32_t age = blocks; age > 0; age--) {
+    uint16_t skip = age == blocks ? uint16_t(blocks * B - remaining) : 0;
+    Extractor extractor = { position, skip };
+    this->decode(this->block(age - 1), extractor);
+    position += B - skip;
+  }
+  memcpy(position, this->raw + this->num_raw - from_raw, from_raw * sizeof(T));
+  return count;
+}
+
+/**
+ * @brief Returns the number of data points covered by the history.
+ *
+ * @return The number of raw data points and of data points in blocks with a summary.
+ */
+template<typename T, uint16_t B>
+uint32_t CompressedHistory<T, B>::size() const {
+  return this->num_blocks * B + this->num_raw;
+}
+
+/**
+ * @brief Returns the bytes of compressed data in the store.
+ *
+ * @return The bytes used by the compressed blocks.
+ */
+template<typename T, uint16_t B>
+size_t CompressedHistory<T, B>::readStoredBytes() const {
+  return this->stored_bytes;
+}
+
+/**
+ * @brief Compresses the full raw block into the store and adds its summary.
+ *
+ * Makes room by dropping the oldest summary if all are in use and the compressed data of the
+ * oldest blocks that overlap the space needed.
+ */
+template<typename T, uint16_t B>
+void CompressedHistory<T, B>::flush() {
+  BitWriter writer(this->scratch);
+  Codec::encode(this->raw, B, writer);
+  size_t length = writer.size();
+
+  Summary summary;
+  summary.sum = 0;
+  summary.offset = 0;
+  summary.length = 0;
+  summary.low = MinMonoid<T>::identity();
+  summary.high = MaxMonoid<T>::identity();
+  for (uint16_t i = 0; i < B; i++) {
+    summary.sum += Total(this->raw[i]);
+    summary.low = MinMonoid<T>::combine(summary.low, this->raw[i]);
+    summary.high = MaxMonoid<T>::combine(summary.high, this->raw[i]);
+  }
+  this->num_raw = 0;
+
+  if (this->num_blocks == this->max_blocks) {
+    if (this->num_compressed == this->num_blocks)
+      this->dropCompressed();
+    this->first_block = this->first_block + 1 == this->max_blocks ? 0 : this->first_block + 1;
+    this->num_blocks--;
+  }
+
+  if (length <= this->store_size) {
+    this->reserve(length);
+    memcpy(this->store + this->store_head, this->scratch, length);
+    summary.offset = uint32_t(this->store_head);
+    summary.length = uint16_t(length);
+    this->store_head += length;
+    this->stored_bytes += length;
+  } else {
+    // Too large for the store, older compressed data would no longer be contiguous in time
+    while (this->num_compressed > 0)
+      this->dropCompressed();
+  }
+
+  uint32_t slot = this->first_block + this->num_blocks;
+  if (slot >= this->max_blocks)
+    slot -= this->max_blocks;
+  this->summaries[slot] = summary;
+  this->num_blocks++;
+  if (summary.length != 0)
+    this->num_compressed++;
+}
+
+/**
+ * @brief Drops the compressed data of the oldest blocks until a block of a given length fits.
+ *
+ * Blocks are written one after the other and wrap to the start of the store when the end is
+ * reached, so the compressed data following the write position is always the oldest.
+ *
+ * @param length The length of the block to write.
+ */
+template<typename T, uint16_t B>
+void CompressedHistory<T, B>::reserve(size_t length) {
+  if (this->store_head + length > this->store_size) {
+    // Wrap: the tail of the store after the write position is given up
+    while (this->num_compressed > 0 && this->block(this->num_compressed - 1).offset >= this->store_head)
+      this->dropCompressed();
+    this->store_head = 0;
+  }
+
+  while (this->num_compressed > 0) {
+    const Summary& oldest = this->block(this->num_compressed - 1);
+    if (oldest.offset >= this->store_head + length || oldest.offset + oldest.length <= this->store_head)
+      break;
+    this->dropCompressed();
+  }
+  if (this->num_compressed == 0)
+    this->store_head = 0;
+}
+
+/**
+ * @brief Drops the compressed data of the oldest block that still has it, keeping its summary.
+ */
+template<typename T, uint16_t B>
+void CompressedHistory<T, B>::dropCompressed() {
+  uint32_t age = this->num_compressed - 1;
+  uint32_t slot = this->first_block + (this->num_blocks - 1 - age);
+  if (slot >= this->max_blocks)
+    slot -= this->max_blocks;
+  this->stored_bytes -= this->summaries[slot].length;
+  this->summaries[slot].length = 0;
+  this->num_compressed--;
+}
+
+/**
+ * @brief Combines the newest data points.
+ *
+ * @param count The number of newest data points.
+ * @return The sum, count, minimum and maximum of the data points.
+ */
+template<typename T, uint16_t B>
+typename CompressedHistory<T, B>::Aggregate CompressedHistory<T, B>::query(uint32_t count) const {
+  Aggregate aggregate = { 0, 0, MinMonoid<T>::identity(), MaxMonoid<T>::identity() };
+  if (!this->enabled)
+    return aggregate;
+
+  for (uint16_t i = this->num_raw; i > 0 && aggregate.count < count; i--) {
+    aggregate(this->raw[i - 1]);
+  }
+
+  for (uint32_t age = 0; age < this->num_blocks && aggregate.count < count; age++) {
+    const Summary& summary = this->block(age);
+    uint32_t missing = count - aggregate.count;
+    if (missing >= B || summary.length == 0) {
+      aggregate.add(summary);
+    } else {
+      Tail tail = { &aggregate, uint16_t(B - missing) };
+      this->decode(summary, tail);
+    }
+  }
+  return aggregate;
+}
+
+/**
+ * @brief Returns the summary of a block by age.
+ *
+ * @param age 0 for the newest block.
+ * @return The summary.
+ */
+template<typename T, uint16_t B>
+const typename CompressedHistory<T, B>::Summary& CompressedHistory<T, B>::block(uint32_t age) const {
+  uint32_t slot = this->first_block + (this->num_blocks - 1 - age);
+  if (slot >= this->max_blocks)
+    slot -= this->max_blocks;
+  return this->summaries[slot];
+}
+
+/**
+ * @brief Decompresses a block into a consumer, oldest data point first.
+ *
+ * @param summary The summary of a block with compressed data.
+ * @param consumer Called with every data point.
+ */
+template<typename T, uint16_t B>
+template<typename F>
+void CompressedHistory<T, B>::decode(const Summary& summary, F& consumer) const {
+  BitReader reader(this->store + summary.offset);
+  Codec::decode(reader, B, consumer);
+}
+
+/**
+ * @brief Adds a data point to the aggregate.
+ */
+template<typename T, uint16_t B>
+void CompressedHistory<T, B>::Aggregate::operator()(T value) {
+  this->sum += Total(value);
+  this->count++;
+  this->low = MinMonoid<T>::combine(this->low, value);
+  this->high = MaxMonoid<T>::combine(this->high, value);
+}
+
+/**
+ * @brief Adds a whole block to the aggregate.
+ */
+template<typename T, uint16_t B>
+void CompressedHistory<T, B>::Aggregate::add(const Summary& summary) {
+  this->sum += summary.sum;
+  this->count += B;
+  this->low = MinMonoid<T>::combine(this->low, summary.low);
+  this->high = MaxMonoid<T>::combine(this->high, summary.high);
+}
+
+/**
+ * @brief Adds the data points after the skipped ones to the aggregate.
+ */
+template<typename T, uint16_t B>
+void CompressedHistory<T, B>::Tail::operator()(T value) {
+  if (this->skip > 0)
+    this->skip--;
+  else
+    (*this->aggregate)(value);
+}
+
+/**
+ * @brief Writes the data points after the skipped ones to the output.
+ */
+template<typename T, uint16_t B>
+void CompressedHistory<T, B>::Extractor::operator()(T value) {
+  if (this->skip > 0)
+    this->skip--;
+  else
+    *this->output++ = value;
+}
+
+#endif  // COMPRESSEDHISTORY_H
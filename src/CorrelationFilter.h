@@ -0,0 +1,437 @@
+/**
+ * @file CorrelationFilter.h
+ *
+ * @brief Template class for the rolling covariance and correlation of two channels.
+ *
+ * This header provides a `CorrelationFilter` class template that ingests pairs of data points,
+ * e.g. current and temperature, and keeps the sums of x, y, xy, x² and y² of the last N pairs up
+ * to date, so the covariance and the Pearson correlation of the window cost O(1) per pair. The
+ * sums of a block of pairs are computed by `PairedSums::accumulate()`, a branch-free loop over two
+ * contiguous arrays that compilers vectorise, which serves both the batch ingestion and offline
+ * analysis of recorded series.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef CORRELATIONFILTER_H
+#define CORRELATIONFILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include "FilterCore.h"
+#include "FilterTraits.h"
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+/**
+ * @brief Accumulator type of the paired sums.
+ *
+ * Sums of 8-bit and 16-bit integral data are exact in `int64_t`, so adding and removing pairs never
+ * drifts. Wider integral and floating point data are summed in `double`.
+ *
+ * @tparam T The data type of the data points.
+ * @tparam EXACT Whether T is integral and at most 16 bits wide.
+ */
+template<typename T, bool EXACT = FilterTraits<T>::INTEGRAL && sizeof(T) <= 2>
+struct PairedAccumulator {
+  typedef double Type;
+};
+
+template<typename T>
+struct PairedAccumulator<T, true> {
+  typedef int64_t Type;
+};
+
+/**
+ * @brief The sums of a set of pairs needed for their covariance and correlation.
+ *
+ * @tparam A The accumulator type.
+ */
+template<typename A>
+struct PairedSums {
+  A x;
+  A y;
+  A xy;
+  A xx;
+  A yy;
+
+  PairedSums();
+
+  void add(const PairedSums& other);
+  void subtract(const PairedSums& other);
+  float covariance(uint32_t count) const;
+  float correlation(uint32_t count) const;
+
+  template<typename T>
+  static PairedSums accumulate(const T* x, const T* y, size_t n);
+
+private:
+  static double moment(A product_sum, A sum_a, A sum_b, uint32_t count);
+};
+
+template<typename A>
+PairedSums<A>::PairedSums()
+  : x(0), y(0), xy(0), xx(0), yy(0) {}
+
+/**
+ * @brief Adds the sums of other pairs.
+ *
+ * @param other The sums to add.
+ */
+template<typename A>
+void PairedSums<A>::add(const PairedSums& other) {
+  this->x += other.x;
+  this->y += other.y;
+  this->xy += other.xy;
+  this->xx += other.xx;
+  this->yy += other.yy;
+}
+
+/**
+ * @brief Removes the sums of other pairs.
+ *
+ * @param other The sums to remove.
+ */
+template<typename A>
+void PairedSums<A>::subtract(const PairedSums& other) {
+  this->x -= other.x;
+  this->y -= other.y;
+  this->xy -= other.xy;
+  this->xx -= other.xx;
+  this->yy -= other.yy;
+}
+
+/**
+ * @brief Returns the population covariance of the pairs.
+ *
+ * Computes the co-moment n Σxy - Σx Σy and divides it by n² once.
+ *
+ * @param count The number of pairs n.
+ * @return The covariance, 0 if there are no pairs.
+ */
+template<typename A>
+float PairedSums<A>::covariance(uint32_t count) const {
+  if (count == 0)
+    return 0;
+
+  return float(moment(this->xy, this->x, this->y, count) / (double(count) * double(count)));
+}
+
+/**
+ * @brief Returns the Pearson correlation coefficient of the pairs.
+ *
+ * @param count The number of pairs n.
+ * @return The correlation in the interval [-1; 1], 0 if either channel is constant.
+ */
+template<typename A>
+float PairedSums<A>::correlation(uint32_t count) const {
+  double x_moment = moment(this->xx, this->x, this->x, count);
+  double y_moment = moment(this->yy, this->y, this->y, count);
+  if (x_moment <= 0 || y_moment <= 0)
+    return 0;
+
+  double correlation = moment(this->xy, this->x, this->y, count) / sqrt(x_moment * y_moment);
+  return float(correlation > 1 ? 1 : correlation < -1 ? -1 : correlation);
+}
+
+/**
+ * @brief Computes a co-moment n Σab - Σa Σb.
+ *
+ * Exact in the integer accumulator for up to 32768 pairs of 16-bit data, where it is bounded by
+ * n² 2^32 < 2^63, in double beyond.
+ *
+ * @param product_sum The sum of the products Σab.
+ * @param sum_a The sum Σa.
+ * @param sum_b The sum Σb.
+ * @param count The number of pairs n.
+ * @return The co-moment.
+ */
+template<typename A>
+double PairedSums<A>::moment(A product_sum, A sum_a, A sum_b, uint32_t count) {
+  if (count <= 32768)
+    return double(A(count) * product_sum - sum_a * sum_b);
+  return double(count) * double(product_sum) - double(sum_a) * double(sum_b);
+}
+
+/**
+ * @brief Sums a block of pairs.
+ *
+ * A single pass over two contiguous arrays with five independent accumulators and no branches, so
+ * GCC and Clang vectorise it at -O3 on SIMD targets; on AVR it is a plain loop.
+ *
+ * @param x The first channel.
+ * @param y The second channel.
+ * @param n The number of pairs.
+ * @return The sums of the pairs.
+ */
+template<typename A>
+template<typename T>
+PairedSums<A> PairedSums<A>::accumulate(const T* __restrict__ x, const T* __restrict__ y, size_t n) {
+  A sum_x = 0;
+  A sum_y = 0;
+  A sum_xy = 0;
+  A sum_xx = 0;
+  A sum_yy = 0;
+  for (size_t i = 0; i < n; i++) {
+    A value_x = A(x[i]);
+    A value_y = A(y[i]);
+    sum_x += value_x;
+    sum_y += value_y;
+    sum_xy += value_x * value_y;
+    sum_xx += value_x * value_x;
+    sum_yy += value_y * value_y;
+  }
+
+  PairedSums sums;
+  sums.x = sum_x;
+  sums.y = sum_y;
+  sums.xy = sum_xy;
+  sums.xx = sum_xx;
+  sums.yy = sum_yy;
+  return sums;
+}
+
+/**
+ * @brief Template class for the rolling covariance and correlation of two channels.
+ *
+ * Keeps the last N pairs in two rings, one per channel, and the paired sums of the window. Adding
+ * a pair adds its terms and removes those of the evicted pair. Sums in `double` are recomputed
+ * from the rings once per revolution, which bounds their rounding drift. For 16-bit data the
+ * exact integer sums cover windows of up to 32768 pairs.
+ *
+ * @tparam T The data type for input values (default: int16_t).
+ * @tparam N The number of pairs in the window (default: 32).
+ */
+template<typename T = int16_t, uint16_t N = 32>
+class CorrelationFilter {
+public:
+  static_assert(N > 0 && N <= 32768, "The window must hold 1 to 32768 pairs");
+
+  CorrelationFilter();
+
+  void begin();
+  void end();
+  void reset();
+  void add(T x, T y);
+  void addBatch(const T* x, const T* y, size_t n);
+  void print();
+  float readCovariance() const;
+  float readCorrelation() const;
+  uint16_t size() const;
+
+  static float correlation(const T* x, const T* y, size_t n);
+
+private:
+  typedef typename PairedAccumulator<T>::Type Accumulator;
+
+  PairedSums<Accumulator> sums;
+  T window_x[N];
+  T window_y[N];
+  uint16_t head;
+  uint16_t num_elements;
+  bool enabled;
+
+  void resumWindow();
+};
+
+/**
+ * @brief Constructs a new CorrelationFilter object.
+ */
+template<typename T, uint16_t N>
+CorrelationFilter<T, N>::CorrelationFilter()
+  : window_x(), window_y(), head(0), num_elements(0), enabled(false) {}
+
+/**
+ * @brief Enables the CorrelationFilter object.
+ */
+template<typename T, uint16_t N>
+void CorrelationFilter<T, N>::begin() {
+  this->enabled = true;
+}
+
+/**
+ * @brief Disables the CorrelationFilter object.
+ */
+template<typename T, uint16_t N>
+void CorrelationFilter<T, N>::end() {
+  this->enabled = false;
+}
+
+/**
+ * @brief Clears all pairs.
+ */
+template<typename T, uint16_t N>
+void CorrelationFilter<T, N>::reset() {
+  this->sums = PairedSums<Accumulator>();
+  this->head = 0;
+  this->num_elements = 0;
+}
+
+/**
+ * @brief Adds a pair.
+ *
+ * @param x The data point of the first channel.
+ * @param y The data point of the second channel.
+ */
+template<typename T, uint16_t N>
+void CorrelationFilter<T, N>::add(T x, T y) {
+  if (!this->enabled)
+    return;
+
+  Accumulator value_x = Accumulator(x);
+  Accumulator value_y = Accumulator(y);
+  if (this->num_elements == N) {
+    Accumulator outgoing_x = Accumulator(this->window_x[this->head]);
+    Accumulator outgoing_y = Accumulator(this->window_y[this->head]);
+    this->sums.x -= outgoing_x;
+    this->sums.y -= outgoing_y;
+    this->sums.xy -= outgoing_x * outgoing_y;
+    this->sums.xx -= outgoing_x * outgoing_x;
+    this->sums.yy -= outgoing_y * outgoing_y;
+  } else {
+    this->num_elements++;
+  }
+  this->sums.x += value_x;
+  this->sums.y += value_y;
+  this->sums.xy += value_x * value_y;
+  this->sums.xx += value_x * value_x;
+  this->sums.yy += value_y * value_y;
+
+  this->window_x[this->head] = x;
+  this->window_y[this->head] = y;
+  this->head = FilterCore::ringNext<uint16_t>(this->head, N);
+
+  if (!FilterTraits<Accumulator>::INTEGRAL && this->head == 0)
+    this->resumWindow();
+}
+
+/**
+ * @brief Adds a block of pairs, e.g. a recorded series.
+ *
+ * Gives the same results as adding the pairs one by one. Works in runs that end at the end of the
+ * ring: the sums of the evicted run and of the incoming run are computed with
+ * PairedSums::accumulate(), so the cost per pair is that of the vectorised loop. Blocks longer
+ * than the window skip the pairs that would be evicted again.
+ *
+ * @param x The first channel, oldest first.
+ * @param y The second channel, oldest first.
+ * @param n The number of pairs.
+ */
+template<typename T, uint16_t N>
+void CorrelationFilter<T, N>::addBatch(const T* x, const T* y, size_t n) {
+  if (!this->enabled)
+    return;
+
+  if (n > N) {
+    x += n - N;
+    y += n - N;
+    n = N;
+  }
+
+  while (n > 0) {
+    uint16_t run = size_t(N - this->head) < n ? uint16_t(N - this->head) : uint16_t(n);
+    if (this->num_elements == N)
+      this->sums.subtract(PairedSums<Accumulator>::accumulate(this->window_x + this->head, this->window_y + this->head, run));
+    else
+      this->num_elements += run;
+    this->sums.add(PairedSums<Accumulator>::accumulate(x, y, run));
+
+    for (uint16_t i = 0; i < run; i++) {
+      this->window_x[this->head + i] = x[i];
+      this->window_y[this->head + i] = y[i];
+    }
+    this->head = FilterCore::ringNext<uint16_t>(this->head + run - 1, N);
+    x += run;
+    y += run;
+    n -= run;
+
+    if (!FilterTraits<Accumulator>::INTEGRAL && this->head == 0)
+      this->resumWindow();
+  }
+}
+
+/**
+ * @brief Prints the covariance and the correlation.
+ */
+template<typename T, uint16_t N>
+void CorrelationFilter<T, N>::print() {
+  while (!Serial) {
+  }
+
+  Serial.print("Cov:");
+  Serial.print(this->readCovariance());
+  Serial.print("\tCorr:");
+  Serial.print(this->readCorrelation());
+  Serial.print("\n");
+}
+
+/**
+ * @brief Returns the population covariance of the window.
+ *
+ * @return The covariance, 0 if the object is disabled or empty.
+ */
+template<typename T, uint16_t N>
+float CorrelationFilter<T, N>::readCovariance() const {
+  if (!this->enabled)
+    return 0;
+
+  return this->sums.covariance(this->num_elements);
+}
+
+/**
+ * @brief Returns the Pearson correlation coefficient of the window.
+ *
+ * @return The correlation in the interval [-1; 1], 0 if the object is disabled or a channel is
+ * constant over the window.
+ */
+template<typename T, uint16_t N>
+float CorrelationFilter<T, N>::readCorrelation() const {
+  if (!this->enabled)
+    return 0;
+
+  return this->sums.correlation(this->num_elements);
+}
+
+/**
+ * @brief Returns the number of pairs in the window.
+ *
+ * @return The number of pairs, at most N.
+ */
+template<typename T, uint16_t N>
+uint16_t CorrelationFilter<T, N>::size() const {
+  return this->num_elements;
+}
+
+/**
+ * @brief Computes the Pearson correlation of two whole series, e.g. for offline analysis.
+ *
+ * @param x The first channel.
+ * @param y The second channel.
+ * @param n The number of pairs.
+ * @return The correlation in the interval [-1; 1], 0 if a channel is constant.
+ */
+template<typename T, uint16_t N>
+float CorrelationFilter<T, N>::correlation(const T* x, const T* y, size_t n) {
+  return PairedSums<Accumulator>::accumulate(x, y, n).correlation(uint32_t(n));
+}
+
+/**
+ * @brief Recomputes the sums from the rings.
+ *
+ * Called once per revolution of the rings for floating point sums, an amortized O(1) per pair.
+ */
+template<typename T, uint16_t N>
+void CorrelationFilter<T, N>::resumWindow() {
+  this->sums = PairedSums<Accumulator>::accumulate(this->window_x, this->window_y, this->num_elements);
+}
+
+#endif  // CORRELATIONFILTER_H
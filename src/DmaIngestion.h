@@ -0,0 +1,154 @@
+/**
+ * @file DmaIngestion.h
+ *
+ * @brief Feeds filters straight from a ping-pong DMA buffer in the transfer callbacks.
+ *
+ * ADCs on STM32, SAMD and similar boards stream into a circular DMA buffer and raise an interrupt
+ * when the first half is full (half transfer) and when the second half is full (transfer
+ * complete). While the DMA fills one half, the CPU owns the other. `DmaIngestion` holds such a
+ * buffer and hands each completed half to the filters with `addBatch()`, in place and without
+ * copying, from the callback itself. Every callback is timed into a latency histogram, so the
+ * cycle budget per half buffer is measured on the target instead of estimated.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef DMAINGESTION_H
+#define DMAINGESTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "LatencyHistogram.h"
+
+/**
+ * @brief Ping-pong DMA buffer that feeds one filter per channel.
+ *
+ * The buffer holds two halves of N scans, a scan being one data point of each of the CHANNELS
+ * channels in the order the ADC converts them. Pass `buffer()` and `LENGTH` to the DMA in circular
+ * mode and call `onHalfComplete()` and `onComplete()` from the matching interrupt callbacks. Each
+ * call processes N data points per channel, so its cost is bounded by N * CHANNELS times the cost
+ * of one data point, e.g. a few cycles for SMA, WMA and CA.
+ *
+ * The callbacks never allocate as long as every filter has its window set with reconfigure()
+ * before the DMA starts, which allocates its ring, and no read builds an order statistic index
+ * while a callback may run.
+ *
+ * If a callback is missed, e.g. because the previous one overran its budget, the next callback finds
+ * the other half than expected. It still processes its own half and counts an overrun.
+ *
+ * On cores with a data cache, e.g. Cortex-M7, the buffer must be placed in non-cacheable memory or
+ * its half must be invalidated before the callback reads it.
+ *
+ * @tparam F The filter type, e.g. MovingAverage<int16_t, int16_t>.
+ * @tparam T The data type of the ADC results.
+ * @tparam N The number of scans per half buffer.
+ * @tparam CHANNELS The number of interleaved channels.
+ * @tparam H The histogram type recording the ticks per callback.
+ */
+template<typename F, typename T, uint16_t N, uint8_t CHANNELS = 1, typename H = LatencyHistogram<>>
+class DmaIngestion {
+public:
+  static const size_t LENGTH = 2 * size_t(N) * CHANNELS;  // Transfers per DMA cycle
+
+  explicit DmaIngestion(F* filters);
+
+  T* buffer();
+  void onHalfComplete();
+  void onComplete();
+  const H& readBudget() const;
+  uint32_t readOverruns() const;
+
+private:
+  T samples[LENGTH];
+  F* filters;
+  H budget;
+  uint32_t overruns;
+  uint8_t next_half;
+
+  void consume(uint8_t half);
+};
+
+/**
+ * @brief Constructs a new DmaIngestion object.
+ *
+ * @param filters The CHANNELS filters, one per channel in scan order, each with its window set by
+ *   reconfigure() before the first callback.
+ */
+template<typename F, typename T, uint16_t N, uint8_t CHANNELS, typename H>
+DmaIngestion<F, T, N, CHANNELS, H>::DmaIngestion(F* filters)
+  : samples(), filters(filters), overruns(0), next_half(0) {}
+
+/**
+ * @brief Returns the buffer to hand to the DMA.
+ *
+ * @return The first of LENGTH transfers.
+ */
+template<typename F, typename T, uint16_t N, uint8_t CHANNELS, typename H>
+T* DmaIngestion<F, T, N, CHANNELS, H>::buffer() {
+  return this->samples;
+}
+
+/**
+ * @brief Processes the first half, call from the half transfer interrupt.
+ */
+template<typename F, typename T, uint16_t N, uint8_t CHANNELS, typename H>
+void DmaIngestion<F, T, N, CHANNELS, H>::onHalfComplete() {
+  this->consume(0);
+}
+
+/**
+ * @brief Processes the second half, call from the transfer complete interrupt.
+ */
+template<typename F, typename T, uint16_t N, uint8_t CHANNELS, typename H>
+void DmaIngestion<F, T, N, CHANNELS, H>::onComplete() {
+  this->consume(1);
+}
+
+/**
+ * @brief Returns the ticks spent per callback.
+ *
+ * @return The histogram of ticks of CycleCounter::read() per half buffer.
+ */
+template<typename F, typename T, uint16_t N, uint8_t CHANNELS, typename H>
+const H& DmaIngestion<F, T, N, CHANNELS, H>::readBudget() const {
+  return this->budget;
+}
+
+/**
+ * @brief Returns the number of missed callbacks.
+ *
+ * @return The number of callbacks that found the other half than expected.
+ */
+template<typename F, typename T, uint16_t N, uint8_t CHANNELS, typename H>
+uint32_t DmaIngestion<F, T, N, CHANNELS, H>::readOverruns() const {
+  return this->overruns;
+}
+
+/**
+ * @brief Feeds a half buffer to the filters.
+ *
+ * The compiler barrier keeps the reads of the half from being hoisted above the interrupt entry,
+ * as the DMA writes the buffer behind the compiler's back.
+ *
+ * @param half The half to process, 0 or 1.
+ */
+template<typename F, typename T, uint16_t N, uint8_t CHANNELS, typename H>
+void DmaIngestion<F, T, N, CHANNELS, H>::consume(uint8_t half) {
+  LatencyProbe<H> probe(this->budget);
+  __asm__ __volatile__("" ::: "memory");
+
+  if (half != this->next_half)
+    this->overruns++;
+  this->next_half = half ^ 1;
+
+  const T* scans = this->samples + size_t(half) * N * CHANNELS;
+  for (uint8_t channel = 0; channel < CHANNELS; channel++) {
+    this->filters[channel].addBatch(scans + channel, N, CHANNELS);
+  }
+}
+
+#endif  // DMAINGESTION_H
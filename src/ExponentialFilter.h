@@ -0,0 +1,327 @@
+/**
+ * @file ExponentialFilter.h
+ *
+ * @brief Template class for an Exponential Moving Average configured by time constant.
+ *
+ * This header provides an `ExponentialFilter` class template whose smoothing is set by a time
+ * constant or a cutoff frequency instead of a raw smoothing factor. For a fixed sample period the
+ * smoothing factor is computed once. For data points with timestamps, the smoothing factor
+ * 1 - e^(-dt / tau) is derived per data point from two small decay tables in flash, so jittering
+ * loop rates get consistent smoothing without calling `exp()` per sample. Integral types are
+ * averaged in fixed point.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef EXPONENTIALFILTER_H
+#define EXPONENTIALFILTER_H
+
+#include <stdint.h>
+#include <math.h>
+#include "FilterCore.h"
+#include "FilterTraits.h"
+#include "KernelStorage.h"
+#include "Reciprocal.h"
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+/**
+ * @brief Table based e^-x for smoothing factors.
+ *
+ * The exponent is split into its integer part, looked up in a table of e^-i, and its fraction,
+ * interpolated linearly in a table of e^(-j / STEPS). With 32 steps the result is within 2^-12 of
+ * e^-x. Both tables are generated at compile time and stored in program memory.
+ *
+ * @tparam STEPS The number of fraction table entries per unit of the exponent.
+ */
+template<uint8_t STEPS = 32>
+struct ExpDecay {
+  static_assert((STEPS & (STEPS - 1)) == 0, "the number of steps must be a power of two");
+
+  static const uint8_t WHOLE = 16;  // e^-16 rounds to 0 in Q15
+
+  static const FilterKernel<uint16_t, WHOLE> whole;
+  static const FilterKernel<uint16_t, STEPS + 1> fraction;
+
+  /**
+   * @brief Computes e^-x in Q15.
+   *
+   * @param exponent_q16 The exponent x in Q16.
+   * @return e^-x scaled by 2^15.
+   */
+  static uint16_t decayQ15(uint32_t exponent_q16) {
+    uint32_t integer = exponent_q16 >> 16;
+    if (integer >= WHOLE)
+      return 0;
+
+    const uint8_t step_bits = Reciprocal::ceilLog2(STEPS);
+    uint16_t position = uint16_t(exponent_q16 & 0xFFFF);
+    uint8_t index = position >> (16 - step_bits);
+    uint16_t remainder = position & ((1U << (16 - step_bits)) - 1);
+
+    uint16_t upper = ProgmemStorage::read(&fraction.coefficients[index]);
+    uint16_t lower = ProgmemStorage::read(&fraction.coefficients[index + 1]);
+    uint32_t interpolated = upper - ((uint32_t(upper - lower) * remainder) >> (16 - step_bits));
+    return uint16_t((uint32_t(ProgmemStorage::read(&whole.coefficients[integer])) * interpolated + 16384) >> 15);
+  }
+};
+
+template<uint8_t STEPS>
+const FilterKernel<uint16_t, ExpDecay<STEPS>::WHOLE> ExpDecay<STEPS>::whole PROGMEM =
+  FilterCore::expDecayKernel<uint16_t, ExpDecay<STEPS>::WHOLE, 1>();
+
+template<uint8_t STEPS>
+const FilterKernel<uint16_t, STEPS + 1> ExpDecay<STEPS>::fraction PROGMEM = FilterCore::expDecayKernel<uint16_t, STEPS + 1, STEPS>();
+
+/**
+ * @brief Exponential average state for floating point types.
+ *
+ * @tparam U The data type for average values.
+ * @tparam FIXED Whether U is integral.
+ */
+template<typename U, bool FIXED = FilterTraits<U>::INTEGRAL>
+class EmaAccumulator {
+public:
+  EmaAccumulator()
+    : average(0) {}
+
+  void reset(U value) {
+    this->average = value;
+  }
+
+  void step(U input, uint16_t alpha_q15) {
+    this->average += (input - this->average) * (alpha_q15 * (1.0f / 32768));
+  }
+
+  U read() const {
+    return this->average;
+  }
+
+private:
+  U average;
+};
+
+/**
+ * @brief Exponential average state for integral types.
+ *
+ * Keeps the average with 8 fractional bits, so small smoothing factors still move the average
+ * toward the input instead of stalling once the step rounds to zero.
+ *
+ * @tparam U The data type for average values.
+ */
+template<typename U>
+class EmaAccumulator<U, true> {
+public:
+  EmaAccumulator()
+    : scaled_average(0) {}
+
+  void reset(U value) {
+    this->scaled_average = Sum(value) * 256;
+  }
+
+  void step(U input, uint16_t alpha_q15) {
+    int64_t difference = int64_t(Sum(input)) * 256 - int64_t(this->scaled_average);
+    this->scaled_average += Sum((difference * alpha_q15 + 16384) >> 15);
+  }
+
+  U read() const {
+    return U((this->scaled_average + 128) >> 8);
+  }
+
+private:
+  typedef typename FilterTraits<U>::Sum Sum;
+
+  Sum scaled_average;
+};
+
+/**
+ * @brief Template class for an Exponential Moving Average with a time constant.
+ *
+ * The time constant tau is the time after which the response to a step has covered 63 % of the
+ * step. A cutoff frequency fc corresponds to tau = 1 / (2 * pi * fc). Data points added without a
+ * timestamp use the smoothing factor 1 - e^(-T / tau) of the configured sample period T, computed
+ * once. Data points added with a timestamp use the elapsed time since the previous data point.
+ * The first data point initialises the average.
+ *
+ * @tparam T The data type for input values (default: int16_t).
+ * @tparam U The data type for average values (default: int16_t).
+ */
+template<typename T = int16_t, typename U = int16_t>
+class ExponentialFilter {
+public:
+  ExponentialFilter();
+
+  void begin();
+  void end();
+  void setTimeConstant(float time_constant, float sample_period = 0);
+  void setCutoffFrequency(float cutoff_frequency, float sample_period = 0);
+  void add(T input);
+  void add(T input, uint32_t timestamp);
+  void print();
+  U read() const;
+  uint16_t readSmoothingFactor() const;
+
+private:
+  EmaAccumulator<U> average;
+  uint32_t inverse_time_constant;  // 2^(32 + shift) / tau in microseconds
+  uint32_t last_timestamp;
+  T input;
+  uint16_t alpha_q15;
+  uint8_t shift;
+  bool enabled;
+  bool primed;
+};
+
+/**
+ * @brief Constructs a new ExponentialFilter object.
+ *
+ * Until a time constant is set, every data point replaces the average.
+ */
+template<typename T, typename U>
+ExponentialFilter<T, U>::ExponentialFilter()
+  : inverse_time_constant(0), last_timestamp(0), input(0), alpha_q15(32768), shift(0), enabled(false), primed(false) {}
+
+/**
+ * @brief Enables the ExponentialFilter object.
+ */
+template<typename T, typename U>
+void ExponentialFilter<T, U>::begin() {
+  this->enabled = true;
+}
+
+/**
+ * @brief Disables the ExponentialFilter object.
+ */
+template<typename T, typename U>
+void ExponentialFilter<T, U>::end() {
+  this->enabled = false;
+}
+
+/**
+ * @brief Sets the time constant.
+ *
+ * Computes the smoothing factor for the sample period and the reciprocal of the time constant
+ * for timestamped data points. Calls exp() once, never per data point.
+ *
+ * @param time_constant The time constant tau in seconds.
+ * @param sample_period The period of data points added without timestamp in seconds, 0 if unused.
+ */
+template<typename T, typename U>
+void ExponentialFilter<T, U>::setTimeConstant(float time_constant, float sample_period) {
+  float time_constant_us = time_constant * 1e6f;
+  uint32_t tau = time_constant_us < 1 ? 1 : time_constant_us > 4e9f ? 4000000000UL : uint32_t(time_constant_us);
+
+  this->shift = Reciprocal::floorLog2(tau);
+  uint64_t inverse = (uint64_t(1) << (32 + this->shift)) / tau;
+  this->inverse_time_constant = inverse > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : uint32_t(inverse);
+
+  float alpha = time_constant > 0 ? 1 - float(exp(-sample_period / time_constant)) : 1;
+  this->alpha_q15 = uint16_t(FilterCore::emaAlphaQ15(alpha));
+}
+
+/**
+ * @brief Sets the cutoff frequency of the equivalent first-order low-pass filter.
+ *
+ * @param cutoff_frequency The -3 dB frequency fc in hertz.
+ * @param sample_period The period of data points added without timestamp in seconds, 0 if unused.
+ */
+template<typename T, typename U>
+void ExponentialFilter<T, U>::setCutoffFrequency(float cutoff_frequency, float sample_period) {
+  this->setTimeConstant(1 / (6.2831853f * cutoff_frequency), sample_period);
+}
+
+/**
+ * @brief Adds a data point taken at the configured sample period.
+ *
+ * @param input The new data point.
+ */
+template<typename T, typename U>
+void ExponentialFilter<T, U>::add(T input) {
+  if (!this->enabled)
+    return;
+
+  this->input = input;
+  if (!this->primed) {
+    this->average.reset(U(input));
+    this->primed = true;
+    return;
+  }
+  this->average.step(U(input), this->alpha_q15);
+}
+
+/**
+ * @brief Adds a data point with its timestamp.
+ *
+ * Derives the smoothing factor from the time since the previous data point with a table lookup,
+ * a linear interpolation and a 32x32->64 multiplication.
+ *
+ * @param input The new data point.
+ * @param timestamp The time of the data point in microseconds, e.g. from micros(). Wrap-around is
+ * handled as long as data points are less than 71 minutes apart.
+ */
+template<typename T, typename U>
+void ExponentialFilter<T, U>::add(T input, uint32_t timestamp) {
+  if (!this->enabled)
+    return;
+
+  uint32_t elapsed = timestamp - this->last_timestamp;
+  this->last_timestamp = timestamp;
+  this->input = input;
+  if (!this->primed) {
+    this->average.reset(U(input));
+    this->primed = true;
+    return;
+  }
+
+  uint64_t exponent_q16 = (uint64_t(elapsed) * this->inverse_time_constant) >> (16 + this->shift);
+  uint16_t decay = this->inverse_time_constant == 0 ? 0 : ExpDecay<>::decayQ15(exponent_q16 > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : uint32_t(exponent_q16));
+  this->average.step(U(input), uint16_t(32768 - decay));
+}
+
+/**
+ * @brief Prints the raw data and the average.
+ */
+template<typename T, typename U>
+void ExponentialFilter<T, U>::print() {
+  while (!Serial) {
+  }
+
+  Serial.print("Raw-Data:");
+  Serial.print(this->input);
+  Serial.print("\tEMA:");
+  Serial.print(this->read());
+  Serial.print("\n");
+}
+
+/**
+ * @brief Returns the Exponential Moving Average.
+ *
+ * @return The average, 0 if the object is disabled.
+ */
+template<typename T, typename U>
+U ExponentialFilter<T, U>::read() const {
+  if (!this->enabled)
+    return 0;
+
+  return this->average.read();
+}
+
+/**
+ * @brief Returns the smoothing factor used for data points without timestamp.
+ *
+ * @return The smoothing factor in Q15.
+ */
+template<typename T, typename U>
+uint16_t ExponentialFilter<T, U>::readSmoothingFactor() const {
+  return this->alpha_q15;
+}
+
+#endif  // EXPONENTIALFILTER_H
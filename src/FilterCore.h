@@ -0,0 +1,343 @@
+/**
+ * @file FilterCore.h
+ *
+ * @brief constexpr building blocks of the moving average filters.
+ *
+ * This header provides the arithmetic shared by the filters (ring index update, SMA/WMA/EMA
+ * steps, fixed-point smoothing factors) and generators for coefficient tables (box, WMA and
+ * binomial kernels, WMA normalisers). Everything is `constexpr` under C++11, so tables can be
+ * computed by the compiler and placed in flash instead of being built on every boot, and filter
+ * outputs can be checked with `static_assert`.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef FILTERCORE_H
+#define FILTERCORE_H
+
+#include <stdint.h>
+
+/**
+ * @brief Fixed-size table of filter coefficients.
+ *
+ * An aggregate, so a `constexpr FilterKernel` is a literal that the compiler can place in
+ * read-only memory.
+ *
+ * @tparam C The data type of the coefficients.
+ * @tparam N The number of coefficients.
+ */
+template<typename C, uint8_t N>
+struct FilterKernel {
+  C coefficients[N];
+
+  constexpr C operator[](uint8_t index) const {
+    return coefficients[index];
+  }
+
+  constexpr uint8_t size() const {
+    return N;
+  }
+
+  constexpr C sum(uint8_t count = N) const {
+    return count == 0 ? C(0) : coefficients[count - 1] + sum(count - 1);
+  }
+};
+
+/**
+ * @brief Compile-time list of kernel indices, a C++11 stand-in for std::index_sequence.
+ */
+template<uint8_t... I>
+struct KernelIndices {};
+
+template<uint8_t N, uint8_t... I>
+struct MakeKernelIndices : MakeKernelIndices<N - 1, N - 1, I...> {};
+
+template<uint8_t... I>
+struct MakeKernelIndices<0, I...> {
+  typedef KernelIndices<I...> Type;
+};
+
+/**
+ * @brief constexpr arithmetic of the moving average filters.
+ *
+ * All members are static, the struct only groups them.
+ */
+struct FilterCore {
+  /**
+   * @brief Advances a ring buffer index.
+   *
+   * @param index The current index.
+   * @param capacity The capacity of the ring.
+   * @return The next index, wrapping to 0 at the capacity.
+   */
+  template<typename S>
+  static constexpr S ringNext(S index, S capacity) {
+    return index + 1 < capacity ? S(index + 1) : S(0);
+  }
+
+  /**
+   * @brief Updates a window sum.
+   *
+   * @param sum The sum of the window.
+   * @param incoming The data point entering the window.
+   * @param outgoing The data point leaving the window, 0 while the window fills.
+   * @return The updated sum.
+   */
+  template<typename S>
+  static constexpr S smaStep(S sum, S incoming, S outgoing) {
+    return sum + incoming - outgoing;
+  }
+
+  /**
+   * @brief Updates the weighted sum of a window with weights 1 (oldest) to length (newest).
+   *
+   * While the window fills, the new data point gets the weight of the new length. Once full,
+   * every weight drops by one, which subtracts the previous window sum.
+   *
+   * @param weighted_sum The weighted sum of the window.
+   * @param sum The plain sum of the window before the update.
+   * @param incoming The data point entering the window.
+   * @param length The window length after the update.
+   * @param full Whether the window was full before the update.
+   * @return The updated weighted sum.
+   */
+  template<typename S, typename L>
+  static constexpr S wmaStep(S weighted_sum, S sum, S incoming, L length, bool full) {
+    return full ? weighted_sum + incoming * S(length) - sum : weighted_sum + incoming * S(length);
+  }
+
+  /**
+   * @brief Returns the sum of the WMA weights 1 to length.
+   *
+   * @param length The window length.
+   * @return The normaliser length * (length + 1) / 2.
+   */
+  template<typename S>
+  static constexpr S wmaWeightTotal(S length) {
+    return length * (length + 1) / 2;
+  }
+
+  /**
+   * @brief Returns the numerator of the least-squares slope of a window.
+   *
+   * With positions 1 (oldest) to length (newest), the slope per data point is
+   * 6 * numerator / (length * (length^2 - 1)), where numerator = 2 * weighted_sum - (length + 1) * sum.
+   * The terms are added in an order that keeps every intermediate within the bound of the weighted
+   * sum, given (length + 1) * sum fits S.
+   *
+   * @param weighted_sum The weighted sum of the window, weights 1 to length.
+   * @param sum The plain sum of the window.
+   * @param length The window length.
+   * @return The numerator of the slope.
+   */
+  template<typename S, typename L>
+  static constexpr S slopeNumerator(S weighted_sum, S sum, L length) {
+    return (weighted_sum - S(length + 1) * sum) + weighted_sum;
+  }
+
+  /**
+   * @brief Returns the numerator of the least-squares line at the newest data point.
+   *
+   * The line through the window, evaluated at position length, is numerator / wmaWeightTotal(length),
+   * where numerator = 3 * weighted_sum - (length + 1) * sum, i.e. 3 * WMA - 2 * SMA.
+   *
+   * @param weighted_sum The weighted sum of the window, weights 1 to length.
+   * @param sum The plain sum of the window.
+   * @param length The window length.
+   * @return The numerator of the trend.
+   */
+  template<typename S, typename L>
+  static constexpr S trendNumerator(S weighted_sum, S sum, L length) {
+    return slopeNumerator(weighted_sum, sum, length) + weighted_sum;
+  }
+
+  /**
+   * @brief Converts a value to an integral type, saturating at its range.
+   *
+   * @tparam U The integral target type.
+   * @param value The value.
+   * @return The value, or the smallest or largest value of U if it does not fit.
+   */
+  template<typename U, typename S>
+  static constexpr U saturate(S value) {
+    return S(U(value)) == value ? U(value) : value < S(0) ? lowest<U>() : highest<U>();
+  }
+
+  /**
+   * @brief Returns the largest value of an integral type.
+   */
+  template<typename U>
+  static constexpr U highest() {
+    return U(-1) < U(0) ? U((uint64_t(1) << (8 * sizeof(U) - 1)) - 1) : U(U(0) - U(1));
+  }
+
+  /**
+   * @brief Returns the smallest value of an integral type.
+   */
+  template<typename U>
+  static constexpr U lowest() {
+    return U(-1) < U(0) ? U(-highest<U>() - 1) : U(0);
+  }
+
+  /**
+   * @brief Blends a data point into an Exponential Moving Average.
+   *
+   * @param average The previous average.
+   * @param input The new data point.
+   * @param smoothing_factor The weight of the new data point in the interval [0; 1].
+   * @return The updated average.
+   */
+  static constexpr float emaStep(float average, float input, float smoothing_factor) {
+    return smoothing_factor * input + (1 - smoothing_factor) * average;
+  }
+
+  /**
+   * @brief Converts a smoothing factor to Q15 fixed point.
+   *
+   * @param smoothing_factor The smoothing factor in the interval [0; 1].
+   * @return The smoothing factor scaled by 2^15 and rounded.
+   */
+  static constexpr int32_t emaAlphaQ15(float smoothing_factor) {
+    return int32_t(smoothing_factor * 32768.0f + 0.5f);
+  }
+
+  /**
+   * @brief Blends a data point into an Exponential Moving Average in fixed point.
+   *
+   * @param average The previous average.
+   * @param input The new data point.
+   * @param alpha_q15 The smoothing factor in Q15, see emaAlphaQ15().
+   * @return The updated average, rounded toward the previous average.
+   */
+  template<typename S>
+  static constexpr S emaStepFixed(S average, S input, int32_t alpha_q15) {
+    return average + S((int64_t(input) - int64_t(average)) * alpha_q15 / 32768);
+  }
+
+  /**
+   * @brief Computes e^-x in a constant expression.
+   *
+   * Halves the argument until it is at most 0.5, evaluates a Taylor polynomial in Horner form and
+   * squares the result back. Meant for generating tables, not for use at run time.
+   *
+   * @param x The non-negative exponent.
+   * @return e^-x.
+   */
+  static constexpr double expNegative(double x) {
+    return x > 0.5 ? squared(expNegative(x / 2)) : expHorner(x, 1);
+  }
+
+  /**
+   * @brief Computes a binomial coefficient.
+   *
+   * @param n The number of elements.
+   * @param k The number of chosen elements.
+   * @return n choose k.
+   */
+  static constexpr uint32_t binomial(uint8_t n, uint8_t k) {
+    return k == 0 ? 1 : binomial(n, k - 1) * (n - k + 1) / k;
+  }
+
+  /**
+   * @brief Sums values, e.g. a window, in a constant expression.
+   *
+   * @param values The values.
+   * @param count The number of values.
+   * @return The sum of the values.
+   */
+  template<typename S, typename V>
+  static constexpr S sum(const V* values, uint8_t count) {
+    return count == 0 ? S(0) : S(values[count - 1]) + sum<S>(values, count - 1);
+  }
+
+  /**
+   * @brief Generates a box (SMA) kernel of ones.
+   */
+  template<typename C, uint8_t N>
+  static constexpr FilterKernel<C, N> boxKernel() {
+    return boxKernel<C>(typename MakeKernelIndices<N>::Type());
+  }
+
+  /**
+   * @brief Generates a WMA kernel with weights 1 (oldest) to N (newest).
+   */
+  template<typename C, uint8_t N>
+  static constexpr FilterKernel<C, N> wmaKernel() {
+    return wmaKernel<C>(typename MakeKernelIndices<N>::Type());
+  }
+
+  /**
+   * @brief Generates a binomial kernel, a smooth approximation of a Gaussian.
+   *
+   * The coefficients sum to 2^(N - 1).
+   */
+  template<typename C, uint8_t N>
+  static constexpr FilterKernel<C, N> binomialKernel() {
+    return binomialKernel<C, N>(typename MakeKernelIndices<N>::Type());
+  }
+
+  /**
+   * @brief Generates the WMA normalisers for the window lengths 1 to N.
+   */
+  template<typename C, uint8_t N>
+  static constexpr FilterKernel<C, N> wmaNormalisers() {
+    return wmaNormalisers<C>(typename MakeKernelIndices<N>::Type());
+  }
+
+  /**
+   * @brief Generates the decay factors e^(-i / STEPS) for i = 0 to N - 1 in Q15.
+   */
+  template<typename C, uint8_t N, uint8_t STEPS>
+  static constexpr FilterKernel<C, N> expDecayKernel() {
+    return expDecayKernel<C, STEPS>(typename MakeKernelIndices<N>::Type());
+  }
+
+private:
+  static constexpr double squared(double value) {
+    return value * value;
+  }
+
+  static constexpr double expHorner(double x, uint8_t term) {
+    return term > 12 ? 1 : 1 - x / term * expHorner(x, term + 1);
+  }
+
+  template<typename C, uint8_t... I>
+  static constexpr FilterKernel<C, sizeof...(I)> boxKernel(KernelIndices<I...>) {
+    return { { C(I - I + 1)... } };
+  }
+
+  template<typename C, uint8_t... I>
+  static constexpr FilterKernel<C, sizeof...(I)> wmaKernel(KernelIndices<I...>) {
+    return { { C(I + 1)... } };
+  }
+
+  template<typename C, uint8_t N, uint8_t... I>
+  static constexpr FilterKernel<C, N> binomialKernel(KernelIndices<I...>) {
+    return { { C(binomial(N - 1, I))... } };
+  }
+
+  template<typename C, uint8_t... I>
+  static constexpr FilterKernel<C, sizeof...(I)> wmaNormalisers(KernelIndices<I...>) {
+    return { { wmaWeightTotal(C(I + 1))... } };
+  }
+
+  template<typename C, uint8_t STEPS, uint8_t... I>
+  static constexpr FilterKernel<C, sizeof...(I)> expDecayKernel(KernelIndices<I...>) {
+    return { { C(expNegative(double(I) / STEPS) * 32768 + 0.5)... } };
+  }
+};
+
+static_assert(FilterCore::ringNext<uint8_t>(9, 10) == 0, "ring index must wrap at the capacity");
+static_assert(FilterCore::wmaKernel<uint16_t, 10>().sum() == FilterCore::wmaWeightTotal<uint16_t>(10),
+              "WMA kernel must sum to its normaliser");
+static_assert(FilterCore::binomialKernel<uint16_t, 5>().sum() == 16, "binomial kernel must sum to 2^(N - 1)");
+static_assert(FilterCore::emaStepFixed<int32_t>(0, 1000, FilterCore::emaAlphaQ15(0.25f)) == 250,
+              "fixed-point EMA must match the float step");
+static_assert(FilterCore::expDecayKernel<uint16_t, 3, 1>()[1] == 12055 && FilterCore::expDecayKernel<uint16_t, 3, 1>()[2] == 4435,
+              "decay table must hold e^-1 and e^-2 in Q15");
+
+#endif  // FILTERCORE_H
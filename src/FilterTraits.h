@@ -0,0 +1,142 @@
+/**
+ * @file FilterTraits.h
+ *
+ * @brief Type traits selecting the accumulator types of the moving average filters.
+ *
+ * Running sums of a window overflow the sample type quickly, e.g. 255 samples of an `int16_t`.
+ * `FilterTraits` maps every arithmetic type to a `Sum` type wide enough for window sums and a
+ * `Total` type wide enough for cumulative sums over long streams. Floating point types accumulate
+ * in `double`. The traits are keyed by the fundamental types, not the `<stdint.h>` aliases, so they
+ * work regardless of whether e.g. `int32_t` is an `int` or a `long` on the target.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef FILTERTRAITS_H
+#define FILTERTRAITS_H
+
+#include <stdint.h>
+
+/**
+ * @brief Accumulator types for integral values of a given size and signedness.
+ *
+ * @tparam SIZE The size of the integral type in bytes.
+ * @tparam SIGNED Whether the integral type is signed.
+ */
+template<uint8_t SIZE, bool SIGNED>
+struct FilterWidening {
+  typedef int64_t Sum;
+  typedef int64_t Total;
+};
+
+template<uint8_t SIZE>
+struct FilterWidening<SIZE, false> {
+  typedef uint64_t Sum;
+  typedef uint64_t Total;
+};
+
+template<>
+struct FilterWidening<1, true> {
+  typedef int32_t Sum;
+  typedef int64_t Total;
+};
+
+template<>
+struct FilterWidening<1, false> {
+  typedef uint32_t Sum;
+  typedef uint64_t Total;
+};
+
+template<>
+struct FilterWidening<2, true> {
+  typedef int32_t Sum;
+  typedef int64_t Total;
+};
+
+template<>
+struct FilterWidening<2, false> {
+  typedef uint32_t Sum;
+  typedef uint64_t Total;
+};
+
+/**
+ * @brief Accumulator types for a value type.
+ *
+ * The primary template covers floating point types.
+ *
+ * @tparam U The data type of the values being accumulated.
+ */
+template<typename U>
+struct FilterTraits {
+  typedef double Sum;
+  typedef double Total;
+  static const bool INTEGRAL = false;
+};
+
+#define FILTERTRAITS_INTEGRAL(type) \
+  template<> \
+  struct FilterTraits<type> : FilterWidening<sizeof(type), ((type)(-1) < (type)0)> { \
+    static const bool INTEGRAL = true; \
+  }
+
+FILTERTRAITS_INTEGRAL(char);
+FILTERTRAITS_INTEGRAL(signed char);
+FILTERTRAITS_INTEGRAL(unsigned char);
+FILTERTRAITS_INTEGRAL(short);
+FILTERTRAITS_INTEGRAL(unsigned short);
+FILTERTRAITS_INTEGRAL(int);
+FILTERTRAITS_INTEGRAL(unsigned int);
+FILTERTRAITS_INTEGRAL(long);
+FILTERTRAITS_INTEGRAL(unsigned long);
+FILTERTRAITS_INTEGRAL(long long);
+FILTERTRAITS_INTEGRAL(unsigned long long);
+
+#undef FILTERTRAITS_INTEGRAL
+
+/**
+ * @brief Accumulator type for the sums of a window.
+ *
+ * Windows of up to 255 values are summed in `FilterTraits<U>::Sum`, longer windows in the `Total`
+ * type, e.g. 65535 samples of an `int16_t` overflow an `int32_t` weighted sum.
+ *
+ * @tparam U The data type of the values being accumulated.
+ * @tparam W The data type of the window length.
+ */
+template<typename U, typename W>
+struct WindowTraits {
+  typedef typename FilterTraits<U>::Total Sum;
+};
+
+template<typename U>
+struct WindowTraits<U, uint8_t> {
+  typedef typename FilterTraits<U>::Sum Sum;
+};
+
+/**
+ * @brief Signed type for signed combinations of window sums.
+ *
+ * Signed and floating point sums are kept, unsigned sums widen to `int64_t`, so e.g. a falling
+ * trend of `uint16_t` data stays negative.
+ *
+ * @tparam S The type of the window sums.
+ */
+template<typename S>
+struct SignedSum {
+  typedef S Type;
+};
+
+template<>
+struct SignedSum<uint32_t> {
+  typedef int64_t Type;
+};
+
+template<>
+struct SignedSum<uint64_t> {
+  typedef int64_t Type;
+};
+
+#endif  // FILTERTRAITS_H
@@ -0,0 +1,161 @@
+/**
+ * @file FirFilter.h
+ *
+ * @brief Template class for Finite Impulse Response (FIR) filtering with custom kernels.
+ *
+ * This header provides a `FirFilter` class template that convolves the last N data points with a
+ * user supplied kernel, e.g. a binomial or WMA kernel generated by `FilterCore`. The kernel is read
+ * through a storage trait from `KernelStorage.h`, so long kernels can stay in flash on AVR while
+ * only the sample ring occupies RAM.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef FIRFILTER_H
+#define FIRFILTER_H
+
+#include <stdint.h>
+#include "FilterCore.h"
+#include "FilterTraits.h"
+#include "KernelStorage.h"
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+/**
+ * @brief Template class for FIR filtering.
+ *
+ * The first coefficient weighs the oldest data point, the last coefficient the newest one. The
+ * output is normalised by the sum of the coefficients in use, so kernels need not be scaled and
+ * a partly filled window weighs its data points with the newest coefficients only.
+ *
+ * The default accumulator is 64 bits wide for integral types, which no kernel can overflow. On
+ * 8-bit boards every 64-bit multiply-accumulate is a library call, so pass a 32-bit accumulator
+ * when the largest sum of coefficient times data point fits into it, e.g. `int32_t` for 16-bit data
+ * points and a kernel whose coefficients sum to at most 2^15.
+ *
+ * @tparam T The data type for input values.
+ * @tparam U The data type for filtered values.
+ * @tparam C The data type of the kernel coefficients.
+ * @tparam N The number of taps.
+ * @tparam Storage The storage trait used to read the kernel, RamStorage or ProgmemStorage.
+ * @tparam S The data type of the accumulator (default: the Total type of FilterTraits).
+ */
+template<typename T, typename U, typename C, uint8_t N, typename Storage = RamStorage, typename S = typename FilterTraits<U>::Total>
+class FirFilter {
+public:
+  explicit FirFilter(const C* kernel);
+
+  void begin();
+  void end();
+  void add(T input);
+  void print();
+  U read();
+
+private:
+  const C* kernel;
+  U window[N];
+  T input;
+  U output;
+  uint8_t head;
+  uint8_t num_elements;
+  bool enabled;
+};
+
+/**
+ * @brief Constructs a new FirFilter object.
+ *
+ * @param kernel Pointer to the N coefficients, in RAM or program memory depending on Storage.
+ */
+template<typename T, typename U, typename C, uint8_t N, typename Storage, typename S>
+FirFilter<T, U, C, N, Storage, S>::FirFilter(const C* kernel)
+  : kernel(kernel), input(0), output(0), head(0), num_elements(0), enabled(false) {}
+
+/**
+ * @brief Enables the FirFilter object.
+ */
+template<typename T, typename U, typename C, uint8_t N, typename Storage, typename S>
+void FirFilter<T, U, C, N, Storage, S>::begin() {
+  this->enabled = true;
+}
+
+/**
+ * @brief Disables the FirFilter object.
+ */
+template<typename T, typename U, typename C, uint8_t N, typename Storage, typename S>
+void FirFilter<T, U, C, N, Storage, S>::end() {
+  this->enabled = false;
+}
+
+/**
+ * @brief Adds a new data point to the ring.
+ *
+ * @param input The new data point to be added.
+ */
+template<typename T, typename U, typename C, uint8_t N, typename Storage, typename S>
+void FirFilter<T, U, C, N, Storage, S>::add(T input) {
+  this->input = input;
+  this->window[this->head] = input;
+  this->head = FilterCore::ringNext<uint8_t>(this->head, N);
+  if (this->num_elements < N)
+    this->num_elements++;
+}
+
+/**
+ * @brief Prints the raw data and the last filter output.
+ */
+template<typename T, typename U, typename C, uint8_t N, typename Storage, typename S>
+void FirFilter<T, U, C, N, Storage, S>::print() {
+  while (!Serial) {
+  }
+
+  Serial.print("Raw-Data:");
+  Serial.print(this->input);
+  Serial.print("\tFIR:");
+  Serial.print(this->output);
+  Serial.print("\n");
+}
+
+/**
+ * @brief Convolves the ring with the kernel.
+ *
+ * Costs N multiply-accumulates, plus one storage read per coefficient. If the object is disabled
+ * or empty, returns 0.
+ *
+ * @return The filtered value.
+ */
+template<typename T, typename U, typename C, uint8_t N, typename Storage, typename S>
+U FirFilter<T, U, C, N, Storage, S>::read() {
+  if (!this->enabled || this->num_elements == 0)
+    return 0;
+
+  S sum = 0;
+  S weight_total = 0;
+  const C* coefficient = this->kernel + (N - this->num_elements);
+  uint8_t index = this->num_elements < N ? 0 : this->head;
+
+  // Walk from the oldest to the newest data point in two contiguous runs, avoiding a modulo per tap.
+  uint8_t first_run = this->num_elements < N ? this->num_elements : N - this->head;
+  for (uint8_t i = 0; i < first_run; i++, coefficient++) {
+    C weight = Storage::read(coefficient);
+    sum += S(weight) * this->window[index + i];
+    weight_total += weight;
+  }
+  for (uint8_t i = 0; i < this->num_elements - first_run; i++, coefficient++) {
+    C weight = Storage::read(coefficient);
+    sum += S(weight) * this->window[i];
+    weight_total += weight;
+  }
+
+  this->output = weight_total != 0 ? U(sum / weight_total) : U(0);
+  return this->output;
+}
+
+#endif  // FIRFILTER_H
@@ -0,0 +1,505 @@
+/**
+ * @file KalmanFilter.h
+ *
+ * @brief Template classes for scalar Kalman filtering with O(1) updates.
+ *
+ * This header provides a `KalmanFilter` class template for a 1-D random walk model and a
+ * `KalmanVelocityFilter` class template for a 2-state constant velocity model. Both are tuned by
+ * explicit process and measurement noise instead of a smoothing factor, never allocate and follow
+ * the `add`/`read`/`print` conventions of `MovingAverage`. The gains of a time-invariant Kalman
+ * filter converge to a steady state; once they have, or right away if the steady state is
+ * requested, an update costs the same as an Exponential Moving Average. Integral types keep their
+ * state in fixed point with Q15 gains, floating point types in their own type.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef KALMANFILTER_H
+#define KALMANFILTER_H
+
+#include <stdint.h>
+#include <math.h>
+#include "FilterCore.h"
+#include "FilterTraits.h"
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+/**
+ * @brief Arithmetic of the filter state for floating point types.
+ *
+ * @tparam U The data type for filtered values.
+ * @tparam FIXED Whether U is integral.
+ */
+template<typename U, bool FIXED = FilterTraits<U>::INTEGRAL>
+struct StateArithmetic {
+  typedef U Scalar;
+  typedef float Gain;
+
+  static Scalar fromValue(U value) {
+    return value;
+  }
+
+  static U toValue(Scalar scalar) {
+    return scalar;
+  }
+
+  static Gain toGain(float gain) {
+    return gain;
+  }
+
+  static Scalar scale(Scalar scalar, Gain gain) {
+    return scalar * gain;
+  }
+};
+
+/**
+ * @brief Arithmetic of the filter state for integral types.
+ *
+ * States carry 8 fractional bits in the widened sum type, gains are Q15. The sum type of unsigned
+ * values widens to a signed type, as residuals and velocities are negative for falling signals.
+ *
+ * @tparam U The data type for filtered values.
+ */
+template<typename U>
+struct StateArithmetic<U, true> {
+  typedef typename SignedSum<typename FilterTraits<U>::Sum>::Type Scalar;
+  typedef int32_t Gain;
+
+  static Scalar fromValue(U value) {
+    return Scalar(value) * 256;
+  }
+
+  static U toValue(Scalar scalar) {
+    return U((scalar + 128) >> 8);
+  }
+
+  static Gain toGain(float gain) {
+    return FilterCore::emaAlphaQ15(gain);
+  }
+
+  static Scalar scale(Scalar scalar, Gain gain) {
+    return Scalar((int64_t(scalar) * gain + 16384) >> 15);
+  }
+};
+
+/**
+ * @brief Template class for a 1-D Kalman filter.
+ *
+ * Models the signal as a random walk with process noise variance Q per data point, measured with
+ * measurement noise variance R. A larger Q / R follows the data points more closely, a smaller one
+ * smooths more. The first data point initialises the estimate with variance R.
+ *
+ * The gain is tracked in float until it changes by less than 1e-5 per data point, after which it
+ * is set to the closed-form steady-state gain and an update is a single fixed-point or float
+ * multiply-add, like an EMA with the steady-state gain as smoothing factor.
+ *
+ * @tparam T The data type for input values (default: int16_t).
+ * @tparam U The data type for filtered values (default: int16_t).
+ */
+template<typename T = int16_t, typename U = int16_t>
+class KalmanFilter {
+public:
+  KalmanFilter();
+
+  void begin();
+  void end();
+  void setNoise(float process_noise, float measurement_noise);
+  void useSteadyState();
+  void add(T input);
+  void print();
+  U read() const;
+  float readGain() const;
+  bool converged() const;
+
+  static float steadyStateGain(float process_noise, float measurement_noise);
+
+private:
+  typedef StateArithmetic<U> Arithmetic;
+
+  typename Arithmetic::Scalar estimate;
+  typename Arithmetic::Gain gain;
+  float variance;
+  float process_noise;
+  float measurement_noise;
+  float last_gain;
+  T input;
+  bool enabled;
+  bool primed;
+  bool steady;
+};
+
+/**
+ * @brief Constructs a new KalmanFilter object.
+ *
+ * Starts with a process and measurement noise of 1.
+ */
+template<typename T, typename U>
+KalmanFilter<T, U>::KalmanFilter()
+  : estimate(0), gain(0), variance(0), process_noise(1), measurement_noise(1), last_gain(0), input(0), enabled(false),
+    primed(false), steady(false) {}
+
+/**
+ * @brief Enables the KalmanFilter object.
+ */
+template<typename T, typename U>
+void KalmanFilter<T, U>::begin() {
+  this->enabled = true;
+}
+
+/**
+ * @brief Disables the KalmanFilter object.
+ */
+template<typename T, typename U>
+void KalmanFilter<T, U>::end() {
+  this->enabled = false;
+}
+
+/**
+ * @brief Sets the noise variances and restarts the gain tracking.
+ *
+ * @param process_noise The variance Q of the change of the signal per data point.
+ * @param measurement_noise The variance R of the measurement noise, greater than 0.
+ */
+template<typename T, typename U>
+void KalmanFilter<T, U>::setNoise(float process_noise, float measurement_noise) {
+  this->process_noise = process_noise;
+  this->measurement_noise = measurement_noise;
+  this->steady = false;
+}
+
+/**
+ * @brief Skips the convergence and uses the steady-state gain from now on.
+ */
+template<typename T, typename U>
+void KalmanFilter<T, U>::useSteadyState() {
+  this->last_gain = steadyStateGain(this->process_noise, this->measurement_noise);
+  this->gain = Arithmetic::toGain(this->last_gain);
+  this->steady = true;
+}
+
+/**
+ * @brief Adds a measurement and updates the estimate.
+ *
+ * @param input The new measurement.
+ */
+template<typename T, typename U>
+void KalmanFilter<T, U>::add(T input) {
+  if (!this->enabled)
+    return;
+
+  this->input = input;
+  if (!this->primed) {
+    this->estimate = Arithmetic::fromValue(U(input));
+    this->variance = this->measurement_noise;
+    this->primed = true;
+    return;
+  }
+
+  if (!this->steady) {
+    float predicted = this->variance + this->process_noise;
+    float gain = predicted / (predicted + this->measurement_noise);
+    this->variance = (1 - gain) * predicted;
+    bool settled = fabs(gain - this->last_gain) < 1e-5f;
+    this->last_gain = gain;
+    this->gain = Arithmetic::toGain(gain);
+    if (settled)
+      this->useSteadyState();
+  }
+
+  this->estimate += Arithmetic::scale(Arithmetic::fromValue(U(input)) - this->estimate, this->gain);
+}
+
+/**
+ * @brief Prints the raw data and the estimate.
+ */
+template<typename T, typename U>
+void KalmanFilter<T, U>::print() {
+  while (!Serial) {
+  }
+
+  Serial.print("Raw-Data:");
+  Serial.print(this->input);
+  Serial.print("\tKF:");
+  Serial.print(this->read());
+  Serial.print("\n");
+}
+
+/**
+ * @brief Returns the estimate.
+ *
+ * @return The filtered value, 0 if the object is disabled.
+ */
+template<typename T, typename U>
+U KalmanFilter<T, U>::read() const {
+  if (!this->enabled)
+    return 0;
+
+  return Arithmetic::toValue(this->estimate);
+}
+
+/**
+ * @brief Returns the gain of the last update.
+ *
+ * @return The Kalman gain in the interval [0; 1].
+ */
+template<typename T, typename U>
+float KalmanFilter<T, U>::readGain() const {
+  return this->last_gain;
+}
+
+/**
+ * @brief Returns whether the gain is frozen at its steady state.
+ *
+ * @return True once updates cost the same as an EMA.
+ */
+template<typename T, typename U>
+bool KalmanFilter<T, U>::converged() const {
+  return this->steady;
+}
+
+/**
+ * @brief Computes the steady-state gain of the random walk model.
+ *
+ * Solves the Riccati equation P = (P + Q) R / (P + Q + R) for the predicted variance
+ * M = P + Q = (Q + sqrt(Q^2 + 4 Q R)) / 2 and returns M / (M + R).
+ *
+ * @param process_noise The variance Q of the change of the signal per data point.
+ * @param measurement_noise The variance R of the measurement noise.
+ * @return The steady-state gain, usable as EMA smoothing factor.
+ */
+template<typename T, typename U>
+float KalmanFilter<T, U>::steadyStateGain(float process_noise, float measurement_noise) {
+  float predicted = (process_noise + sqrtf(process_noise * process_noise + 4 * process_noise * measurement_noise)) / 2;
+  return predicted / (predicted + measurement_noise);
+}
+
+/**
+ * @brief Template class for a 2-state constant velocity Kalman filter.
+ *
+ * Models the signal as a position moving with a velocity that changes by white acceleration noise
+ * of variance Q per data point, measured with measurement noise variance R. Time is counted in data
+ * points, so the velocity is the change of the signal per data point; multiply it by the sample
+ * rate for a change per second. The first data point initialises the position, the velocity
+ * starts at 0.
+ *
+ * Once the gains have converged, they are set to their closed-form steady state and the filter is
+ * the alpha-beta filter with these gains, costing two multiply-adds per data point.
+ *
+ * @tparam T The data type for input values (default: int16_t).
+ * @tparam U The data type for filtered values (default: int16_t).
+ */
+template<typename T = int16_t, typename U = int16_t>
+class KalmanVelocityFilter {
+public:
+  KalmanVelocityFilter();
+
+  void begin();
+  void end();
+  void setNoise(float acceleration_noise, float measurement_noise);
+  void useSteadyState();
+  void add(T input);
+  void print();
+  U read() const;
+  U readVelocity() const;
+  bool converged() const;
+
+  static void steadyStateGains(float acceleration_noise, float measurement_noise, float& position_gain, float& velocity_gain);
+
+private:
+  typedef StateArithmetic<U> Arithmetic;
+
+  typename Arithmetic::Scalar position;
+  typename Arithmetic::Scalar velocity;
+  typename Arithmetic::Gain position_gain;
+  typename Arithmetic::Gain velocity_gain;
+  float covariance[3];  // Position variance, covariance, velocity variance
+  float acceleration_noise;
+  float measurement_noise;
+  float last_gains[2];
+  T input;
+  bool enabled;
+  bool primed;
+  bool steady;
+};
+
+/**
+ * @brief Constructs a new KalmanVelocityFilter object.
+ *
+ * Starts with an acceleration and measurement noise of 1.
+ */
+template<typename T, typename U>
+KalmanVelocityFilter<T, U>::KalmanVelocityFilter()
+  : position(0), velocity(0), position_gain(0), velocity_gain(0), covariance(), acceleration_noise(1), measurement_noise(1),
+    last_gains(), input(0), enabled(false), primed(false), steady(false) {}
+
+/**
+ * @brief Enables the KalmanVelocityFilter object.
+ */
+template<typename T, typename U>
+void KalmanVelocityFilter<T, U>::begin() {
+  this->enabled = true;
+}
+
+/**
+ * @brief Disables the KalmanVelocityFilter object.
+ */
+template<typename T, typename U>
+void KalmanVelocityFilter<T, U>::end() {
+  this->enabled = false;
+}
+
+/**
+ * @brief Sets the noise variances and restarts the gain tracking.
+ *
+ * @param acceleration_noise The variance Q of the change of the velocity per data point.
+ * @param measurement_noise The variance R of the measurement noise, greater than 0.
+ */
+template<typename T, typename U>
+void KalmanVelocityFilter<T, U>::setNoise(float acceleration_noise, float measurement_noise) {
+  this->acceleration_noise = acceleration_noise;
+  this->measurement_noise = measurement_noise;
+  this->steady = false;
+}
+
+/**
+ * @brief Skips the convergence and uses the steady-state gains from now on.
+ */
+template<typename T, typename U>
+void KalmanVelocityFilter<T, U>::useSteadyState() {
+  steadyStateGains(this->acceleration_noise, this->measurement_noise, this->last_gains[0], this->last_gains[1]);
+  this->position_gain = Arithmetic::toGain(this->last_gains[0]);
+  this->velocity_gain = Arithmetic::toGain(this->last_gains[1]);
+  this->steady = true;
+}
+
+/**
+ * @brief Adds a measurement and updates position and velocity.
+ *
+ * @param input The new measurement.
+ */
+template<typename T, typename U>
+void KalmanVelocityFilter<T, U>::add(T input) {
+  if (!this->enabled)
+    return;
+
+  this->input = input;
+  if (!this->primed) {
+    this->position = Arithmetic::fromValue(U(input));
+    this->velocity = 0;
+    this->covariance[0] = this->measurement_noise;
+    this->covariance[1] = 0;
+    this->covariance[2] = this->measurement_noise;
+    this->primed = true;
+    return;
+  }
+
+  if (!this->steady) {
+    float* p = this->covariance;
+    float q = this->acceleration_noise;
+    float p00 = p[0] + 2 * p[1] + p[2] + q / 4;
+    float p01 = p[1] + p[2] + q / 2;
+    float p11 = p[2] + q;
+    float innovation = p00 + this->measurement_noise;
+    float gains[2] = { p00 / innovation, p01 / innovation };
+
+    p[0] = (1 - gains[0]) * p00;
+    p[1] = (1 - gains[0]) * p01;
+    p[2] = p11 - gains[1] * p01;
+    bool settled = fabs(gains[0] - this->last_gains[0]) < 1e-5f && fabs(gains[1] - this->last_gains[1]) < 1e-5f;
+    this->last_gains[0] = gains[0];
+    this->last_gains[1] = gains[1];
+    this->position_gain = Arithmetic::toGain(gains[0]);
+    this->velocity_gain = Arithmetic::toGain(gains[1]);
+    if (settled)
+      this->useSteadyState();
+  }
+
+  this->position += this->velocity;
+  typename Arithmetic::Scalar residual = Arithmetic::fromValue(U(input)) - this->position;
+  this->position += Arithmetic::scale(residual, this->position_gain);
+  this->velocity += Arithmetic::scale(residual, this->velocity_gain);
+}
+
+/**
+ * @brief Prints the raw data, the position and the velocity.
+ */
+template<typename T, typename U>
+void KalmanVelocityFilter<T, U>::print() {
+  while (!Serial) {
+  }
+
+  Serial.print("Raw-Data:");
+  Serial.print(this->input);
+  Serial.print("\tKF:");
+  Serial.print(this->read());
+  Serial.print("\tVelocity:");
+  Serial.print(this->readVelocity());
+  Serial.print("\n");
+}
+
+/**
+ * @brief Returns the position estimate.
+ *
+ * @return The filtered value, 0 if the object is disabled.
+ */
+template<typename T, typename U>
+U KalmanVelocityFilter<T, U>::read() const {
+  if (!this->enabled)
+    return 0;
+
+  return Arithmetic::toValue(this->position);
+}
+
+/**
+ * @brief Returns the velocity estimate.
+ *
+ * @return The change of the signal per data point, 0 if the object is disabled.
+ */
+template<typename T, typename U>
+U KalmanVelocityFilter<T, U>::readVelocity() const {
+  if (!this->enabled)
+    return 0;
+
+  return Arithmetic::toValue(this->velocity);
+}
+
+/**
+ * @brief Returns whether the gains are frozen at their steady state.
+ *
+ * @return True once updates cost the same as an alpha-beta filter.
+ */
+template<typename T, typename U>
+bool KalmanVelocityFilter<T, U>::converged() const {
+  return this->steady;
+}
+
+/**
+ * @brief Computes the steady-state gains of the constant velocity model.
+ *
+ * Uses the closed form of Kalata for the tracking index lambda = sqrt(Q / R):
+ * r = (4 + lambda - sqrt(8 lambda + lambda^2)) / 4, alpha = 1 - r^2,
+ * beta = 2 (2 - alpha) - 4 sqrt(1 - alpha).
+ *
+ * @param acceleration_noise The variance Q of the change of the velocity per data point.
+ * @param measurement_noise The variance R of the measurement noise.
+ * @param position_gain Receives alpha.
+ * @param velocity_gain Receives beta.
+ */
+template<typename T, typename U>
+void KalmanVelocityFilter<T, U>::steadyStateGains(float acceleration_noise, float measurement_noise, float& position_gain,
+                                                  float& velocity_gain) {
+  float lambda = sqrtf(acceleration_noise / measurement_noise);
+  float r = (4 + lambda - sqrtf(8 * lambda + lambda * lambda)) / 4;
+  position_gain = 1 - r * r;
+  velocity_gain = 2 * (2 - position_gain) - 4 * sqrtf(1 - position_gain);
+}
+
+#endif  // KALMANFILTER_H
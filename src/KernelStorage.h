@@ -0,0 +1,111 @@
+/**
+ * @file KernelStorage.h
+ *
+ * @brief Storage traits for reading filter coefficients from RAM or program memory.
+ *
+ * On AVR, constant arrays are copied into the scarce SRAM at boot unless they are declared
+ * `PROGMEM`, and `PROGMEM` data must then be read with the `pgm_read_*` functions. The filters
+ * read their coefficients through a storage trait, so the same convolution code runs on kernels
+ * in RAM (`RamStorage`) and in flash (`ProgmemStorage`). On architectures with a unified address
+ * space, `ProgmemStorage` reads plain memory.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef KERNELSTORAGE_H
+#define KERNELSTORAGE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#endif
+
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+
+/**
+ * @brief Reads coefficients from RAM.
+ */
+struct RamStorage {
+  template<typename C>
+  static C read(const C* address) {
+    return *address;
+  }
+};
+
+#if defined(__AVR__)
+/**
+ * @brief Reads raw values of a given size from program memory.
+ *
+ * @tparam SIZE The size of the value in bytes.
+ */
+template<uint8_t SIZE>
+struct ProgmemRead {
+  template<typename C>
+  static C read(const C* address) {
+    C value;
+    memcpy_P(&value, address, sizeof(C));
+    return value;
+  }
+};
+
+template<>
+struct ProgmemRead<1> {
+  template<typename C>
+  static C read(const C* address) {
+    uint8_t raw = pgm_read_byte(address);
+    C value;
+    memcpy(&value, &raw, sizeof(C));
+    return value;
+  }
+};
+
+template<>
+struct ProgmemRead<2> {
+  template<typename C>
+  static C read(const C* address) {
+    uint16_t raw = pgm_read_word(address);
+    C value;
+    memcpy(&value, &raw, sizeof(C));
+    return value;
+  }
+};
+
+template<>
+struct ProgmemRead<4> {
+  template<typename C>
+  static C read(const C* address) {
+    uint32_t raw = pgm_read_dword(address);
+    C value;
+    memcpy(&value, &raw, sizeof(C));
+    return value;
+  }
+};
+#endif
+
+/**
+ * @brief Reads coefficients from program memory.
+ *
+ * Uses `pgm_read_byte`, `pgm_read_word` or `pgm_read_dword` on AVR, depending on the size of
+ * the coefficient type, and falls back to `memcpy_P` for other sizes. Plain memory reads are
+ * used on all other architectures.
+ */
+struct ProgmemStorage {
+  template<typename C>
+  static C read(const C* address) {
+#if defined(__AVR__)
+    return ProgmemRead<sizeof(C)>::read(address);
+#else
+    return *address;
+#endif
+  }
+};
+
+#endif  // KERNELSTORAGE_H
@@ -0,0 +1,319 @@
+/**
+ * @file LatencyHistogram.h
+ *
+ * @brief Log-linear latency histogram for profiling filter methods.
+ *
+ * This header provides a `CycleCounter` that reads the cheapest high resolution tick source of the
+ * target, a fixed-size `LatencyHistogram` that records tick counts into HDR-style log-linear buckets,
+ * and a `LatencyProbe` that times a scope into a histogram. Recording is a handful of integer
+ * operations, never allocates and never locks, so the histograms can stay enabled in production.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <stdint.h>
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#if !defined(ARDUINO) && (defined(__linux__) || defined(__APPLE__))
+#include <time.h>
+#endif
+
+/**
+ * @brief Reads a free running tick counter.
+ *
+ * The tick source depends on the target:
+ * - Cortex-M3/M4/M7: the DWT cycle counter (CPU cycles).
+ * - x86 hosts: the time stamp counter (`rdtsc`).
+ * - Other Linux or macOS hosts: `clock_gettime(CLOCK_MONOTONIC)` (nanoseconds).
+ * - Everything else, including AVR and Cortex-M0+: `micros()` (microseconds).
+ *
+ * Only differences of two readings are meaningful, the counter wraps at 32 bits.
+ */
+class CycleCounter {
+public:
+  static void begin();
+  static uint32_t read();
+};
+
+/**
+ * @brief Enables the tick source, if the target requires it.
+ *
+ * On Cortex-M3/M4/M7 the DWT cycle counter is switched on. On all other targets this is a no-op.
+ */
+inline void CycleCounter::begin() {
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+  *(volatile uint32_t*)0xE000EDFC |= (1UL << 24);  // CoreDebug->DEMCR |= TRCENA
+  *(volatile uint32_t*)0xE0001004 = 0;             // DWT->CYCCNT = 0
+  *(volatile uint32_t*)0xE0001000 |= 1UL;          // DWT->CTRL |= CYCCNTENA
+#endif
+}
+
+/**
+ * @brief Reads the current tick count.
+ *
+ * @return The current value of the tick source, truncated to 32 bits.
+ */
+inline uint32_t CycleCounter::read() {
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+  return *(volatile uint32_t*)0xE0001004;
+#elif defined(__x86_64__) || defined(__i386__)
+  return (uint32_t)__builtin_ia32_rdtsc();
+#elif !defined(ARDUINO) && (defined(__linux__) || defined(__APPLE__))
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)now.tv_sec * 1000000000UL + (uint32_t)now.tv_nsec;
+#else
+  return micros();
+#endif
+}
+
+/**
+ * @brief Fixed-size histogram with log-linear buckets.
+ *
+ * Values below 2^SUB_BUCKET_BITS are counted exactly. Every power-of-two range above is split into
+ * 2^SUB_BUCKET_BITS linear sub-buckets, which bounds the relative error of a reported value to
+ * 2^-SUB_BUCKET_BITS. Values at or above 2^MAX_EXPONENT are counted in an overflow bucket, while the
+ * exact maximum is tracked separately.
+ *
+ * The histogram uses 2^SUB_BUCKET_BITS * (MAX_EXPONENT - SUB_BUCKET_BITS + 1) + 1 counters. The
+ * default of 177 counters suits host and ARM builds, AVR builds should pick smaller parameters, for
+ * example `LatencyHistogram<2, 16, uint16_t>` (61 counters, 122 bytes).
+ *
+ * @tparam SUB_BUCKET_BITS The number of linear sub-buckets per power of two, as a power of two.
+ * @tparam MAX_EXPONENT The power of two above which values share the overflow bucket.
+ * @tparam C The data type of the bucket counters.
+ */
+template<uint8_t SUB_BUCKET_BITS = 3, uint8_t MAX_EXPONENT = 24, typename C = uint32_t>
+class LatencyHistogram {
+public:
+  static const uint8_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static const uint16_t BUCKETS = SUB_BUCKETS * (MAX_EXPONENT - SUB_BUCKET_BITS + 1) + 1;
+
+  LatencyHistogram();
+
+  void reset();
+  void record(uint32_t value);
+  uint32_t count() const;
+  uint32_t min() const;
+  uint32_t max() const;
+  uint32_t valueAtPercentile(float percentile) const;
+  void print() const;
+
+private:
+  C counts[BUCKETS];
+  uint32_t total;
+  uint32_t minimum;
+  uint32_t maximum;
+
+  static uint16_t bucketIndex(uint32_t value);
+  static uint32_t bucketUpperBound(uint16_t index);
+};
+
+/**
+ * @brief Constructs an empty LatencyHistogram object.
+ */
+template<uint8_t SUB_BUCKET_BITS, uint8_t MAX_EXPONENT, typename C>
+LatencyHistogram<SUB_BUCKET_BITS, MAX_EXPONENT, C>::LatencyHistogram() {
+  this->reset();
+}
+
+/**
+ * @brief Clears all recorded values.
+ */
+template<uint8_t SUB_BUCKET_BITS, uint8_t MAX_EXPONENT, typename C>
+void LatencyHistogram<SUB_BUCKET_BITS, MAX_EXPONENT, C>::reset() {
+  for (uint16_t i = 0; i < BUCKETS; i++) {
+    this->counts[i] = 0;
+  }
+  this->total = 0;
+  this->minimum = UINT32_MAX;
+  this->maximum = 0;
+}
+
+/**
+ * @brief Records a single value.
+ *
+ * Bucket counters saturate instead of wrapping around.
+ *
+ * @param value The value to record, usually a tick difference.
+ */
+template<uint8_t SUB_BUCKET_BITS, uint8_t MAX_EXPONENT, typename C>
+void LatencyHistogram<SUB_BUCKET_BITS, MAX_EXPONENT, C>::record(uint32_t value) {
+  C& counter = this->counts[bucketIndex(value)];
+  if (counter != C(~C(0)))
+    counter++;
+  this->total++;
+  if (value < this->minimum)
+    this->minimum = value;
+  if (value > this->maximum)
+    this->maximum = value;
+}
+
+/**
+ * @brief Returns the number of recorded values.
+ *
+ * @return The number of recorded values.
+ */
+template<uint8_t SUB_BUCKET_BITS, uint8_t MAX_EXPONENT, typename C>
+uint32_t LatencyHistogram<SUB_BUCKET_BITS, MAX_EXPONENT, C>::count() const {
+  return this->total;
+}
+
+/**
+ * @brief Returns the smallest recorded value.
+ *
+ * @return The exact minimum, or 0 if nothing has been recorded.
+ */
+template<uint8_t SUB_BUCKET_BITS, uint8_t MAX_EXPONENT, typename C>
+uint32_t LatencyHistogram<SUB_BUCKET_BITS, MAX_EXPONENT, C>::min() const {
+  return this->total ? this->minimum : 0;
+}
+
+/**
+ * @brief Returns the largest recorded value.
+ *
+ * @return The exact maximum, or 0 if nothing has been recorded.
+ */
+template<uint8_t SUB_BUCKET_BITS, uint8_t MAX_EXPONENT, typename C>
+uint32_t LatencyHistogram<SUB_BUCKET_BITS, MAX_EXPONENT, C>::max() const {
+  return this->maximum;
+}
+
+/**
+ * @brief Returns the value below or at which the given percentage of recorded values lie.
+ *
+ * The result is the upper bound of the bucket containing the requested rank, clamped to the exact
+ * maximum, so percentiles are never under-reported.
+ *
+ * @param percentile The percentile in the interval [0; 100].
+ * @return The value at the given percentile, or 0 if nothing has been recorded.
+ */
+template<uint8_t SUB_BUCKET_BITS, uint8_t MAX_EXPONENT, typename C>
+uint32_t LatencyHistogram<SUB_BUCKET_BITS, MAX_EXPONENT, C>::valueAtPercentile(float percentile) const {
+  if (this->total == 0)
+    return 0;
+
+  uint32_t rank = (uint32_t)(percentile / 100.0f * this->total + 0.5f);
+  if (rank < 1)
+    rank = 1;
+
+  uint32_t seen = 0;
+  for (uint16_t i = 0; i < BUCKETS; i++) {
+    seen += this->counts[i];
+    if (seen >= rank) {
+      uint32_t bound = bucketUpperBound(i);
+      return bound < this->maximum ? bound : this->maximum;
+    }
+  }
+  return this->maximum;
+}
+
+/**
+ * @brief Prints a percentile summary through the serial monitor.
+ *
+ * Uses the same "Label:value" format as MovingAverage::print(), so the serial plotter can show it.
+ */
+template<uint8_t SUB_BUCKET_BITS, uint8_t MAX_EXPONENT, typename C>
+void LatencyHistogram<SUB_BUCKET_BITS, MAX_EXPONENT, C>::print() const {
+  Serial.print("n:");
+  Serial.print(this->total);
+  Serial.print("\tmin:");
+  Serial.print(this->min());
+  Serial.print("\tp50:");
+  Serial.print(this->valueAtPercentile(50.0f));
+  Serial.print("\tp90:");
+  Serial.print(this->valueAtPercentile(90.0f));
+  Serial.print("\tp99:");
+  Serial.print(this->valueAtPercentile(99.0f));
+  Serial.print("\tp99.9:");
+  Serial.print(this->valueAtPercentile(99.9f));
+  Serial.print("\tmax:");
+  Serial.print(this->maximum);
+  Serial.print("\n");
+}
+
+/**
+ * @brief Maps a value to its bucket.
+ *
+ * @param value The value to map.
+ * @return The index of the bucket counting the value.
+ */
+template<uint8_t SUB_BUCKET_BITS, uint8_t MAX_EXPONENT, typename C>
+uint16_t LatencyHistogram<SUB_BUCKET_BITS, MAX_EXPONENT, C>::bucketIndex(uint32_t value) {
+  if (value < SUB_BUCKETS)
+    return value;
+
+  uint8_t exponent = sizeof(unsigned long) * 8 - 1 - __builtin_clzl(value);
+  if (exponent >= MAX_EXPONENT)
+    return BUCKETS - 1;
+
+  uint8_t shift = exponent - SUB_BUCKET_BITS;
+  return SUB_BUCKETS * (shift + 1) + (value >> shift) - SUB_BUCKETS;
+}
+
+/**
+ * @brief Returns the largest value that maps to a bucket.
+ *
+ * @param index The index of the bucket.
+ * @return The upper bound of the bucket.
+ */
+template<uint8_t SUB_BUCKET_BITS, uint8_t MAX_EXPONENT, typename C>
+uint32_t LatencyHistogram<SUB_BUCKET_BITS, MAX_EXPONENT, C>::bucketUpperBound(uint16_t index) {
+  if (index < SUB_BUCKETS)
+    return index;
+  if (index == BUCKETS - 1)
+    return UINT32_MAX;
+
+  uint8_t shift = index / SUB_BUCKETS - 1;
+  uint32_t lower = (uint32_t)(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+  return lower + ((uint32_t)1 << shift) - 1;
+}
+
+/**
+ * @brief Times the enclosing scope into a histogram.
+ *
+ * The tick counter is read on construction and on destruction, the difference is recorded.
+ *
+ * @tparam H The histogram type.
+ */
+template<typename H>
+class LatencyProbe {
+public:
+  explicit LatencyProbe(H& histogram);
+  ~LatencyProbe();
+
+private:
+  H& histogram;
+  uint32_t start;
+};
+
+/**
+ * @brief Starts timing.
+ *
+ * @param histogram The histogram the elapsed ticks are recorded into.
+ */
+template<typename H>
+LatencyProbe<H>::LatencyProbe(H& histogram)
+  : histogram(histogram), start(CycleCounter::read()) {}
+
+/**
+ * @brief Stops timing and records the elapsed ticks.
+ */
+template<typename H>
+LatencyProbe<H>::~LatencyProbe() {
+  this->histogram.record(CycleCounter::read() - this->start);
+}
+
+#endif  // LATENCYHISTOGRAM_H
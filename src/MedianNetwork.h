@@ -0,0 +1,238 @@
+/**
+ * @file MedianNetwork.h
+ *
+ * @brief Branch-free median kernels for small windows based on sorting networks.
+ *
+ * This header provides `MedianNetwork`, which selects the median of 3, 5, 7 or 9 values with a fixed
+ * sequence of compare-exchange operations. Every compare-exchange is a min/max pair without data
+ * dependent branches, so a single median costs a constant number of instructions, and the batch
+ * kernels apply each compare-exchange to a block of lanes at once (channels or consecutive output
+ * positions), which compilers turn into SIMD min/max instructions where the target has them.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef MEDIANNETWORK_H
+#define MEDIANNETWORK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Compare-exchange sequences selecting the median of N values.
+ *
+ * `apply()` calls `exchange(i, j)` for every comparator in order, where the exchange must leave the
+ * minimum in i and the maximum in j. Afterwards the median is at index N / 2. The networks only
+ * select the median, the other values are not fully sorted.
+ *
+ * @tparam N The number of values, 3, 5, 7 or 9.
+ */
+template<uint8_t N>
+struct MedianSelection;
+
+template<>
+struct MedianSelection<3> {
+  template<typename E>
+  static void apply(E& exchange) {
+    exchange(0, 1);
+    exchange(1, 2);
+    exchange(0, 1);
+  }
+};
+
+template<>
+struct MedianSelection<5> {
+  template<typename E>
+  static void apply(E& exchange) {
+    exchange(0, 1);
+    exchange(3, 4);
+    exchange(0, 3);
+    exchange(1, 4);
+    exchange(1, 2);
+    exchange(2, 3);
+    exchange(1, 2);
+  }
+};
+
+template<>
+struct MedianSelection<7> {
+  template<typename E>
+  static void apply(E& exchange) {
+    exchange(0, 5);
+    exchange(0, 3);
+    exchange(1, 6);
+    exchange(2, 4);
+    exchange(0, 1);
+    exchange(3, 5);
+    exchange(2, 6);
+    exchange(2, 3);
+    exchange(3, 6);
+    exchange(4, 5);
+    exchange(1, 4);
+    exchange(1, 3);
+    exchange(3, 4);
+  }
+};
+
+template<>
+struct MedianSelection<9> {
+  template<typename E>
+  static void apply(E& exchange) {
+    exchange(1, 2);
+    exchange(4, 5);
+    exchange(7, 8);
+    exchange(0, 1);
+    exchange(3, 4);
+    exchange(6, 7);
+    exchange(1, 2);
+    exchange(4, 5);
+    exchange(7, 8);
+    exchange(0, 3);
+    exchange(5, 8);
+    exchange(4, 7);
+    exchange(3, 6);
+    exchange(1, 4);
+    exchange(2, 5);
+    exchange(4, 7);
+    exchange(4, 2);
+    exchange(6, 4);
+    exchange(4, 2);
+  }
+};
+
+/**
+ * @brief Compare-exchange of two values.
+ *
+ * @tparam V The data type of the values.
+ */
+template<typename V>
+struct ValueExchange {
+  V* values;
+
+  void operator()(uint8_t i, uint8_t j) {
+    V low = this->values[i] < this->values[j] ? this->values[i] : this->values[j];
+    V high = this->values[i] < this->values[j] ? this->values[j] : this->values[i];
+    this->values[i] = low;
+    this->values[j] = high;
+  }
+};
+
+/**
+ * @brief Compare-exchange of two rows of lanes, lane by lane.
+ *
+ * @tparam V The data type of the values.
+ * @tparam LANES The number of lanes per row.
+ */
+template<typename V, uint8_t LANES>
+struct LaneExchange {
+  V (*rows)[LANES];
+
+  void operator()(uint8_t i, uint8_t j) {
+    V* a = this->rows[i];
+    V* b = this->rows[j];
+    for (uint8_t lane = 0; lane < LANES; lane++) {
+      V low = a[lane] < b[lane] ? a[lane] : b[lane];
+      V high = a[lane] < b[lane] ? b[lane] : a[lane];
+      a[lane] = low;
+      b[lane] = high;
+    }
+  }
+};
+
+/**
+ * @brief Median kernels for a window of N values.
+ *
+ * The batch kernels process LANES values per compare-exchange. The default of 16 lanes fills the
+ * vector registers of SSE, AVX and NEON for 16-bit values, and stays cheap on AVR.
+ *
+ * @tparam N The window size, 3, 5, 7 or 9.
+ * @tparam LANES The number of lanes processed together by the batch kernels.
+ */
+template<uint8_t N, uint8_t LANES = 16>
+struct MedianNetwork {
+  static const uint8_t SIZE = N;
+
+  /**
+   * @brief Selects the median of N values in place.
+   *
+   * @param values The N values, reordered by the call.
+   * @return The median.
+   */
+  template<typename V>
+  static V median(V* values) {
+    ValueExchange<V> exchange = { values };
+    MedianSelection<N>::apply(exchange);
+    return values[N / 2];
+  }
+
+  /**
+   * @brief Computes the median of N samples for many channels.
+   *
+   * Vectorised across channels: each compare-exchange runs over a block of LANES channels.
+   *
+   * @param samples The samples, N rows of `stride` values, row k holding sample k of every channel.
+   * @param stride The distance between two rows, at least `channels`.
+   * @param output The medians, one per channel.
+   * @param channels The number of channels.
+   */
+  template<typename V>
+  static void medianChannels(const V* samples, size_t stride, V* output, size_t channels) {
+    V rows[N][LANES];
+    for (size_t first = 0; first < channels; first += LANES) {
+      uint8_t lanes = channels - first < LANES ? uint8_t(channels - first) : LANES;
+      for (uint8_t k = 0; k < N; k++) {
+        for (uint8_t lane = 0; lane < LANES; lane++) {
+          rows[k][lane] = samples[k * stride + first + (lane < lanes ? lane : 0)];
+        }
+      }
+      selectLanes(rows);
+      for (uint8_t lane = 0; lane < lanes; lane++) {
+        output[first + lane] = rows[N / 2][lane];
+      }
+    }
+  }
+
+  /**
+   * @brief Runs a moving median over a series.
+   *
+   * Vectorised across consecutive output positions: each compare-exchange runs over LANES windows.
+   * Writes `count - N + 1` medians, output[i] being the median of input[i] to input[i + N - 1].
+   *
+   * @param input The series.
+   * @param output The medians.
+   * @param count The number of values in the series, at least N.
+   */
+  template<typename V>
+  static void medianSeries(const V* input, V* output, size_t count) {
+    if (count < N)
+      return;
+
+    size_t positions = count - N + 1;
+    V rows[N][LANES];
+    for (size_t first = 0; first < positions; first += LANES) {
+      uint8_t lanes = positions - first < LANES ? uint8_t(positions - first) : LANES;
+      for (uint8_t k = 0; k < N; k++) {
+        for (uint8_t lane = 0; lane < LANES; lane++) {
+          rows[k][lane] = input[first + (lane < lanes ? lane : 0) + k];
+        }
+      }
+      selectLanes(rows);
+      for (uint8_t lane = 0; lane < lanes; lane++) {
+        output[first + lane] = rows[N / 2][lane];
+      }
+    }
+  }
+
+private:
+  template<typename V>
+  static void selectLanes(V (*rows)[LANES]) {
+    LaneExchange<V, LANES> exchange = { rows };
+    MedianSelection<N>::apply(exchange);
+  }
+};
+
+#endif  // MEDIANNETWORK_H
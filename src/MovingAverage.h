@@ -1,21 +1,35 @@
 /**
  * @file MovingAverage.h
  *
- * @brief Defines a template class for implementing various types of moving average filters.
+ * @brief Template class for computing various types of moving averages.
  *
- * This file contains the declaration of the MovingAverage template class, which provides functionality
- * for calculating different types of moving averages including Simple Moving Average (SMA), Cumulative
- * Average (CA), Weighted Moving Average (WMA), and Exponential Moving Average (EMA).
+ * This header provides a `MovingAverage` class template that enables the calculation of several
+ * types of moving averages, such as Simple Moving Average (SMA), Cumulative Average (CA),
+ * Weighted Moving Average (WMA), Exponential Moving Average (EMA), and Moving Median (MM), as well
+ * as the robust Trimmed Mean (TM) and Winsorized Mean (WM) and a Hampel filter (HF) replacing
+ * outliers by the moving median.
+ * The class supports adding new data points, printing averages, and detecting peaks.
+ * It is designed for use in Arduino projects.
  *
  * @author Maximilian Kautzsch
  * @copyright Copyright (c) 2024 Maximilian Kautzsch
  * Licensed under MIT License.
  */
 
+#pragma once
+
 #ifndef MOVINGAVERAGE_H
 #define MOVINGAVERAGE_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include "BlockedOrderStatistic.h"
+#include "FilterCore.h"
+#include "FilterTraits.h"
+#include "MedianNetwork.h"
+#include "Reciprocal.h"
+#include "SkipList.h"
+#include "SlidingDft.h"
 
 #if defined(ARDUINO) && ARDUINO >= 100
 #include "Arduino.h"
@@ -23,25 +37,105 @@
 #include "WProgram.h"
 #endif
 
+#if defined(MOVINGAVERAGE_PROFILE)
+#include "LatencyHistogram.h"
+
+#ifndef MOVINGAVERAGE_PROFILE_HISTOGRAM
+#if defined(__AVR__)
+#define MOVINGAVERAGE_PROFILE_HISTOGRAM LatencyHistogram<2, 16, uint16_t>
+#else
+#define MOVINGAVERAGE_PROFILE_HISTOGRAM LatencyHistogram<>
+#endif
+#endif
+
+#define MOVINGAVERAGE_PROBE(method) LatencyProbe<MOVINGAVERAGE_PROFILE_HISTOGRAM> probe(this->profile[method])
+#else
+#define MOVINGAVERAGE_PROBE(method)
+#endif
+
+/**
+ * @brief Enumeration for specifying the type of average calculation.
+ *
+ * This enumeration allows the selection of different averaging methods.
+ * It is used to determine which type of moving average should be calculated and printed.
+ */
 typedef enum
 {
-  SMA = 1 << 0,
-  CA = 1 << 1,
-  WMA = 1 << 2,
-  EMA = 1 << 3
+  SMA = 1 << 0,  // Simple Moving Average
+  CA = 1 << 1,   // Cumulative Average
+  WMA = 1 << 2,  // Weighted Moving Average
+  EMA = 1 << 3,  // Exponential Moving Average
+  MM = 1 << 4,   // Moving Median
+  HF = 1 << 5,   // Hampel Filter
+  TM = 1 << 6,   // Trimmed Mean
+  WM = 1 << 7    // Winsorized Mean
 } AverageType;
 
+#if defined(MOVINGAVERAGE_PROFILE)
 /**
- * @brief Template class for implementing various types of moving average filters.
+ * @brief Enumeration of the methods timed when MOVINGAVERAGE_PROFILE is defined.
  *
- * This template class provides functionality for calculating different types of moving averages
- * including Simple Moving Average (SMA), Cumulative Average (CA), Weighted Moving Average (WMA),
- * and Exponential Moving Average (EMA).
+ * Used to index the per-method latency histograms of a profiled MovingAverage object.
+ */
+typedef enum
+{
+  PROFILE_ADD,
+  PROFILE_SMA,
+  PROFILE_CA,
+  PROFILE_WMA,
+  PROFILE_EMA,
+  PROFILE_MM,
+  PROFILE_PEAK,
+  PROFILE_HAMPEL,
+  PROFILE_TM,
+  PROFILE_WM,
+  PROFILE_PERCENTILE,
+  PROFILE_BATCH,
+  PROFILE_SLOPE,
+  PROFILE_TREND,
+  PROFILE_METHODS
+} ProfiledMethod;
+#endif
+
+/**
+ * @brief Template class for calculating moving averages.
  *
- * @tparam T The type of input data.
- * @tparam U The type of average calculated.
+ * This class template provides methods to calculate and manage various types of moving averages.
+ * It supports adding new data points, calculating different averages, printing results, and
+ * detecting peaks in the data.
+ *
+ * The window is a ring buffer with running sums, so SMA, WMA and CA cost O(1) per data point.
+ * Hot per-sample state (sums, EMA, ring position, packed flags) comes first, ordered by alignment,
+ * and the pointer to the heap-allocated ring comes last, so the only padding is the tail alignment.
+ * `sizeof` per configuration on a 64-bit host, excluding the ring of `window_size * sizeof(U)` bytes
+ * and the order statistic index allocated by the robust reads or by readMovingMedian() on more than
+ * 9 data points. Targets with 16-bit or 32-bit pointers and weaker alignment need less, the
+ * Benchmark example prints the size on the board it runs on:
+ *
+ * | Configuration                      | x86-64 |
+ * |------------------------------------|--------|
+ * | `MovingAverage<int16_t, int16_t>`  |     80 |
+ * | `MovingAverage<int32_t, int32_t>`  |     88 |
+ * | `MovingAverage<float, float>`      |     88 |
+ *
+ * Window sizes and ring positions are `uint8_t` by default, the fast path for 8-bit targets that
+ * limits windows to 255 data points. With `uint16_t` or `uint32_t` as W, windows of up to 65535 or
+ * millions of data points are possible, and the window sums widen to the `Total` type of
+ * FilterTraits, so they cannot overflow. For 32-bit and 64-bit integral data, the weighted sum of a
+ * window of n data points must still fit 64 bits, i.e. |x| * n * (n + 1) / 2 < 2^63, and twice that
+ * for readSlope() and readTrend().
+ *
+ * The order statistic index is a `SkipList` by default. For windows of more than about a hundred
+ * data points, `BlockedOrderStatistic<U>` keeps the sorted window in contiguous blocks and answers
+ * the same queries with far fewer cache misses. For windows beyond 255 data points, give the index
+ * the sum type `WindowTraits<U, W>::Sum` as well, e.g. `BlockedOrderStatistic<U, 64, int64_t>`.
+ *
+ * @tparam T The data type for input values (default: int16_t).
+ * @tparam U The data type for average values (default: int16_t).
+ * @tparam W The data type for window sizes and ring positions (default: uint8_t).
+ * @tparam I The order statistic index (default: a SkipList of U).
  */
-template <typename T, typename U>
+template<typename T = int16_t, typename U = int16_t, typename W = uint8_t, typename I = SkipList<U, typename WindowTraits<U, W>::Sum>>
 class MovingAverage
 {
 public:
@@ -50,80 +144,381 @@ public:
 
   void begin();
   void end();
+  void reset();
+  void reconfigure(W window_size);
+  void prime(const T* samples, size_t n);
   void add(T input);
+  void addBatch(const T* samples, size_t n, size_t stride = 1);
+  void attach(SlidingDft<U>* spectrum);
   void print(uint8_t average_types);
   void print();
   bool detectedPeak(T threshold, uint8_t consecutive_matches);
-  U readAverage(uint8_t window_size);
+  U readAverage(W window_size);
   U readCumulativeAverage();
-  U readWeightedAverage(uint8_t window_size);
+  U readWeightedAverage(W window_size);
+  float readSlope(W window_size);
+  U readTrend(W window_size);
   U readExponentialAverage(float smoothing_factor);
+  U readMovingMedian(W window_size);
+  U readHampel(W window_size, float threshold);
+  U readTrimmedMean(W window_size, float trim_fraction);
+  U readWinsorizedMean(W window_size, float trim_fraction);
+  U readPercentile(W window_size, float percentile);
+#if defined(MOVINGAVERAGE_PROFILE)
+  void printProfile();
+  const MOVINGAVERAGE_PROFILE_HISTOGRAM& readProfile(ProfiledMethod method) const;
+#endif
+
+  MovingAverage(const MovingAverage&) = delete;
+  MovingAverage& operator=(const MovingAverage&) = delete;
 
 private:
-  bool enabled;
-  T input;
-  U simple_moving_average;
-  U cumulative_average;
-  U weighted_moving_average;
+  typedef typename WindowTraits<U, W>::Sum Sum;
+
+  // Hot per-sample state, ordered by alignment.
+  CumulativeMean<U> cumulative_mean;
+  Sum window_sum;
+  Sum weighted_sum;
+  uint32_t num_samples;
   U exponential_moving_average;
+  U moving_median;
+  U hampel_output;
+  U trimmed_mean;
+  U winsorized_mean;
+  T input;
+  W head;
+  W num_elements;
+  W capacity;
+  W allocated;  // Length of the ring buffer, at least the capacity
+  uint8_t peak_matches;
+  uint8_t calculated;  // Bitmask of AverageType
+  uint8_t enabled : 1;
+  uint8_t window_updated : 1;
+  WindowDivider<Sum> divider;  // Empty unless the sums are integral and fit 32 bits
+
+  // Cold storage.
+  U* window;
+  I* order_index;  // Sorted copy of the window, built by the first median or Hampel read
+  SlidingDft<U>* spectrum;  // Attached DFT bins following the ring, not owned
+#if defined(MOVINGAVERAGE_PROFILE)
+  MOVINGAVERAGE_PROFILE_HISTOGRAM profile[PROFILE_METHODS];
+#endif
+
+  void allocateWindow(size_t window_size);
+  void updateWindow(W window_size);
+  void resumWindow();
+  void retainNewest(W count);
+  Sum divideSum() const;
+  Sum divideWeightedSum() const;
+  I& orderIndex();
+  void rebuildIndex();
+  static void sortValues(U* values, W count);
+  static void siftDown(U* values, W root, W count);
+  U valueAtRank(int rank);
+  Sum medianAbsoluteDeviation(int median_index, Sum median);
+  W trimCount(float trim_fraction) const;
 };
 
 /**
  * @brief Constructs a new MovingAverage object.
+ *
+ * Initializes the MovingAverage object with default values for its attributes.
  */
-template <typename T, typename U>
-MovingAverage<T, U>::MovingAverage() {}
+template<typename T, typename U, typename W, typename I>
+MovingAverage<T, U, W, I>::MovingAverage()
+  : cumulative_mean(), window_sum(0), weighted_sum(0), num_samples(0), exponential_moving_average(0), moving_median(0),
+    hampel_output(0), trimmed_mean(0), winsorized_mean(0), input(0), head(0), num_elements(0), capacity(0), allocated(0), peak_matches(0), calculated(0), enabled(false), window_updated(false),
+    window(nullptr), order_index(nullptr), spectrum(nullptr) {}
 
 /**
- * @brief Destructs a constructed MovingAverage object.
+ * @brief Destructs a MovingAverage object.
+ *
+ * Releases the window buffer and the order statistic index.
  */
-template <typename T, typename U>
-MovingAverage<T, U>::~MovingAverage() {}
+template<typename T, typename U, typename W, typename I>
+MovingAverage<T, U, W, I>::~MovingAverage()
+{
+  delete[] this->window;
+  delete this->order_index;
+}
 
 /**
- * @brief Initializes the MovingAverage object.
+ * @brief Enables the MovingAverage object.
  *
- * Toggles the 'enabled' class attribute to true.
+ * Sets the enabled flag to true, allowing the object to start processing data.
  */
-template <typename T, typename U>
-void MovingAverage<T, U>::begin()
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::begin()
 {
   this->enabled = true;
+#if defined(MOVINGAVERAGE_PROFILE)
+  CycleCounter::begin();
+#endif
 }
 
 /**
- * @brief Stops the MovingAverage object.
+ * @brief Disables the MovingAverage object.
  *
- * Toggles the 'enabled' class attribute to false.
+ * Sets the enabled flag to false. The reads return 0 until begin() is called again, while add(),
+ * addBatch() and prime() keep recording data points.
  */
-template <typename T, typename U>
-void MovingAverage<T, U>::end()
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::end()
 {
   this->enabled = false;
 }
 
 /**
- * @brief Adds a new data point to the filter.
+ * @brief Clears all data points and averages.
  *
- * @param input The new data point that is being added to the filter.
+ * Returns the object to the state after construction, except that the ring buffer and the order
+ * statistic index stay allocated for the next data points. The window size is kept. Costs O(1)
+ * plus clearing the order statistic index, if any.
  */
-template <typename T, typename U>
-void MovingAverage<T, U>::add(T input)
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::reset()
 {
+  this->cumulative_mean = CumulativeMean<U>();
+  this->window_sum = 0;
+  this->weighted_sum = 0;
+  this->num_samples = 0;
+  this->exponential_moving_average = 0;
+  this->moving_median = 0;
+  this->hampel_output = 0;
+  this->trimmed_mean = 0;
+  this->winsorized_mean = 0;
+  this->input = 0;
+  this->head = 0;
+  this->num_elements = 0;
+  this->peak_matches = 0;
+  this->calculated = 0;
+  this->window_updated = false;
+  if (this->order_index != nullptr)
+    this->order_index->clear();
+  if (this->spectrum != nullptr)
+    this->spectrum->reset();
+}
+
+/**
+ * @brief Changes the window size, keeping the newest data points.
+ *
+ * The newest data points that fit into the new window are kept and the running sums are recomputed
+ * from them, so the windowed averages continue without refilling the window. The ring buffer is
+ * reused if it is long enough, otherwise it is replaced once, together with the order statistic
+ * index if one exists. If no ring exists yet, it is allocated here, so data points added later,
+ * e.g. by addBatch() in an interrupt, never allocate it. Costs O(window).
+ *
+ * @param window_size The new size of the window.
+ */
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::reconfigure(W window_size)
+{
+  W capacity = window_size ? window_size : 1;
+  W count = this->num_elements < capacity ? this->num_elements : capacity;
+
+  if (this->window == nullptr)
+  {
+    this->capacity = capacity;
+    this->allocateWindow(capacity);
+    return;
+  }
+
+  this->retainNewest(count);
+  if (capacity > this->allocated)
+  {
+    U* window = new U[capacity];
+    for (W i = 0; i < count; i++)
+    {
+      window[i] = this->window[i];
+    }
+    delete[] this->window;
+    this->window = window;
+    this->allocated = capacity;
+    if (this->order_index != nullptr)
+    {
+      delete this->order_index;
+      this->order_index = I::forWindow(capacity);
+    }
+  }
+
+  this->capacity = capacity;
+  this->num_elements = count;
+  this->head = count == capacity ? 0 : count;
+  if (count == capacity)
+    this->divider.configure(capacity);
+  this->resumWindow();
+
+  if (this->order_index != nullptr)
+    this->rebuildIndex();
+}
+
+/**
+ * @brief Loads a burst of data points at once, e.g. an ADC buffer on boot.
+ *
+ * Clears the object like reset() and then gives the same averages as adding the data points one by
+ * one, except that the EMA starts at the mean of the data points instead of at 0. The newest data
+ * points that fit are copied into the ring and the running sums are computed in a single pass, and
+ * an existing order statistic index is rebuilt from the sorted window in O(n log n) instead of n
+ * insertions. If no window size is set yet, by reconfigure() or a windowed read, the window holds
+ * all n data points. Like add(), it records the data points even if the object is disabled.
+ *
+ * @param samples The data points, oldest first.
+ * @param n The number of data points.
+ */
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::prime(const T* samples, size_t n)
+{
+  this->reset();
+  if (n == 0)
+    return;
+
+  this->allocateWindow(n);
+  W count = n < size_t(this->capacity) ? W(n) : this->capacity;
+  size_t first = n - count;
+  for (size_t i = 0; i < n; i++)
+  {
+    this->cumulative_mean.add(U(samples[i]), ++this->num_samples);
+    if (i >= first)
+      this->window[i - first] = U(samples[i]);
+  }
+
+  this->input = samples[n - 1];
+  this->num_elements = count;
+  this->head = count == this->capacity ? 0 : count;
+  if (count == this->capacity)
+    this->divider.configure(this->capacity);
+  this->resumWindow();
+  this->exponential_moving_average = this->cumulative_mean.read(this->num_samples);
+  this->window_updated = true;
+
+  if (this->order_index != nullptr)
+    this->rebuildIndex();
+}
+
+/**
+ * @brief Adds a new data point to the moving average calculation.
+ *
+ * Adds the given input value to the cumulative mean and marks the window as outdated. The window
+ * itself is updated by the next windowed read. The data point is recorded even if the object is
+ * disabled, only the reads depend on begin().
+ *
+ * @param input The new data point to be added.
+ */
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::add(T input)
+{
+  MOVINGAVERAGE_PROBE(PROFILE_ADD);
+
   this->input = input;
+  this->num_samples++;
+  this->cumulative_mean.add(U(input), this->num_samples);
+  this->window_updated = false;
 }
 
 /**
- * @brief Prints the selected average filter outputs.
+ * @brief Adds a block of data points, e.g. half of a DMA buffer.
  *
- * Firstly, the raw data points are printed serially.
- * Then, the corresponding average values are printed through the serial monitor
- * based on the selected average types.
+ * Gives the same windowed averages, medians and cumulative average as calling add() and a
+ * windowed read for every data point, reading the data points in place. Once the window is full
+ * and no order statistic index exists, the running sums stay in registers for the whole block, so
+ * the cost is a few cycles per data point and bounded by the block length. The EMA and the peak
+ * detection are advanced by their reads, not per data point. Like add(), it records the data points
+ * even if the object is disabled. If no window size is set yet, by reconfigure() or a windowed
+ * read, the window holds n data points and is allocated by this call, so call reconfigure() first
+ * when feeding it from an interrupt.
  *
- * @param average_types Bitmask representing the average types to print.
+ * @param samples The first data point, oldest first.
+ * @param n The number of data points.
+ * @param stride The distance between two data points, e.g. the number of interleaved channels.
  */
-template <typename T, typename U>
-void MovingAverage<T, U>::print(uint8_t average_types)
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::addBatch(const T* samples, size_t n, size_t stride)
+{
+  MOVINGAVERAGE_PROBE(PROFILE_BATCH);
+
+  if (n == 0)
+    return;
+
+  this->allocateWindow(n);
+  size_t i = 0;
+  for (; i < n && (this->num_elements < this->capacity || this->order_index != nullptr); i++)
+  {
+    this->input = samples[i * stride];
+    this->cumulative_mean.add(U(this->input), ++this->num_samples);
+    this->updateWindow(this->capacity);
+  }
+
+  // Full window without index: only the running sums and the ring change
+  U* window = this->window;
+  W capacity = this->capacity;
+  W head = this->head;
+  Sum window_sum = this->window_sum;
+  Sum weighted_sum = this->weighted_sum;
+  SlidingDft<U>* spectrum = this->spectrum;
+  for (; i < n; i++)
+  {
+    U value = U(samples[i * stride]);
+    this->cumulative_mean.add(value, ++this->num_samples);
+    weighted_sum = FilterCore::wmaStep(weighted_sum, window_sum, Sum(value), capacity, true);
+    window_sum = FilterCore::smaStep(window_sum, Sum(value), Sum(window[head]));
+    W next = FilterCore::ringNext(head, capacity);
+    if (spectrum != nullptr)
+      spectrum->update(value, window[head], capacity, next == 0);
+    window[head] = value;
+    head = next;
+
+    if (!FilterTraits<U>::INTEGRAL && head == 0)
+    {
+      this->head = head;
+      this->resumWindow();
+      window_sum = this->window_sum;
+      weighted_sum = this->weighted_sum;
+    }
+  }
+  this->head = head;
+  this->window_sum = window_sum;
+  this->weighted_sum = weighted_sum;
+  this->input = samples[(n - 1) * stride];
+  this->window_updated = true;
+}
+
+/**
+ * @brief Attaches sliding DFT bins that follow the ring.
+ *
+ * From now on every data point entering the ring also updates the bins, in O(1) per bin, so they
+ * describe the same window as readAverage(). If the ring already holds data points, the bins are
+ * computed from them once. The filter does not own the bins, pass nullptr to detach them.
+ *
+ * @param spectrum The bins to update, or nullptr.
+ */
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::attach(SlidingDft<U>* spectrum)
+{
+  this->spectrum = spectrum;
+  if (spectrum == nullptr)
+    return;
+
+  if (this->window != nullptr)
+  {
+    spectrum->resum(this->window, this->num_elements, this->head, this->capacity);
+  }
+  else
+  {
+    spectrum->reset();
+  }
+}
+
+/**
+ * @brief Prints the specified types of averages.
+ *
+ * Outputs the raw data and the calculated averages of the specified types to the serial monitor.
+ * SMA, WMA and CA are derived from the running sums, only averages that have been read before
+ * are printed.
+ *
+ * @param average_types Bitmask representing the types of averages to print.
+ */
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::print(uint8_t average_types)
 {
   while (!Serial)
   {
@@ -132,228 +527,827 @@ void MovingAverage<T, U>::print(uint8_t average_types)
   Serial.print("Raw-Data:");
   Serial.print(this->input);
 
+  average_types &= this->calculated;
+
   if (average_types & SMA)
   {
     Serial.print("\tSMA:");
-    Serial.print(this->simple_moving_average);
+    Serial.print(U(this->divideSum()));
   }
   if (average_types & CA)
   {
     Serial.print("\tCA:");
-    Serial.print(this->cumulative_average);
+    Serial.print(this->cumulative_mean.read(this->num_samples));
   }
   if (average_types & WMA)
   {
     Serial.print("\tWMA:");
-    Serial.print(this->weighted_moving_average);
+    Serial.print(U(this->divideWeightedSum()));
   }
   if (average_types & EMA)
   {
     Serial.print("\tEMA:");
     Serial.print(this->exponential_moving_average);
   }
+  if (average_types & MM)
+  {
+    Serial.print("\tMM:");
+    Serial.print(this->moving_median);
+  }
+  if (average_types & HF)
+  {
+    Serial.print("\tHF:");
+    Serial.print(this->hampel_output);
+  }
+  if (average_types & TM)
+  {
+    Serial.print("\tTM:");
+    Serial.print(this->trimmed_mean);
+  }
+  if (average_types & WM)
+  {
+    Serial.print("\tWM:");
+    Serial.print(this->winsorized_mean);
+  }
 
   Serial.print("\n");
 }
 
 /**
- * @brief Prints all average filter outputs.
+ * @brief Prints all available averages.
  *
- * The raw data points as well as all of the calculated average filter outputs
- * are printed through the serial monitor.
+ * Outputs the raw data and all calculated averages to the serial monitor.
  */
-template <typename T, typename U>
-void MovingAverage<T, U>::print()
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::print()
 {
-  this->print(SMA | CA | WMA | EMA);
+  this->print(SMA | CA | WMA | EMA | MM | HF | TM | WM);
 }
 
 /**
- * @brief Filters out peaks from the data points.
+ * @brief Detects peaks in the data points.
  *
- * If the given input is greater or equal to a certain threshold value for a specified
- * amount in a row, then a data peak is retrieved.
+ * Checks if the input value is above the specified threshold for a certain number of consecutive times.
  *
- * @param threshold The value the input data is compared to.
- * @param consecutive_matches The amount the data point must be greater or equal to the threshold
- * in a row, in order to filter out a peak.
- * @return True if a data peak has been detected, false otherwise.
+ * @param threshold The threshold value to detect peaks.
+ * @param consecutive_matches The number of consecutive times the input must exceed the threshold to detect a peak.
+ * @return True if a peak is detected, false otherwise.
  */
-template <typename T, typename U>
-bool MovingAverage<T, U>::detectedPeak(T threshold, uint8_t consecutive_matches)
+template<typename T, typename U, typename W, typename I>
+bool MovingAverage<T, U, W, I>::detectedPeak(T threshold, uint8_t consecutive_matches)
 {
-  if (!this->enabled)
-    return 0;
+  MOVINGAVERAGE_PROBE(PROFILE_PEAK);
 
-  static uint8_t matches;
+  if (!this->enabled)
+    return false;
 
   if (this->input >= threshold)
   {
-    matches++;
+    this->peak_matches++;
 
-    if (matches >= consecutive_matches)
+    if (this->peak_matches >= consecutive_matches)
     {
-      matches = 0;
+      this->peak_matches = 0;
       return true;
     }
   }
   else
   {
-    matches = 0;
-    return false;
+    this->peak_matches = 0;
   }
+
+  return false;
+}
+
+/**
+ * @brief Calculates the Simple Moving Average (SMA).
+ *
+ * Computes the SMA for the given window size. If the object is disabled, returns 0.
+ *
+ * @param window_size The size of the window for the SMA calculation.
+ * @return The computed Simple Moving Average.
+ */
+template<typename T, typename U, typename W, typename I>
+U MovingAverage<T, U, W, I>::readAverage(W window_size)
+{
+  MOVINGAVERAGE_PROBE(PROFILE_SMA);
+
+  if (!this->enabled)
+    return 0;
+
+  if (!this->window_updated)
+  {
+    updateWindow(window_size);
+  }
+
+  this->calculated |= SMA;
+
+  return this->divideSum();
+}
+
+/**
+ * @brief Calculates the Cumulative Average (CA).
+ *
+ * Computes the CA using all data points up to the current point. If the object is disabled or has
+ * no data points, e.g. after reset(), returns 0.
+ *
+ * @return The computed Cumulative Average.
+ */
+template<typename T, typename U, typename W, typename I>
+U MovingAverage<T, U, W, I>::readCumulativeAverage()
+{
+  MOVINGAVERAGE_PROBE(PROFILE_CA);
+
+  if (!this->enabled || this->num_samples == 0)
+    return 0;
+
+  this->calculated |= CA;
+
+  return this->cumulative_mean.read(this->num_samples);
 }
 
 /**
- * @brief Calculates the Simple Moving Average (SMA) for a given input.
+ * @brief Calculates the Weighted Moving Average (WMA).
  *
- * Calculates the SMA based on the provided input and window size.
- * If the MovingAverage object is disabled, returns 0.
+ * Computes the WMA for the given window size, giving more weight to recent values. If the object is disabled, returns 0.
  *
- * @param window_size The size of the data window (amount of data points used for
- * one calculation).
- * @return The calculated Simple Moving Average (SMA).
+ * @param window_size The size of the window for the WMA calculation.
+ * @return The computed Weighted Moving Average.
  */
-template <typename T, typename U>
-U MovingAverage<T, U>::readAverage(uint8_t window_size)
+template<typename T, typename U, typename W, typename I>
+U MovingAverage<T, U, W, I>::readWeightedAverage(W window_size)
 {
+  MOVINGAVERAGE_PROBE(PROFILE_WMA);
+
   if (!this->enabled)
     return 0;
 
-  static uint8_t num_elements;
-  static U *window = new U[window_size];
-  static U sum;
+  if (!this->window_updated)
+  {
+    updateWindow(window_size);
+  }
+
+  this->calculated |= WMA;
+
+  return this->divideWeightedSum();
+}
+
+/**
+ * @brief Calculates the least-squares slope of the window.
+ *
+ * Fits a line through the window by least squares, with the data points at consecutive positions,
+ * and returns its slope, e.g. to detect drift. The slope follows from the running sums of the SMA
+ * and WMA, so it costs O(1) per data point and shares their ring. If the object is disabled or the
+ * window holds fewer than 2 data points, returns 0.
+ *
+ * @param window_size The size of the window for the regression.
+ * @return The change per data point.
+ */
+template<typename T, typename U, typename W, typename I>
+float MovingAverage<T, U, W, I>::readSlope(W window_size)
+{
+  MOVINGAVERAGE_PROBE(PROFILE_SLOPE);
+
+  if (!this->enabled)
+    return 0;
 
-  if (num_elements < window_size)
+  if (!this->window_updated)
   {
-    window[num_elements] = this->input;
-    sum += this->input;
-    num_elements++;
+    updateWindow(window_size);
   }
-  else
+
+  if (this->num_elements < 2)
+    return 0;
+
+  typedef typename SignedSum<Sum>::Type Difference;
+  Difference numerator = FilterCore::slopeNumerator(Difference(this->weighted_sum), Difference(this->window_sum), this->num_elements);
+  float length = float(this->num_elements);
+  return 6.0f * float(numerator) / (length * (length * length - 1.0f));
+}
+
+/**
+ * @brief Calculates the least-squares trend at the newest data point.
+ *
+ * Evaluates the line of readSlope() at the newest data point, which equals 3 * WMA - 2 * SMA and
+ * follows a ramp without the lag of the SMA. Costs O(1) like the SMA. As an extrapolation it can
+ * leave the range of the data points: for integral types the result is truncated toward zero and
+ * saturates at the range of U. If the object is disabled, returns 0.
+ *
+ * @param window_size The size of the window for the regression.
+ * @return The trend value.
+ */
+template<typename T, typename U, typename W, typename I>
+U MovingAverage<T, U, W, I>::readTrend(W window_size)
+{
+  MOVINGAVERAGE_PROBE(PROFILE_TREND);
+
+  if (!this->enabled)
+    return 0;
+
+  if (!this->window_updated)
   {
-    for (uint8_t i = 0; i < window_size - 1; i++)
+    updateWindow(window_size);
+  }
+
+  typedef typename SignedSum<Sum>::Type Difference;
+  Difference numerator = FilterCore::trendNumerator(Difference(this->weighted_sum), Difference(this->window_sum), this->num_elements);
+  Difference trend = numerator / FilterCore::wmaWeightTotal(Difference(this->num_elements));
+  if (!FilterTraits<U>::INTEGRAL)
+    return U(trend);
+  return FilterCore::saturate<U>(trend);
+}
+
+/**
+ * @brief Calculates the Exponential Moving Average (EMA).
+ *
+ * Computes the EMA using the given smoothing factor. If the object is disabled, returns 0.
+ *
+ * @param smoothing_factor The smoothing factor for the EMA calculation.
+ * @return The computed Exponential Moving Average.
+ */
+template<typename T, typename U, typename W, typename I>
+U MovingAverage<T, U, W, I>::readExponentialAverage(float smoothing_factor)
+{
+  MOVINGAVERAGE_PROBE(PROFILE_EMA);
+
+  if (!this->enabled)
+    return 0;
+
+  this->exponential_moving_average = FilterCore::emaStep(this->exponential_moving_average, this->input, smoothing_factor);
+  this->calculated |= EMA;
+
+  return this->exponential_moving_average;
+}
+
+/**
+ * @brief Calculates the Moving Median (MM).
+ *
+ * Computes the MM for the given window size. If the object is disabled, returns 0.
+ * Windows of 3, 5, 7 and 9 data points use a branch-free sorting network from MedianNetwork.h,
+ * larger windows are looked up in the order statistic index in O(log n).
+ *
+ * @param window_size The size of the window for the MM calculation.
+ * @return The computed Moving Median.
+ */
+template<typename T, typename U, typename W, typename I>
+U MovingAverage<T, U, W, I>::readMovingMedian(W window_size)
+{
+  MOVINGAVERAGE_PROBE(PROFILE_MM);
+
+  if (!this->enabled)
+    return 0;
+
+  if (!this->window_updated)
+  {
+    updateWindow(window_size);
+  }
+
+  // Up to 9 data points are sorted on the stack, odd lengths by a sorting network.
+  U values[9];
+  if (this->num_elements <= 9)
+  {
+    for (uint8_t i = 0; i < this->num_elements; i++)
     {
-      sum -= window[i];
-      window[i] = window[i + 1];
-      sum += window[i];
+      values[i] = this->window[i];
     }
-    sum -= window[window_size - 1];
-    window[window_size - 1] = this->input;
-    sum += window[window_size - 1];
   }
 
-  this->simple_moving_average = sum / num_elements;
+  switch (this->num_elements)
+  {
+    case 3:
+      this->moving_median = MedianNetwork<3>::median(values);
+      break;
+    case 5:
+      this->moving_median = MedianNetwork<5>::median(values);
+      break;
+    case 7:
+      this->moving_median = MedianNetwork<7>::median(values);
+      break;
+    case 9:
+      this->moving_median = MedianNetwork<9>::median(values);
+      break;
+    default:
+      if (this->num_elements > 9)
+      {
+        this->moving_median = this->orderIndex().getMedian();
+        break;
+      }
+      // Even lengths while a small window fills
+      for (uint8_t i = 1; i < this->num_elements; i++)
+      {
+        for (uint8_t j = i; j > 0 && values[j - 1] > values[j]; j--)
+        {
+          U swap = values[j];
+          values[j] = values[j - 1];
+          values[j - 1] = swap;
+        }
+      }
+      this->moving_median = values[this->num_elements / 2];
+  }
+  this->calculated |= MM;
 
-  return this->simple_moving_average;
+  return this->moving_median;
 }
 
 /**
- * @brief Calculates the Cumulative Average (CA) for a given input.
+ * @brief Applies a Hampel filter to the current input.
+ *
+ * Computes the median and the median absolute deviation (MAD) of the window from the order
+ * statistic index. If the current input deviates from the median by more than threshold times the
+ * scaled MAD (1.4826 * MAD, an estimate of the standard deviation for normally distributed data),
+ * it is an outlier and replaced by the median, otherwise it passes unchanged. A threshold of 3 is
+ * common. If the object is disabled, returns 0.
  *
- * Calculates the CA based on the provided input.
- * Uses all of the data points up to the current datum.
- * If the MovingAverage object is disabled, returns 0.
+ * The window is updated in O(log n). The median costs O(log n) and the MAD O(log^2 n), as it
+ * selects from the deviations below and above the median without sorting them.
  *
- * @return The calculated Cumulative Average (CA).
+ * @param window_size The size of the window for the median and the MAD.
+ * @param threshold The number of scaled MADs beyond which an input is an outlier.
+ * @return The input, or the median if the input is an outlier.
  */
-template <typename T, typename U>
-U MovingAverage<T, U>::readCumulativeAverage()
+template<typename T, typename U, typename W, typename I>
+U MovingAverage<T, U, W, I>::readHampel(W window_size, float threshold)
 {
+  MOVINGAVERAGE_PROBE(PROFILE_HAMPEL);
+
   if (!this->enabled)
     return 0;
 
-  static uint16_t num_elements;
-  static float average;
+  if (!this->window_updated)
+  {
+    updateWindow(window_size);
+  }
+
+  int median_index = this->num_elements / 2;
+  U median = this->valueAtRank(median_index);
+  Sum mad = this->medianAbsoluteDeviation(median_index, Sum(median));
+  Sum deviation = Sum(this->input) - Sum(median);
+  if (deviation < 0)
+    deviation = -deviation;
 
-  if (num_elements <= 2)
+  this->hampel_output = float(deviation) > threshold * 1.4826f * float(mad) ? median : U(this->input);
+  this->calculated |= HF;
+
+  return this->hampel_output;
+}
+
+/**
+ * @brief Calculates the Trimmed Mean (TM).
+ *
+ * Discards the trim_fraction smallest and largest data points of the window and averages the rest,
+ * which lies between the SMA (no trimming) and the MM (trimming almost half). The sum of the middle
+ * ranks is read from the order statistic index in O(log n). If the object is disabled, returns 0.
+ *
+ * @param window_size The size of the window for the TM calculation.
+ * @param trim_fraction The fraction of data points discarded at each end, in the interval [0; 0.5).
+ * @return The computed Trimmed Mean.
+ */
+template<typename T, typename U, typename W, typename I>
+U MovingAverage<T, U, W, I>::readTrimmedMean(W window_size, float trim_fraction)
+{
+  MOVINGAVERAGE_PROBE(PROFILE_TM);
+
+  if (!this->enabled)
+    return 0;
+
+  if (!this->window_updated)
   {
-    average += this->input;
-    num_elements++;
-    average /= num_elements;
+    updateWindow(window_size);
   }
-  else
+
+  I& index = this->orderIndex();
+  W trim = this->trimCount(trim_fraction);
+  Sum middle = index.sumSmallest(this->num_elements - trim) - index.sumSmallest(trim);
+
+  this->trimmed_mean = middle / Sum(this->num_elements - 2 * trim);
+  this->calculated |= TM;
+
+  return this->trimmed_mean;
+}
+
+/**
+ * @brief Calculates the Winsorized Mean (WM).
+ *
+ * Clamps the trim_fraction smallest and largest data points of the window to the nearest remaining
+ * data point and averages the whole window. Costs O(log n) like readTrimmedMean(). If the object is
+ * disabled, returns 0.
+ *
+ * @param window_size The size of the window for the WM calculation.
+ * @param trim_fraction The fraction of data points clamped at each end, in the interval [0; 0.5).
+ * @return The computed Winsorized Mean.
+ */
+template<typename T, typename U, typename W, typename I>
+U MovingAverage<T, U, W, I>::readWinsorizedMean(W window_size, float trim_fraction)
+{
+  MOVINGAVERAGE_PROBE(PROFILE_WM);
+
+  if (!this->enabled)
+    return 0;
+
+  if (!this->window_updated)
   {
-    num_elements++;
-    average = (this->input + average * (num_elements - 1)) / num_elements;
+    updateWindow(window_size);
   }
 
-  this->cumulative_average = U(average);
-  return this->cumulative_average;
+  I& index = this->orderIndex();
+  W trim = this->trimCount(trim_fraction);
+  Sum middle = index.sumSmallest(this->num_elements - trim) - index.sumSmallest(trim);
+  Sum clamped = Sum(trim) * (Sum(this->valueAtRank(trim)) + Sum(this->valueAtRank(this->num_elements - 1 - trim)));
+
+  this->winsorized_mean = (middle + clamped) / Sum(this->num_elements);
+  this->calculated |= WM;
+
+  return this->winsorized_mean;
 }
 
 /**
- * @brief Calculates the Weighted Moving Average (WMA) for a given input.
+ * @brief Reads a percentile of the window.
  *
- * Calculates the WMA based on the provided input and window size.
- * Gives more weight_coefficient to recent values and lesser weight_coefficient to older values.
- * If the MovingAverage object is disabled, returns 0.
+ * Uses the nearest-rank definition: the result is the smallest data point such that at least
+ * percentile % of the window is less than or equal to it, so the 50th percentile of an odd window
+ * is its median and the 100th its maximum. Costs one rank lookup in the order statistic index. If
+ * the object is disabled, returns 0.
  *
- * @param window_size The size of the data window (amount of data points used for
- * one calculation).
- * @return The calculated Weighted Moving Average (WMA).
+ * @param window_size The size of the window for the percentile.
+ * @param percentile The percentile, in the interval [0; 100].
+ * @return The data point at the percentile.
  */
-template <typename T, typename U>
-U MovingAverage<T, U>::readWeightedAverage(uint8_t window_size)
+template<typename T, typename U, typename W, typename I>
+U MovingAverage<T, U, W, I>::readPercentile(W window_size, float percentile)
 {
+  MOVINGAVERAGE_PROBE(PROFILE_PERCENTILE);
+
   if (!this->enabled)
     return 0;
 
-  static uint8_t num_elements;
-  static U *window = new U[window_size];
-  static U sum;
-  uint8_t weight_coefficient;
+  if (!this->window_updated)
+  {
+    updateWindow(window_size);
+  }
+
+  float position = percentile * 0.01f * this->num_elements;
+  int rank = int(position);
+  if (float(rank) < position)
+    rank++;
+  rank = rank < 1 ? 0 : rank > int(this->num_elements) ? int(this->num_elements) - 1 : rank - 1;
+
+  return this->valueAtRank(rank);
+}
+
+/**
+ * @brief Allocates the ring on first use.
+ *
+ * @param window_size The window size to use if none is set yet, clamped to the range of W.
+ */
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::allocateWindow(size_t window_size)
+{
+  if (this->window != nullptr)
+    return;
 
-  if (num_elements < window_size)
+  if (this->capacity == 0)
   {
-    weight_coefficient = num_elements + 1;
-    window[num_elements] = this->input;
-    sum += this->input * weight_coefficient;
-    num_elements++;
+    W limit = W(~W(0));
+    this->capacity = window_size == 0 ? W(1) : window_size < size_t(limit) ? W(window_size) : limit;
   }
-  else
+  this->window = new U[this->capacity];
+  this->allocated = this->capacity;
+}
+
+/**
+ * @brief Updates the window with the current input.
+ *
+ * Allocates the ring on the first call, then pushes the current input, evicting the oldest data
+ * point once the ring is full. The running sums are updated in O(1): when full, every weight of
+ * the WMA drops by one, which subtracts the previous window sum from the weighted sum. When the
+ * ring becomes full, the reciprocals of the SMA and WMA normalisers are computed once. Once the
+ * order statistic index exists, it follows the ring in O(log n).
+ *
+ * @param window_size The size of the window, fixed by the first call unless set by reconfigure().
+ */
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::updateWindow(W window_size)
+{
+  this->allocateWindow(window_size);
+
+  U value = this->input;
+  bool full = this->num_elements == this->capacity;
+  Sum outgoing = full ? Sum(this->window[this->head]) : Sum(0);
+  if (!full && ++this->num_elements == this->capacity)
+  {
+    this->divider.configure(this->capacity);
+  }
+
+  if (this->order_index != nullptr)
+  {
+    if (full)
+      this->order_index->remove(this->window[this->head]);
+    this->order_index->insert(value);
+  }
+
+  this->weighted_sum = FilterCore::wmaStep(this->weighted_sum, this->window_sum, Sum(value), this->num_elements, full);
+  this->window_sum = FilterCore::smaStep(this->window_sum, Sum(value), outgoing);
+  W next = FilterCore::ringNext(this->head, this->capacity);
+  if (this->spectrum != nullptr)
+    this->spectrum->update(value, full ? this->window[this->head] : U(0), this->capacity, next == 0);
+  this->window[this->head] = value;
+  this->head = next;
+  this->window_updated = true;
+
+  if (!FilterTraits<U>::INTEGRAL && this->head == 0)
+    this->resumWindow();
+}
+
+/**
+ * @brief Recomputes the running sums from the ring.
+ *
+ * Called once per revolution of the ring for floating point types, which bounds the rounding
+ * drift of the running sums at an amortized cost of O(1) per data point. Attached DFT bins are
+ * recomputed along with the sums.
+ */
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::resumWindow()
+{
+  Sum sum = 0;
+  Sum weighted_sum = 0;
+  for (W i = 0; i < this->num_elements; i++)
+  {
+    sum += this->window[i];
+    weighted_sum += Sum(this->window[i]) * (i + 1);
+  }
+  this->window_sum = sum;
+  this->weighted_sum = weighted_sum;
+  if (this->spectrum != nullptr)
+    this->spectrum->resum(this->window, this->num_elements, this->head, this->capacity);
+}
+
+/**
+ * @brief Moves the newest data points of the ring to its front, oldest first.
+ *
+ * Rotates a full ring so that the oldest data point comes first, by three reversals in place,
+ * then shifts the newest data points down. Leaves the ring ready for resumWindow().
+ *
+ * @param count The number of newest data points to keep, at most the number of elements.
+ */
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::retainNewest(W count)
+{
+  U* window = this->window;
+  W length = this->num_elements;
+  if (length == this->capacity && this->head != 0)
   {
-    for (uint8_t i = 0; i < window_size - 1; i++)
+    W reversals[3][2] = { { 0, this->head }, { this->head, length }, { 0, length } };
+    for (uint8_t r = 0; r < 3; r++)
     {
-      weight_coefficient = i + 1;
-      sum -= window[i] * weight_coefficient;
-      window[i] = window[i + 1];
-      sum += window[i] * weight_coefficient;
+      W first = reversals[r][0];
+      W last = reversals[r][1];
+      while (first + 1 < last)
+      {
+        last--;
+        U swap = window[first];
+        window[first] = window[last];
+        window[last] = swap;
+        first++;
+      }
     }
-    weight_coefficient = window_size;
-    sum -= window[window_size - 1] * weight_coefficient;
-    window[window_size - 1] = this->input;
-    sum += this->input * weight_coefficient;
   }
 
-  this->weighted_moving_average = 2 * sum / (num_elements * (num_elements + 1));
+  W dropped = length - count;
+  for (W i = 0; i < count; i++)
+  {
+    window[i] = window[dropped + i];
+  }
+}
 
-  return this->weighted_moving_average;
+/**
+ * @brief Divides the window sum by the window length.
+ *
+ * Once the ring is full the length no longer changes, so integral sums of up to 32 bits are divided
+ * by multiplying with the reciprocal precomputed in updateWindow(). While the ring fills, and for
+ * all other sums, the / operator is used. Both paths truncate toward zero.
+ *
+ * @return The Simple Moving Average as a sum type.
+ */
+template<typename T, typename U, typename W, typename I>
+typename MovingAverage<T, U, W, I>::Sum MovingAverage<T, U, W, I>::divideSum() const
+{
+  if (this->num_elements == this->capacity)
+    return this->divider.divideSum(this->window_sum, Sum(this->num_elements));
+  return this->window_sum / Sum(this->num_elements);
 }
 
 /**
- * @brief Calculates the Exponential Moving Average (EMA) for a given input.
+ * @brief Divides the weighted sum by the sum of the weights.
  *
- * Calculates the EMA based on the provided input and smoothing factor.
- * Apply different weights to current values and the previous average.
- * If the MovingAverage object is disabled, returns 0.
+ * Uses the precomputed reciprocal like divideSum().
  *
- * @param smoothing_factor In interval of [0; 1]. Applies more weight_coefficient to current
- * values, if > 0, or weighs previous average heavier, if < 0.
- * @return The calculated Exponential Moving Average (EMA).
+ * @return The Weighted Moving Average as a sum type.
  */
-template <typename T, typename U>
-U MovingAverage<T, U>::readExponentialAverage(float smoothing_factor)
+template<typename T, typename U, typename W, typename I>
+typename MovingAverage<T, U, W, I>::Sum MovingAverage<T, U, W, I>::divideWeightedSum() const
 {
-  if (!this->enabled)
+  Sum weight_total = FilterCore::wmaWeightTotal(Sum(this->num_elements));
+  if (this->num_elements == this->capacity)
+    return this->divider.divideWeightedSum(this->weighted_sum, weight_total);
+  return this->weighted_sum / weight_total;
+}
+
+/**
+ * @brief Returns the order statistic index of the window.
+ *
+ * The index is built from the ring on the first call and kept up to date by updateWindow() from
+ * then on, so objects that never read a median pay nothing for it. It is sized for the whole ring,
+ * so reconfigure() within the ring keeps it.
+ *
+ * @return The index holding the window in sorted order.
+ */
+template<typename T, typename U, typename W, typename I>
+I& MovingAverage<T, U, W, I>::orderIndex()
+{
+  if (this->order_index == nullptr)
+  {
+    this->order_index = I::forWindow(this->allocated);
+    this->rebuildIndex();
+  }
+  return *this->order_index;
+}
+
+/**
+ * @brief Rebuilds the order statistic index from the ring.
+ *
+ * Sorts a temporary copy of the window and bulk-loads the index from it, which costs O(n log n)
+ * with small constants instead of n insertions.
+ */
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::rebuildIndex()
+{
+  U* sorted = new U[this->num_elements ? this->num_elements : 1];
+  for (W i = 0; i < this->num_elements; i++)
+  {
+    sorted[i] = this->window[i];
+  }
+  sortValues(sorted, this->num_elements);
+  this->order_index->build(sorted, this->num_elements);
+  delete[] sorted;
+}
+
+/**
+ * @brief Sorts values in ascending order.
+ *
+ * Heapsort: O(n log n) in the worst case, in place and without recursion.
+ *
+ * @param values The values to sort.
+ * @param count The number of values.
+ */
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::sortValues(U* values, W count)
+{
+  for (W start = count / 2; start > 0; start--)
+  {
+    siftDown(values, W(start - 1), count);
+  }
+  for (W end = count; end > 1; end--)
+  {
+    U swap = values[0];
+    values[0] = values[end - 1];
+    values[end - 1] = swap;
+    siftDown(values, 0, W(end - 1));
+  }
+}
+
+/**
+ * @brief Moves a value down a max-heap until both children are smaller.
+ *
+ * @param values The heap.
+ * @param root The index of the value to move.
+ * @param count The number of values in the heap.
+ */
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::siftDown(U* values, W root, W count)
+{
+  while (count / 2 > root)
+  {
+    W child = root * 2 + 1;
+    if (child + 1 < count && values[child] < values[child + 1])
+      child++;
+    if (!(values[root] < values[child]))
+      return;
+    U swap = values[root];
+    values[root] = values[child];
+    values[child] = swap;
+    root = child;
+  }
+}
+
+/**
+ * @brief Returns a value of the window by its rank.
+ *
+ * @param rank The rank, 0 being the smallest value, less than the number of elements.
+ * @return The value of the given rank.
+ */
+template<typename T, typename U, typename W, typename I>
+U MovingAverage<T, U, W, I>::valueAtRank(int rank)
+{
+  U value = 0;
+  this->orderIndex().at(rank, value);
+  return value;
+}
+
+/**
+ * @brief Computes the median absolute deviation of the window.
+ *
+ * The deviations of the values below the median, read from the median downwards, and of the values
+ * from the median upwards form two ascending sequences. Their median is found by a binary search
+ * over the number of deviations taken from the lower sequence, with O(log n) lookups of O(log n)
+ * each. Like the median, the MAD is the upper middle deviation for an even window.
+ *
+ * @param median_index The index of the median in the order statistic index.
+ * @param median The median.
+ * @return The median absolute deviation.
+ */
+template<typename T, typename U, typename W, typename I>
+typename MovingAverage<T, U, W, I>::Sum MovingAverage<T, U, W, I>::medianAbsoluteDeviation(int median_index, Sum median)
+{
+  I& index = this->orderIndex();
+  int lower_count = median_index;                 // Deviations median - at(median_index - 1 - i)
+  int upper_count = index.size() - median_index;  // Deviations at(median_index + j) - median
+  int wanted = index.size() / 2 + 1;              // Number of smallest deviations up to the MAD
+
+  int low = wanted > upper_count ? wanted - upper_count : 0;
+  int high = wanted < lower_count ? wanted : lower_count;
+  while (true)
+  {
+    int taken = (low + high) / 2;  // Deviations taken from the lower sequence
+    int rest = wanted - taken;     // Deviations taken from the upper sequence
+    Sum last_lower = taken > 0 ? median - Sum(this->valueAtRank(median_index - taken)) : Sum(0);
+    Sum last_upper = rest > 0 ? Sum(this->valueAtRank(median_index + rest - 1)) - median : Sum(0);
+
+    if (taken > 0 && rest < upper_count && last_lower > Sum(this->valueAtRank(median_index + rest)) - median)
+    {
+      high = taken - 1;
+    }
+    else if (rest > 0 && taken < lower_count && last_upper > median - Sum(this->valueAtRank(median_index - taken - 1)))
+    {
+      low = taken + 1;
+    }
+    else
+    {
+      return taken == 0 ? last_upper : rest == 0 ? last_lower : last_lower > last_upper ? last_lower : last_upper;
+    }
+  }
+}
+
+/**
+ * @brief Converts a trim fraction to a number of data points.
+ *
+ * @param trim_fraction The fraction of data points at each end of the window.
+ * @return The rounded down number of data points, leaving at least one in the middle.
+ */
+template<typename T, typename U, typename W, typename I>
+W MovingAverage<T, U, W, I>::trimCount(float trim_fraction) const
+{
+  if (!(trim_fraction > 0))
     return 0;
 
-  static U average;
+  float trim = trim_fraction * this->num_elements;
+  return 2 * trim < this->num_elements ? W(trim) : W((this->num_elements - 1) / 2);
+}
 
-  this->exponential_moving_average = smoothing_factor * (this->input) + (1 - smoothing_factor) * average;
-  average = this->exponential_moving_average;
+#if defined(MOVINGAVERAGE_PROFILE)
+/**
+ * @brief Prints the latency percentiles of every profiled method.
+ *
+ * Outputs one line per method, starting with the method label and followed by the histogram
+ * summary in ticks of CycleCounter::read().
+ */
+template<typename T, typename U, typename W, typename I>
+void MovingAverage<T, U, W, I>::printProfile()
+{
+  static const char* const labels[PROFILE_METHODS] = { "add", "SMA", "CA", "WMA", "EMA", "MM", "Peak", "HF", "TM", "WM", "Pct", "Batch", "Slope", "Trend" };
 
-  return this->exponential_moving_average;
+  while (!Serial)
+  {
+  }
+
+  for (uint8_t i = 0; i < PROFILE_METHODS; i++)
+  {
+    Serial.print(labels[i]);
+    Serial.print("\t");
+    this->profile[i].print();
+  }
 }
 
-#endif // MOVINGAVERAGE_H
+/**
+ * @brief Returns the latency histogram of a profiled method.
+ *
+ * @param method The profiled method.
+ * @return The histogram of ticks spent in the method.
+ */
+template<typename T, typename U, typename W, typename I>
+const MOVINGAVERAGE_PROFILE_HISTOGRAM& MovingAverage<T, U, W, I>::readProfile(ProfiledMethod method) const
+{
+  return this->profile[method];
+}
+#endif
+
+#endif  // MOVINGAVERAGE_H
\ No newline at end of file
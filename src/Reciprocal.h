@@ -0,0 +1,236 @@
+/**
+ * @file Reciprocal.h
+ *
+ * @brief Division by invariant integers using multiplication, and a division-free running mean.
+ *
+ * Dividing a 32-bit integer costs several hundred cycles on AVR and tens of cycles on Cortex-M0.
+ * The averages divide by the window length on every read, although it only changes while the window
+ * fills. `Reciprocal` precomputes a magic multiplier for a divisor once (at compile time if the
+ * divisor is a constant) and then divides with one 32x32->64 multiplication, two subtractions and
+ * two shifts. The result matches the `/` operator exactly, including truncation toward zero.
+ * `CumulativeMean` keeps the cumulative average as quotient and remainder, so adding a data point
+ * usually needs no division at all.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef RECIPROCAL_H
+#define RECIPROCAL_H
+
+#include <stdint.h>
+#include "FilterTraits.h"
+
+/**
+ * @brief Precomputed reciprocal of a 32-bit divisor.
+ *
+ * Implements the round-up method of Granlund and Montgomery: with l = ceil(log2(d)) and
+ * m = floor(2^32 * (2^l - d) / d) + 1, the quotient of any 32-bit n is
+ * (t + ((n - t) >> min(l, 1))) >> max(l - 1, 0), where t = (m * n) >> 32.
+ */
+struct Reciprocal {
+  uint32_t multiplier;
+  uint8_t shift_1;
+  uint8_t shift_2;
+
+  /**
+   * @brief Constructs the reciprocal of 1.
+   */
+  constexpr Reciprocal()
+    : multiplier(1), shift_1(0), shift_2(0) {}
+
+  /**
+   * @brief Constructs the reciprocal of a divisor.
+   *
+   * @param divisor The divisor, must not be 0.
+   */
+  constexpr explicit Reciprocal(uint32_t divisor)
+    : multiplier(magic(divisor, ceilLog2(divisor))),
+      shift_1(ceilLog2(divisor) > 0 ? 1 : 0),
+      shift_2(ceilLog2(divisor) > 1 ? ceilLog2(divisor) - 1 : 0) {}
+
+  /**
+   * @brief Divides an unsigned value.
+   *
+   * @param numerator The dividend.
+   * @return numerator / divisor.
+   */
+  constexpr uint32_t divide(uint32_t numerator) const {
+    return combine(numerator, uint32_t((uint64_t(this->multiplier) * numerator) >> 32));
+  }
+
+  /**
+   * @brief Divides a signed value, truncating toward zero like the / operator.
+   *
+   * @param numerator The dividend.
+   * @return numerator / divisor.
+   */
+  constexpr int32_t divide(int32_t numerator) const {
+    return numerator < 0 ? -int32_t(divide(uint32_t(0) - uint32_t(numerator))) : int32_t(divide(uint32_t(numerator)));
+  }
+
+  static constexpr uint8_t floorLog2(uint32_t value) {
+    return value <= 1 ? 0 : 1 + floorLog2(value >> 1);
+  }
+
+  static constexpr uint8_t ceilLog2(uint32_t value) {
+    return value <= 1 ? 0 : 1 + floorLog2(value - 1);
+  }
+
+private:
+  static constexpr uint32_t magic(uint32_t divisor, uint8_t log) {
+    return uint32_t(((uint64_t(1) << 32) * ((uint64_t(1) << log) - divisor)) / divisor + 1);
+  }
+
+  constexpr uint32_t combine(uint32_t numerator, uint32_t high) const {
+    return (high + ((numerator - high) >> this->shift_1)) >> this->shift_2;
+  }
+};
+
+/**
+ * @brief Divides the window sums of a full window, for floating point and 64-bit sums.
+ *
+ * Stateless, both normalisers are divided with the / operator.
+ *
+ * @tparam S The type of the window sums.
+ * @tparam RECIPROCAL Whether S is integral and fits 32 bits.
+ */
+template<typename S, bool RECIPROCAL = FilterTraits<S>::INTEGRAL && sizeof(S) <= 4>
+struct WindowDivider {
+  void configure(uint32_t length) {
+    (void)length;
+  }
+
+  S divideSum(S sum, S length) const {
+    return sum / length;
+  }
+
+  S divideWeightedSum(S weighted_sum, S weight_total) const {
+    return weighted_sum / weight_total;
+  }
+};
+
+/**
+ * @brief Divides the window sums of a full window, for integral sums of up to 32 bits.
+ *
+ * Holds the reciprocals of the window length and of the WMA normaliser, computed once when the
+ * window becomes full.
+ *
+ * @tparam S The type of the window sums.
+ */
+template<typename S>
+struct WindowDivider<S, true> {
+  Reciprocal length_reciprocal;
+  Reciprocal weight_reciprocal;
+
+  /**
+   * @brief Computes the reciprocals for a window length.
+   *
+   * @param length The length of the full window.
+   */
+  void configure(uint32_t length) {
+    this->length_reciprocal = Reciprocal(length);
+    this->weight_reciprocal = Reciprocal(length * (length + 1) / 2);
+  }
+
+  S divideSum(S sum, S length) const {
+    (void)length;
+    return this->length_reciprocal.divide(sum);
+  }
+
+  S divideWeightedSum(S weighted_sum, S weight_total) const {
+    (void)weight_total;
+    return this->weight_reciprocal.divide(weighted_sum);
+  }
+};
+
+/**
+ * @brief Running mean of all data points, for floating point and 64-bit types.
+ *
+ * Keeps the total and divides on read.
+ *
+ * @tparam U The data type for the data points and the mean.
+ * @tparam INCREMENTAL Whether U is integral and fits 32 bits.
+ */
+template<typename U, bool INCREMENTAL = FilterTraits<U>::INTEGRAL && sizeof(U) <= 4>
+class CumulativeMean {
+public:
+  CumulativeMean()
+    : total(0) {}
+
+  void add(U input, uint32_t num_samples) {
+    (void)num_samples;
+    this->total += input;
+  }
+
+  U read(uint32_t num_samples) const {
+    return this->total / typename FilterTraits<U>::Total(num_samples);
+  }
+
+private:
+  typename FilterTraits<U>::Total total;
+};
+
+/**
+ * @brief Running mean of all data points, for integral types of up to 32 bits.
+ *
+ * Keeps the floored mean q and the remainder r of total = q * n + r with 0 <= r < n. Adding x
+ * turns this into total = q * (n + 1) + (r + x - q), so only if r + x - q falls outside [0; n + 1),
+ * i.e. the data point lies far from the mean relative to the number of data points, a division is
+ * needed. Reading applies the truncation of the / operator and never divides.
+ *
+ * @tparam U The data type for the data points and the mean.
+ */
+template<typename U>
+class CumulativeMean<U, true> {
+public:
+  CumulativeMean()
+    : quotient(0), remainder(0) {}
+
+  /**
+   * @brief Adds a data point.
+   *
+   * @param input The new data point.
+   * @param num_samples The number of data points including the new one.
+   */
+  void add(U input, uint32_t num_samples) {
+    int64_t excess = int64_t(this->remainder) + int64_t(input) - int64_t(this->quotient);
+    if (excess >= 0 && excess < int64_t(num_samples)) {
+      this->remainder = uint32_t(excess);
+      return;
+    }
+
+    int64_t steps = excess / int64_t(num_samples);
+    excess -= steps * int64_t(num_samples);
+    if (excess < 0) {
+      excess += num_samples;
+      steps--;
+    }
+    this->quotient = U(int64_t(this->quotient) + steps);
+    this->remainder = uint32_t(excess);
+  }
+
+  /**
+   * @brief Returns the mean truncated toward zero.
+   *
+   * @param num_samples The number of data points, unused.
+   * @return The cumulative average.
+   */
+  U read(uint32_t num_samples) const {
+    (void)num_samples;
+    return int64_t(this->quotient) < 0 && this->remainder != 0 ? U(this->quotient + 1) : this->quotient;
+  }
+
+private:
+  U quotient;
+  uint32_t remainder;
+};
+
+static_assert(Reciprocal(10).divide(uint32_t(12345)) == 1234, "reciprocal must divide exactly");
+static_assert(Reciprocal(7).divide(int32_t(-100)) == -14, "reciprocal must truncate toward zero");
+static_assert(Reciprocal(1).divide(uint32_t(0xFFFFFFFF)) == 0xFFFFFFFF, "reciprocal of 1 must be the identity");
+
+#endif  // RECIPROCAL_H
@@ -0,0 +1,484 @@
+/**
+ * @file SkipList.h
+ *
+ * @brief Implementation of a Skip List data structure.
+ *
+ * This header file provides the declaration of the SkipList class.
+ * A Skip List is a probabilistic data structure that allows fast search, insertion,
+ * and deletion operations. It maintains multiple levels of linked lists, where each
+ * higher level acts as an "express lane" for the levels below, enabling efficient
+ * traversal and manipulation of the list. Every link also stores its width, the number of
+ * values it skips, and the sum of these values, so the list is indexable and order statistics and
+ * sums of rank ranges cost O(log n). The nodes come from a pool sized once for the window, so
+ * inserting and removing values never allocates.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef SKIPLIST_H
+#define SKIPLIST_H
+
+#include <stdlib.h>
+#include "FilterTraits.h"
+
+/**
+ * @brief Represents a skip list data structure.
+ *
+ * Skip list allows fast search, insertion, and deletion operations.
+ *
+ * The nodes are slots 1 to capacity of a pool, slot 0 is the header. The level of a node is fixed
+ * by its slot: slot k has as many levels above the bottom one as k has trailing zero bits, up to
+ * the maximum level, so level i is used by the slots that are multiples of 2^i. The next, width and
+ * sum of every link are stored in three flat arrays, one run per level, and link i of slot k sits at
+ * position k >> i of its run, about 2 * capacity links in total. Free slots are kept in one list per
+ * level. insert() draws a random level and takes a free slot of that level, or of the nearest level
+ * with a free slot.
+ *
+ * @tparam T The data type of the values stored in the skip list.
+ * @tparam S The data type of the link sums (default: the Sum type of FilterTraits).
+ */
+template<typename T, typename S = typename FilterTraits<T>::Sum>
+class SkipList {
+public:
+  typedef S Sum;
+
+private:
+  int max_level;
+  int capacity;
+  int count;
+  T* values;          // Value of every slot
+  int* next;          // Slot linked to, 0 at the end of a level
+  int* width;         // Number of values skipped by the link
+  Sum* sum;           // Sum of the values skipped by the link
+  int* runs;          // Position of the first link of every level
+  int* free_slots;    // First free slot of every level, chained through the bottom links
+  int* update;        // Search path of insert() and remove()
+  int* rank;          // Ranks along the search path
+  Sum* rank_sum;      // Prefix sums along the search path
+
+  int randomLevel();
+  int levelOf(int slot) const;
+  int link(int slot, int level) const;
+  int takeSlot(int level);
+  void releaseSlot(int slot);
+
+public:
+  SkipList(int max_lvl, int capacity);
+  ~SkipList();
+
+  static SkipList* forWindow(int window_size);
+
+  void insert(T val);
+  bool remove(T val);
+  void clear();
+  void build(const T* sorted, int number);
+  T getMedian() const;
+  bool at(int index, T& value) const;
+  int rankOf(T val) const;
+  int size() const;
+  Sum sumSmallest(int number) const;
+
+  SkipList(const SkipList&) = delete;
+  SkipList& operator=(const SkipList&) = delete;
+};
+
+/**
+ * @brief Generates a random level for node insertion.
+ *
+ * @return A random level for the new node.
+ */
+template<typename T, typename S>
+int SkipList<T, S>::randomLevel() {
+  int level = 0;
+  while (rand() % 2 == 0 && level < max_level)
+    level++;
+  return level;
+}
+
+/**
+ * @brief Returns the level of a slot.
+ *
+ * @param slot The slot, 1 to capacity.
+ * @return The number of trailing zero bits of the slot, at most the maximum level.
+ */
+template<typename T, typename S>
+int SkipList<T, S>::levelOf(int slot) const {
+  int level = 0;
+  while (level < max_level && ((slot >> level) & 1) == 0)
+    level++;
+  return level;
+}
+
+/**
+ * @brief Returns the position of a link in the flat arrays.
+ *
+ * @param slot The slot, a multiple of 2^level.
+ * @param level The level of the link.
+ * @return The position in next, width and sum.
+ */
+template<typename T, typename S>
+int SkipList<T, S>::link(int slot, int level) const {
+  return runs[level] + (slot >> level);
+}
+
+/**
+ * @brief Takes a free slot from the pool.
+ *
+ * @param level The preferred level of the slot.
+ * @return A free slot of the preferred level or, if there is none, of the nearest level below or
+ * above it, 0 if the pool is exhausted.
+ */
+template<typename T, typename S>
+int SkipList<T, S>::takeSlot(int level) {
+  for (int distance = 0; distance <= max_level; distance++) {
+    int candidates[2] = { level - distance, level + distance };
+    for (int c = 0; c < 2; c++) {
+      int candidate = candidates[c];
+      if (candidate < 0 || candidate > max_level || free_slots[candidate] == 0)
+        continue;
+      int slot = free_slots[candidate];
+      free_slots[candidate] = next[link(slot, 0)];
+      return slot;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Returns a slot to the free list of its level.
+ *
+ * @param slot The slot.
+ */
+template<typename T, typename S>
+void SkipList<T, S>::releaseSlot(int slot) {
+  int level = levelOf(slot);
+  next[link(slot, 0)] = free_slots[level];
+  free_slots[level] = slot;
+}
+
+/**
+ * @brief Constructs a SkipList object.
+ *
+ * Allocates the pool of nodes and the search buffers, the only allocation of the list.
+ *
+ * @param max_lvl The maximum level of the skip list.
+ * @param capacity The maximum number of values in the skip list.
+ */
+template<typename T, typename S>
+SkipList<T, S>::SkipList(int max_lvl, int capacity)
+  : max_level(max_lvl), capacity(capacity > 0 ? capacity : 1), count(0) {
+  int links = 0;
+  runs = new int[max_level + 1];
+  for (int i = 0; i <= max_level; i++) {
+    runs[i] = links;
+    links += (this->capacity >> i) + 1;
+  }
+
+  values = new T[this->capacity + 1];
+  next = new int[links];
+  width = new int[links];
+  sum = new Sum[links];
+  free_slots = new int[max_level + 1];
+  update = new int[max_level + 1];
+  rank = new int[max_level + 1];
+  rank_sum = new Sum[max_level + 1];
+  clear();
+}
+
+/**
+ * @brief Creates an empty skip list for a window.
+ *
+ * Chooses ceil(log2(window_size)) + 1 levels, enough for O(log n) operations on a full window, and
+ * a pool of window_size nodes.
+ *
+ * @param window_size The number of values the list will hold.
+ * @return The new list, to be released with delete.
+ */
+template<typename T, typename S>
+SkipList<T, S>* SkipList<T, S>::forWindow(int window_size) {
+  int levels = 1;
+  while ((1L << (levels - 1)) < window_size)
+    levels++;
+  return new SkipList<T, S>(levels, window_size);
+}
+
+/**
+ * @brief Destructs the SkipList object.
+ *
+ * Releases the pool of nodes and the search buffers.
+ */
+template<typename T, typename S>
+SkipList<T, S>::~SkipList() {
+  delete[] values;
+  delete[] next;
+  delete[] width;
+  delete[] sum;
+  delete[] runs;
+  delete[] free_slots;
+  delete[] update;
+  delete[] rank;
+  delete[] rank_sum;
+}
+
+/**
+ * @brief Inserts a new value into the skip list.
+ *
+ * Adds a new node with the specified value at the appropriate position in the skip list.
+ * Duplicate values are kept, so the list is a sorted multiset of the window. The widths and sums
+ * of the links passing over the new node grow by one and by the value, the links ending at it are
+ * split. If the list already holds capacity values, the value is dropped.
+ *
+ * @param val The value to be inserted.
+ */
+template<typename T, typename S>
+void SkipList<T, S>::insert(T val) {
+  int slot = takeSlot(randomLevel());
+  if (slot == 0)
+    return;
+
+  int current = 0;
+  for (int i = max_level; i >= 0; i--) {
+    rank[i] = i == max_level ? 0 : rank[i + 1];
+    rank_sum[i] = i == max_level ? Sum(0) : rank_sum[i + 1];
+    for (int l = link(current, i); next[l] != 0 && values[next[l]] < val; l = link(current, i)) {
+      rank[i] += width[l];
+      rank_sum[i] += sum[l];
+      current = next[l];
+    }
+    update[i] = current;
+  }
+
+  int new_level = levelOf(slot);
+  values[slot] = val;
+  for (int i = 0; i <= max_level; i++) {
+    int before = link(update[i], i);
+    if (i <= new_level) {
+      int after = link(slot, i);
+      next[after] = next[before];
+      next[before] = slot;
+      width[after] = width[before] - (rank[0] - rank[i]);
+      width[before] = rank[0] - rank[i] + 1;
+      sum[after] = sum[before] - (rank_sum[0] - rank_sum[i]);
+      sum[before] = rank_sum[0] - rank_sum[i] + Sum(val);
+    } else {
+      width[before]++;
+      sum[before] += Sum(val);
+    }
+  }
+  count++;
+}
+
+/**
+ * @brief Removes a value from the skip list.
+ *
+ * Deletes one node containing the specified value from the skip list and returns it to the pool.
+ *
+ * @param val The value to be removed.
+ * @return True if the value was found and removed, false otherwise.
+ */
+template<typename T, typename S>
+bool SkipList<T, S>::remove(T val) {
+  int current = 0;
+  for (int i = max_level; i >= 0; i--) {
+    for (int l = link(current, i); next[l] != 0 && values[next[l]] < val; l = link(current, i))
+      current = next[l];
+    update[i] = current;
+  }
+
+  int slot = next[link(current, 0)];
+  if (slot == 0 || values[slot] != val)
+    return false;
+
+  for (int i = 0; i <= max_level; i++) {
+    int before = link(update[i], i);
+    if (next[before] == slot) {
+      int after = link(slot, i);
+      width[before] += width[after] - 1;
+      sum[before] += sum[after] - Sum(val);
+      next[before] = next[after];
+    } else {
+      width[before]--;
+      sum[before] -= Sum(val);
+    }
+  }
+
+  releaseSlot(slot);
+  count--;
+  return true;
+}
+
+/**
+ * @brief Removes all values from the skip list.
+ *
+ * Returns every node to the pool, in O(capacity).
+ */
+template<typename T, typename S>
+void SkipList<T, S>::clear() {
+  for (int i = 0; i <= max_level; i++) {
+    int l = link(0, i);
+    next[l] = 0;
+    width[l] = 1;
+    sum[l] = Sum(0);
+    free_slots[i] = 0;
+  }
+  for (int slot = capacity; slot > 0; slot--) {
+    releaseSlot(slot);
+  }
+  count = 0;
+}
+
+/**
+ * @brief Replaces the contents by values in ascending order.
+ *
+ * Builds a perfectly balanced list in one pass instead of inserting the values one by one: the
+ * k-th value (counting from 1) goes to slot k, which has as many levels as k has trailing zero
+ * bits, so every level holds every other node of the level below, and the widths and sums of the
+ * links follow from the running position and prefix sum. Costs O(n) instead of O(n log n).
+ *
+ * @param sorted The values in ascending order.
+ * @param number The number of values, at most the capacity.
+ */
+template<typename T, typename S>
+void SkipList<T, S>::build(const T* sorted, int number) {
+  if (number > capacity)
+    number = capacity;
+
+  for (int i = 0; i <= max_level; i++) {
+    free_slots[i] = 0;
+    update[i] = 0;
+    rank[i] = 0;
+    rank_sum[i] = Sum(0);
+  }
+
+  Sum prefix = 0;
+  for (int k = 1; k <= number; k++) {
+    int level = levelOf(k);
+    prefix += Sum(sorted[k - 1]);
+    values[k] = sorted[k - 1];
+    for (int i = 0; i <= level; i++) {
+      int before = link(update[i], i);
+      next[before] = k;
+      width[before] = k - rank[i];
+      sum[before] = prefix - rank_sum[i];
+      update[i] = k;
+      rank[i] = k;
+      rank_sum[i] = prefix;
+    }
+  }
+
+  // The last link of every level spans the rest of the list, like the links of insert().
+  for (int i = 0; i <= max_level; i++) {
+    int last = link(update[i], i);
+    next[last] = 0;
+    width[last] = number + 1 - rank[i];
+    sum[last] = prefix - rank_sum[i];
+  }
+  for (int slot = capacity; slot > number; slot--) {
+    releaseSlot(slot);
+  }
+  count = number;
+}
+
+/**
+ * @brief Retrieves the median value from the skip list.
+ *
+ * For an even number of values, the upper of the two middle values is returned.
+ *
+ * @return The median value in the skip list, or T() if the list is empty.
+ */
+template<typename T, typename S>
+T SkipList<T, S>::getMedian() const {
+  T median = T();
+  at(count / 2, median);
+  return median;
+}
+
+/**
+ * @brief Retrieves the value at the specified index in the skip list.
+ *
+ * Follows the link widths from the top level down, which takes O(log n) steps. Reports an invalid
+ * index through the return value instead of an exception, so it works in builds without exception
+ * support and never allocates.
+ *
+ * @param index The index of the value to retrieve, 0 being the smallest value.
+ * @param value Receives the value at the specified index, unchanged if the index is out of range.
+ * @return True if the index is in range, false otherwise.
+ */
+template<typename T, typename S>
+bool SkipList<T, S>::at(int index, T& value) const {
+  if (index < 0 || index >= count)
+    return false;
+
+  int current = 0;
+  int position = 0;
+  for (int i = max_level; i >= 0; i--) {
+    for (int l = link(current, i); next[l] != 0 && position + width[l] <= index + 1; l = link(current, i)) {
+      position += width[l];
+      current = next[l];
+    }
+  }
+  value = values[current];
+  return true;
+}
+
+/**
+ * @brief Returns the rank of a value.
+ *
+ * Follows the search path of insert(), which takes O(log n) steps.
+ *
+ * @param val The value to rank, not necessarily in the list.
+ * @return The number of values in the list smaller than val.
+ */
+template<typename T, typename S>
+int SkipList<T, S>::rankOf(T val) const {
+  int current = 0;
+  int position = 0;
+  for (int i = max_level; i >= 0; i--) {
+    for (int l = link(current, i); next[l] != 0 && values[next[l]] < val; l = link(current, i)) {
+      position += width[l];
+      current = next[l];
+    }
+  }
+  return position;
+}
+
+/**
+ * @brief Returns the number of values in the skip list.
+ *
+ * @return The number of values.
+ */
+template<typename T, typename S>
+int SkipList<T, S>::size() const {
+  return count;
+}
+
+/**
+ * @brief Sums the smallest values of the skip list.
+ *
+ * Adds up the link sums along the search path of at(), which takes O(log n) steps. The sum of the
+ * values with the indices a to b - 1 is sumSmallest(b) - sumSmallest(a). For floating point types
+ * the link sums are running sums and accumulate rounding errors like any other running sum.
+ *
+ * @param number The number of smallest values to sum, clamped to the size.
+ * @return The sum of the smallest values.
+ */
+template<typename T, typename S>
+typename SkipList<T, S>::Sum SkipList<T, S>::sumSmallest(int number) const {
+  int current = 0;
+  int position = 0;
+  Sum total = 0;
+  for (int i = max_level; i >= 0; i--) {
+    for (int l = link(current, i); next[l] != 0 && position + width[l] <= number; l = link(current, i)) {
+      position += width[l];
+      total += sum[l];
+      current = next[l];
+    }
+  }
+  return total;
+}
+
+#endif  // SKIPLIST_H
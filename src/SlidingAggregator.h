@@ -0,0 +1,341 @@
+/**
+ * @file SlidingAggregator.h
+ *
+ * @brief Template class for sliding-window aggregation with any associative operation.
+ *
+ * This header provides a `SlidingAggregator` class template that combines the last N data points
+ * with a user-defined monoid, i.e. an associative operation with an identity element, such as
+ * minimum, maximum, bitwise or, bitwise and or the greatest common divisor. Unlike the sums of
+ * `MovingAverage`, these operations cannot undo the evicted data point, so the window is split
+ * into blocks whose partial aggregates are precomputed. Adding a data point and reading the
+ * aggregate cost a constant number of combinations in the worst case, not just on average.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef SLIDINGAGGREGATOR_H
+#define SLIDINGAGGREGATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include "FilterCore.h"
+#include "FilterTraits.h"
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+/**
+ * @brief The extreme values of a type, the identities of minimum and maximum.
+ *
+ * @tparam T The data type.
+ * @tparam INTEGRAL Whether T is integral.
+ */
+template<typename T, bool INTEGRAL = FilterTraits<T>::INTEGRAL>
+struct OrderBounds {
+  static T highest() {
+    return T(HUGE_VAL);
+  }
+
+  static T lowest() {
+    return T(-HUGE_VAL);
+  }
+};
+
+template<typename T>
+struct OrderBounds<T, true> {
+  static T highest() {
+    return FilterCore::highest<T>();
+  }
+
+  static T lowest() {
+    return FilterCore::lowest<T>();
+  }
+};
+
+/**
+ * @brief The minimum of the window.
+ *
+ * A monoid provides the type of its values, its identity element and an associative combine()
+ * that receives the older value first, so operations that do not commute work as well.
+ *
+ * @tparam T The data type.
+ */
+template<typename T>
+struct MinMonoid {
+  typedef T Value;
+
+  static Value identity() {
+    return OrderBounds<T>::highest();
+  }
+
+  static Value combine(Value older, Value newer) {
+    return newer < older ? newer : older;
+  }
+};
+
+/**
+ * @brief The maximum of the window.
+ *
+ * @tparam T The data type.
+ */
+template<typename T>
+struct MaxMonoid {
+  typedef T Value;
+
+  static Value identity() {
+    return OrderBounds<T>::lowest();
+  }
+
+  static Value combine(Value older, Value newer) {
+    return older < newer ? newer : older;
+  }
+};
+
+/**
+ * @brief The bitwise or of the window, e.g. any status flag raised in the window.
+ *
+ * @tparam T The integral data type.
+ */
+template<typename T>
+struct OrMonoid {
+  typedef T Value;
+
+  static Value identity() {
+    return T(0);
+  }
+
+  static Value combine(Value older, Value newer) {
+    return T(older | newer);
+  }
+};
+
+/**
+ * @brief The bitwise and of the window, e.g. the status flags raised throughout the window.
+ *
+ * @tparam T The integral data type.
+ */
+template<typename T>
+struct AndMonoid {
+  typedef T Value;
+
+  static Value identity() {
+    return T(~T(0));
+  }
+
+  static Value combine(Value older, Value newer) {
+    return T(older & newer);
+  }
+};
+
+/**
+ * @brief The greatest common divisor of the window, e.g. the tick of a set of timestamps.
+ *
+ * @tparam T The unsigned integral data type.
+ */
+template<typename T>
+struct GcdMonoid {
+  typedef T Value;
+
+  static Value identity() {
+    return T(0);
+  }
+
+  static Value combine(Value older, Value newer) {
+    while (newer != 0) {
+      T remainder = T(older % newer);
+      older = newer;
+      newer = remainder;
+    }
+    return older;
+  }
+};
+
+/**
+ * @brief Template class for aggregating the last N data points with a monoid.
+ *
+ * The stream is cut into blocks of B = N / 2 data points, so a window consists of a suffix of the
+ * block before last, the whole last block and a prefix of the current block. The prefix and the
+ * aggregate of the last block are running values. The suffix aggregates of a block are computed
+ * backwards while the next block arrives, one per data point, so they are complete when the block
+ * becomes the oldest of the window. This de-amortizes the reversal of the two-stack algorithm:
+ * add() costs two combinations and read() two more, in the worst case.
+ *
+ * @tparam M The monoid, e.g. MinMonoid<int16_t>.
+ * @tparam N The number of data points in the window, at least 2 (default: 8).
+ */
+template<typename M, uint16_t N = 8>
+class SlidingAggregator {
+public:
+  typedef typename M::Value Value;
+
+  static_assert(N >= 2 && N <= 32768, "The window must hold 2 to 32768 data points");
+
+  SlidingAggregator();
+
+  void begin();
+  void end();
+  void reset();
+  void add(Value input);
+  void addBatch(const Value* samples, size_t n, size_t stride = 1);
+  void print();
+  Value read() const;
+  uint16_t size() const;
+
+private:
+  static const uint16_t BLOCK = N / 2;
+
+  Value values[2 * BLOCK];  // The last block and the current block, by parity of the block
+  Value suffixes[2][BLOCK + 1];  // Of the block before last, and of the last block in progress
+  Value last;  // Aggregate of the last block
+  Value prefix;  // Aggregate of the current block
+  uint16_t offset;  // Position of the newest data point in the current block
+  uint16_t num_elements;
+  uint8_t parity;  // Half of values holding the current block
+  bool enabled;
+};
+
+/**
+ * @brief Constructs a new SlidingAggregator object.
+ */
+template<typename M, uint16_t N>
+SlidingAggregator<M, N>::SlidingAggregator()
+  : enabled(false) {
+  this->reset();
+}
+
+/**
+ * @brief Enables the SlidingAggregator object.
+ */
+template<typename M, uint16_t N>
+void SlidingAggregator<M, N>::begin() {
+  this->enabled = true;
+}
+
+/**
+ * @brief Disables the SlidingAggregator object.
+ */
+template<typename M, uint16_t N>
+void SlidingAggregator<M, N>::end() {
+  this->enabled = false;
+}
+
+/**
+ * @brief Clears all data points.
+ *
+ * Fills the blocks with the identity, so the window aggregates only the data points added so far
+ * until it is full. Costs O(N).
+ */
+template<typename M, uint16_t N>
+void SlidingAggregator<M, N>::reset() {
+  for (uint16_t i = 0; i < 2 * BLOCK; i++) {
+    this->values[i] = M::identity();
+  }
+  for (uint16_t i = 0; i <= BLOCK; i++) {
+    this->suffixes[0][i] = M::identity();
+    this->suffixes[1][i] = M::identity();
+  }
+  this->last = M::identity();
+  this->prefix = M::identity();
+  this->offset = BLOCK - 1;
+  this->num_elements = 0;
+  this->parity = 1;
+}
+
+/**
+ * @brief Adds a data point, evicting the oldest one once the window is full.
+ *
+ * Extends the prefix of the current block and computes one suffix aggregate of the last block.
+ * When the current block is complete, it becomes the last block and the finished suffixes
+ * replace those of the block that leaves the window.
+ *
+ * @param input The new data point.
+ */
+template<typename M, uint16_t N>
+void SlidingAggregator<M, N>::add(Value input) {
+  if (!this->enabled)
+    return;
+
+  if (++this->offset == BLOCK) {
+    this->offset = 0;
+    this->parity ^= 1;
+    this->last = this->prefix;
+    this->prefix = M::identity();
+  }
+  if (this->num_elements < N)
+    this->num_elements++;
+
+  uint16_t offset = this->offset;
+  Value* block = this->values + BLOCK * this->parity;
+  const Value* last_block = this->values + BLOCK * (this->parity ^ 1);
+  Value* building = this->suffixes[this->parity];
+
+  block[offset] = input;
+  this->prefix = M::combine(this->prefix, input);
+
+  // Suffixes of the last block, from its end to its start while the current block fills
+  uint16_t position = BLOCK - 1 - offset;
+  building[position] = M::combine(last_block[position], building[position + 1]);
+}
+
+/**
+ * @brief Adds a block of data points, e.g. half of a DMA buffer.
+ *
+ * @param samples The first data point, oldest first.
+ * @param n The number of data points.
+ * @param stride The distance between two data points, e.g. the number of interleaved channels.
+ */
+template<typename M, uint16_t N>
+void SlidingAggregator<M, N>::addBatch(const Value* samples, size_t n, size_t stride) {
+  for (size_t i = 0; i < n; i++) {
+    this->add(samples[i * stride]);
+  }
+}
+
+/**
+ * @brief Prints the aggregate of the window.
+ */
+template<typename M, uint16_t N>
+void SlidingAggregator<M, N>::print() {
+  while (!Serial) {
+  }
+
+  Serial.print("Agg:");
+  Serial.print(this->read());
+  Serial.print("\n");
+}
+
+/**
+ * @brief Returns the aggregate of the window.
+ *
+ * Combines the suffix of the block before last that is still in the window, the last block and
+ * the prefix of the current block, oldest first.
+ *
+ * @return The aggregate of the last N data points, or of all data points while the window fills,
+ * the identity if there are none.
+ */
+template<typename M, uint16_t N>
+typename SlidingAggregator<M, N>::Value SlidingAggregator<M, N>::read() const {
+  const Value* oldest = this->suffixes[this->parity ^ 1];
+  uint16_t start = this->offset + 1 - (N - 2 * BLOCK);
+  return M::combine(M::combine(oldest[start], this->last), this->prefix);
+}
+
+/**
+ * @brief Returns the number of data points in the window.
+ *
+ * @return The number of data points, at most N.
+ */
+template<typename M, uint16_t N>
+uint16_t SlidingAggregator<M, N>::size() const {
+  return this->num_elements;
+}
+
+#endif  // SLIDINGAGGREGATOR_H
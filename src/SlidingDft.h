@@ -0,0 +1,370 @@
+/**
+ * @file SlidingDft.h
+ *
+ * @brief Sliding DFT bins that follow the ring of a MovingAverage.
+ *
+ * This header provides a `SlidingDft` class template that keeps a few bins of the discrete Fourier
+ * transform of the window up to date, e.g. to watch mains hum or the speed of a motor next to the
+ * averages. Attached to a `MovingAverage` with `attach()`, it is updated with the incoming data
+ * point and the one leaving the ring, so each bin costs O(1) per data point and no second copy of
+ * the window is kept. For a single frequency of a recorded block, `goertzel()` computes the
+ * amplitude in one pass.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef SLIDINGDFT_H
+#define SLIDINGDFT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include "FilterTraits.h"
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+/**
+ * @brief Arithmetic of the sliding DFT bins.
+ *
+ * Bins of 8-bit and 16-bit integral data are fixed point: the phasors are Q30 in `int32_t` and
+ * the products of data points and phasors are summed exactly in `int64_t`, so no FPU is needed
+ * per data point and the sums never drift. Wider integral and floating point data use `float`
+ * phasors and `double` sums.
+ *
+ * @tparam U The data type of the data points.
+ * @tparam FIXED Whether U is integral and at most 16 bits wide.
+ */
+template<typename U, bool FIXED = FilterTraits<U>::INTEGRAL && sizeof(U) <= 2>
+struct DftArithmetic {
+  typedef float Phase;
+  typedef double Difference;
+  typedef double Accumulator;
+
+  static Phase unit(double value) {
+    return Phase(value);
+  }
+
+  static Phase multiply(Phase a, Phase b) {
+    return a * b;
+  }
+
+  static Accumulator scale(Difference difference, Phase phase) {
+    return difference * phase;
+  }
+
+  static float real(Accumulator sum) {
+    return float(sum);
+  }
+};
+
+template<typename U>
+struct DftArithmetic<U, true> {
+  typedef int32_t Phase;  // Q30
+  typedef int32_t Difference;
+  typedef int64_t Accumulator;
+
+  static Phase unit(double value) {
+    return Phase(lround(value * 1073741824.0));
+  }
+
+  static Phase multiply(Phase a, Phase b) {
+    return Phase((int64_t(a) * b + (int64_t(1) << 29)) >> 30);
+  }
+
+  static Accumulator scale(Difference difference, Phase phase) {
+    return int64_t(difference) * phase;
+  }
+
+  static float real(Accumulator sum) {
+    return float(sum) * (1.0f / 1073741824.0f);
+  }
+};
+
+/**
+ * @brief Sliding DFT bins of a window of N data points.
+ *
+ * Bin k measures the frequency of k cycles per window, i.e. k * f / N for a sample rate f, so
+ * choose the window size to put the frequency of interest on a bin, e.g. N = 100 at 1 kHz for
+ * bins 10 Hz apart and k = 5 for 50 Hz hum.
+ *
+ * Each bin uses the modulated form of the sliding DFT: slot h of the ring contributes its data
+ * point times the phasor e^(-2πi k h / N) to the sum of the bin, so replacing the data point in
+ * the slot adds the difference of the incoming and the outgoing data point times the same phasor.
+ * The phasor advances by one complex multiplication per data point and restarts at 1 whenever the
+ * ring wraps, so a slot always sees the same phasor and the outgoing term cancels exactly what
+ * was added N data points before. With fixed point sums the bins therefore never drift. With
+ * floating point sums the bins are recomputed from the ring with the running sums of the filter,
+ * once per revolution. Reads rotate the sum to the position of the newest data point.
+ *
+ * While the window fills, the missing data points count as 0. A SlidingDft follows one filter.
+ *
+ * @tparam U The data type of the data points in the ring.
+ */
+template<typename U = int16_t>
+class SlidingDft {
+public:
+  SlidingDft(const uint32_t* bins, uint8_t count);
+  ~SlidingDft();
+
+  void reset();
+  void update(U incoming, U outgoing, size_t length, bool wrapped);
+  void resum(const U* window, size_t count, size_t head, size_t length);
+  float readMagnitude(uint8_t bin) const;
+  float readPhase(uint8_t bin) const;
+  uint8_t size() const;
+
+  static float goertzel(const U* samples, size_t n, float cycles);
+
+  SlidingDft(const SlidingDft&) = delete;
+  SlidingDft& operator=(const SlidingDft&) = delete;
+
+private:
+  typedef DftArithmetic<U> Arithmetic;
+  typedef typename Arithmetic::Phase Phase;
+  typedef typename Arithmetic::Accumulator Accumulator;
+  typedef typename Arithmetic::Difference Difference;
+
+  struct Bin {
+    Accumulator sum_re;
+    Accumulator sum_im;
+    Phase phase_re;  // Phasor of the slot at the head of the ring
+    Phase phase_im;
+    Phase step_re;  // e^(-2πi k / N)
+    Phase step_im;
+    uint32_t index;
+  };
+
+  Bin* bins;
+  size_t length;
+  uint8_t count;
+
+  void configure(size_t length);
+  static void rotate(Bin& bin);
+};
+
+/**
+ * @brief Constructs a new SlidingDft object.
+ *
+ * @param bins The bin indices k, reduced modulo the window size.
+ * @param count The number of bins.
+ */
+template<typename U>
+SlidingDft<U>::SlidingDft(const uint32_t* bins, uint8_t count)
+  : bins(new Bin[count]), length(0), count(count) {
+  for (uint8_t b = 0; b < count; b++) {
+    this->bins[b].index = bins[b];
+  }
+  this->configure(1);
+}
+
+/**
+ * @brief Destructs a SlidingDft object.
+ */
+template<typename U>
+SlidingDft<U>::~SlidingDft() {
+  delete[] this->bins;
+}
+
+/**
+ * @brief Clears the bins, as for an empty ring.
+ */
+template<typename U>
+void SlidingDft<U>::reset() {
+  for (uint8_t b = 0; b < this->count; b++) {
+    Bin& bin = this->bins[b];
+    bin.sum_re = 0;
+    bin.sum_im = 0;
+    bin.phase_re = Arithmetic::unit(1.0);
+    bin.phase_im = 0;
+  }
+}
+
+/**
+ * @brief Replaces the data point in the slot at the head of the ring.
+ *
+ * Called by the filter for every data point entering its ring, in O(1) per bin.
+ *
+ * @param incoming The data point written to the slot.
+ * @param outgoing The data point previously in the slot, 0 while the ring fills.
+ * @param length The length of the ring N.
+ * @param wrapped Whether the head of the ring returns to the first slot after this data point.
+ */
+template<typename U>
+void SlidingDft<U>::update(U incoming, U outgoing, size_t length, bool wrapped) {
+  if (length != this->length)
+    this->configure(length);
+
+  Difference difference = Difference(incoming) - Difference(outgoing);
+  for (uint8_t b = 0; b < this->count; b++) {
+    Bin& bin = this->bins[b];
+    bin.sum_re += Arithmetic::scale(difference, bin.phase_re);
+    bin.sum_im += Arithmetic::scale(difference, bin.phase_im);
+    if (wrapped) {
+      bin.phase_re = Arithmetic::unit(1.0);
+      bin.phase_im = 0;
+    } else {
+      rotate(bin);
+    }
+  }
+}
+
+/**
+ * @brief Recomputes the bins from the ring, in O(N) per bin.
+ *
+ * Generates the phasors slot by slot exactly as update() does, so the following updates cancel
+ * the recomputed contributions.
+ *
+ * @param window The ring.
+ * @param count The number of data points, in the first slots unless the ring is full.
+ * @param head The slot the next data point is written to.
+ * @param length The length of the ring N.
+ */
+template<typename U>
+void SlidingDft<U>::resum(const U* window, size_t count, size_t head, size_t length) {
+  this->configure(length);
+  for (uint8_t b = 0; b < this->count; b++) {
+    Bin& bin = this->bins[b];
+    Accumulator sum_re = 0;
+    Accumulator sum_im = 0;
+    Phase head_re = bin.phase_re;
+    Phase head_im = bin.phase_im;
+    for (size_t h = 0; h < count; h++) {
+      if (h == head) {
+        head_re = bin.phase_re;
+        head_im = bin.phase_im;
+      }
+      sum_re += Arithmetic::scale(Difference(window[h]), bin.phase_re);
+      sum_im += Arithmetic::scale(Difference(window[h]), bin.phase_im);
+      rotate(bin);
+    }
+    if (head == count) {
+      head_re = bin.phase_re;
+      head_im = bin.phase_im;
+    }
+    bin.sum_re = sum_re;
+    bin.sum_im = sum_im;
+    bin.phase_re = head_re;
+    bin.phase_im = head_im;
+  }
+}
+
+/**
+ * @brief Returns the amplitude of the frequency of a bin.
+ *
+ * A sinusoid of amplitude A on the bin reads A, a constant offset reads the offset on bin 0.
+ *
+ * @param bin The position of the bin in the indices passed to the constructor.
+ * @return The amplitude in units of the data points.
+ */
+template<typename U>
+float SlidingDft<U>::readMagnitude(uint8_t bin) const {
+  const Bin& state = this->bins[bin];
+  float re = Arithmetic::real(state.sum_re);
+  float im = Arithmetic::real(state.sum_im);
+  size_t k = state.index % this->length;
+  float scale = k == 0 || 2 * k == this->length ? 1.0f : 2.0f;
+  return scale * sqrtf(re * re + im * im) / float(this->length);
+}
+
+/**
+ * @brief Returns the phase of the frequency of a bin at the newest data point.
+ *
+ * A cosine on the bin reads 0 at its maxima and -π / 2 a quarter period before them.
+ *
+ * @param bin The position of the bin in the indices passed to the constructor.
+ * @return The phase in radians, in [-π; π].
+ */
+template<typename U>
+float SlidingDft<U>::readPhase(uint8_t bin) const {
+  const Bin& state = this->bins[bin];
+  float sum_re = Arithmetic::real(state.sum_re);
+  float sum_im = Arithmetic::real(state.sum_im);
+  float phase = atan2f(sum_im, sum_re) - atan2f(float(state.phase_im), float(state.phase_re));
+  float step = atan2f(float(state.step_im), float(state.step_re));
+  phase += step;
+  while (phase > float(M_PI))
+    phase -= 2.0f * float(M_PI);
+  while (phase < -float(M_PI))
+    phase += 2.0f * float(M_PI);
+  return phase;
+}
+
+/**
+ * @brief Returns the number of bins.
+ *
+ * @return The number of bins passed to the constructor.
+ */
+template<typename U>
+uint8_t SlidingDft<U>::size() const {
+  return this->count;
+}
+
+/**
+ * @brief Computes the amplitude of one frequency of a block with the Goertzel algorithm.
+ *
+ * Costs one multiplication per data point and needs no ring, e.g. to check a recorded buffer for
+ * hum. The frequency need not be a whole number of cycles per block.
+ *
+ * @param samples The data points, oldest first.
+ * @param n The number of data points.
+ * @param cycles The frequency in cycles per block, i.e. f * n / sample rate.
+ * @return The amplitude in units of the data points, 0 for an empty block.
+ */
+template<typename U>
+float SlidingDft<U>::goertzel(const U* samples, size_t n, float cycles) {
+  if (n == 0)
+    return 0;
+
+  float omega = 2.0f * float(M_PI) * cycles / float(n);
+  float coefficient = 2.0f * cosf(omega);
+  float s1 = 0;
+  float s2 = 0;
+  for (size_t i = 0; i < n; i++) {
+    float s0 = float(samples[i]) + coefficient * s1 - s2;
+    s2 = s1;
+    s1 = s0;
+  }
+  float power = s1 * s1 + s2 * s2 - coefficient * s1 * s2;
+  float scale = fabsf(sinf(omega)) < 1e-6f ? 1.0f : 2.0f;
+  return power > 0 ? scale * sqrtf(power) / float(n) : 0.0f;
+}
+
+/**
+ * @brief Computes the phasor steps for a window length and clears the bins.
+ *
+ * @param length The length of the ring N.
+ */
+template<typename U>
+void SlidingDft<U>::configure(size_t length) {
+  this->length = length;
+  for (uint8_t b = 0; b < this->count; b++) {
+    Bin& bin = this->bins[b];
+    double angle = -2.0 * M_PI * double(bin.index % length) / double(length);
+    bin.step_re = Arithmetic::unit(cos(angle));
+    bin.step_im = Arithmetic::unit(sin(angle));
+  }
+  this->reset();
+}
+
+/**
+ * @brief Advances the phasor of a bin to the next slot.
+ *
+ * @param bin The bin to advance.
+ */
+template<typename U>
+void SlidingDft<U>::rotate(Bin& bin) {
+  Phase re = Arithmetic::multiply(bin.phase_re, bin.step_re) - Arithmetic::multiply(bin.phase_im, bin.step_im);
+  Phase im = Arithmetic::multiply(bin.phase_re, bin.step_im) + Arithmetic::multiply(bin.phase_im, bin.step_re);
+  bin.phase_re = re;
+  bin.phase_im = im;
+}
+
+#endif  // SLIDINGDFT_H
@@ -0,0 +1,296 @@
+/**
+ * @file WindowHistory.h
+ *
+ * @brief Template class for averages, minima and maxima of any window of a shared history.
+ *
+ * This header provides a `WindowHistory` class template that keeps the last N data points of a
+ * stream in a ring whose slots are the leaves of a segment tree over sums, minima and maxima. Any
+ * number of consumers can then read the average, minimum or maximum of the newest k data points
+ * for any k up to N, e.g. 10, 60 and 300 samples for a dashboard, in O(log N) and without a
+ * window of their own.
+ *
+ * @author Maximilian Kautzsch
+ * @copyright Copyright (c) 2024 Maximilian Kautzsch
+ * Licensed under MIT License.
+ */
+
+#pragma once
+
+#ifndef WINDOWHISTORY_H
+#define WINDOWHISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FilterCore.h"
+#include "FilterTraits.h"
+#include "SlidingAggregator.h"
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+/**
+ * @brief Template class for window queries over the last N data points.
+ *
+ * The segment tree is stored bottom-up in one array of 2 N nodes: node N + i is slot i of the
+ * ring and node p combines nodes 2 p and 2 p + 1. Adding a data point rewrites its slot and the
+ * O(log N) nodes above it. A window of the newest k data points is one or, if it wraps around the
+ * ring, two ranges of slots, each covered by O(log N) nodes. As every node is recomputed from its
+ * children, floating point sums do not drift.
+ *
+ * Sums use the `Sum` type of FilterTraits, which holds N data points of up to 16 bits.
+ *
+ * @tparam T The data type for input values and averages (default: int16_t).
+ * @tparam N The number of data points in the history (default: 64).
+ */
+template<typename T = int16_t, uint16_t N = 64>
+class WindowHistory {
+public:
+  static_assert(N >= 2, "The history must hold at least two data points");
+
+  WindowHistory();
+
+  void begin();
+  void end();
+  void reset();
+  void add(T input);
+  void addBatch(const T* samples, size_t n, size_t stride = 1);
+  void print();
+  T readAverage(uint16_t window_size) const;
+  T readMinimum(uint16_t window_size) const;
+  T readMaximum(uint16_t window_size) const;
+  uint16_t size() const;
+
+private:
+  typedef typename FilterTraits<T>::Sum Sum;
+
+  struct Node {
+    Sum sum;
+    T low;
+    T high;
+  };
+
+  Node nodes[2 * size_t(N)];
+  uint16_t head;
+  uint16_t num_elements;
+  bool enabled;
+
+  Node query(uint16_t window_size) const;
+  void collect(Node& result, size_t first, size_t last) const;
+  static Node identity();
+  static void merge(Node& result, const Node& node);
+};
+
+/**
+ * @brief Constructs a new WindowHistory object.
+ */
+template<typename T, uint16_t N>
+WindowHistory<T, N>::WindowHistory()
+  : head(0), num_elements(0), enabled(false) {
+  this->reset();
+}
+
+/**
+ * @brief Enables the WindowHistory object.
+ */
+template<typename T, uint16_t N>
+void WindowHistory<T, N>::begin() {
+  this->enabled = true;
+}
+
+/**
+ * @brief Disables the WindowHistory object.
+ */
+template<typename T, uint16_t N>
+void WindowHistory<T, N>::end() {
+  this->enabled = false;
+}
+
+/**
+ * @brief Clears all data points. Costs O(N).
+ */
+template<typename T, uint16_t N>
+void WindowHistory<T, N>::reset() {
+  for (size_t i = 0; i < 2 * size_t(N); i++) {
+    this->nodes[i] = identity();
+  }
+  this->head = 0;
+  this->num_elements = 0;
+}
+
+/**
+ * @brief Adds a data point, evicting the oldest one once the history is full.
+ *
+ * @param input The new data point.
+ */
+template<typename T, uint16_t N>
+void WindowHistory<T, N>::add(T input) {
+  if (!this->enabled)
+    return;
+
+  size_t position = size_t(N) + this->head;
+  Node& leaf = this->nodes[position];
+  leaf.sum = Sum(input);
+  leaf.low = input;
+  leaf.high = input;
+  for (position >>= 1; position > 0; position >>= 1) {
+    Node node = this->nodes[2 * position];
+    merge(node, this->nodes[2 * position + 1]);
+    this->nodes[position] = node;
+  }
+
+  this->head = FilterCore::ringNext<uint16_t>(this->head, N);
+  if (this->num_elements < N)
+    this->num_elements++;
+}
+
+/**
+ * @brief Adds a block of data points, e.g. half of a DMA buffer.
+ *
+ * @param samples The first data point, oldest first.
+ * @param n The number of data points.
+ * @param stride The distance between two data points, e.g. the number of interleaved channels.
+ */
+template<typename T, uint16_t N>
+void WindowHistory<T, N>::addBatch(const T* samples, size_t n, size_t stride) {
+  for (size_t i = 0; i < n; i++) {
+    this->add(samples[i * stride]);
+  }
+}
+
+/**
+ * @brief Prints the average, minimum and maximum of the whole history.
+ */
+template<typename T, uint16_t N>
+void WindowHistory<T, N>::print() {
+  while (!Serial) {
+  }
+
+  Serial.print("Avg:");
+  Serial.print(this->readAverage(N));
+  Serial.print("\tMin:");
+  Serial.print(this->readMinimum(N));
+  Serial.print("\tMax:");
+  Serial.print(this->readMaximum(N));
+  Serial.print("\n");
+}
+
+/**
+ * @brief Returns the average of the newest data points.
+ *
+ * Integral averages truncate toward zero, as those of MovingAverage.
+ *
+ * @param window_size The number of newest data points k, clamped to the data points available.
+ * @return The average, 0 if the object is disabled or empty.
+ */
+template<typename T, uint16_t N>
+T WindowHistory<T, N>::readAverage(uint16_t window_size) const {
+  if (!this->enabled || this->num_elements == 0 || window_size == 0)
+    return 0;
+
+  uint16_t length = window_size < this->num_elements ? window_size : this->num_elements;
+  return T(this->query(length).sum / Sum(length));
+}
+
+/**
+ * @brief Returns the minimum of the newest data points.
+ *
+ * @param window_size The number of newest data points k, clamped to the data points available.
+ * @return The minimum, 0 if the object is disabled or empty.
+ */
+template<typename T, uint16_t N>
+T WindowHistory<T, N>::readMinimum(uint16_t window_size) const {
+  if (!this->enabled || this->num_elements == 0 || window_size == 0)
+    return 0;
+
+  return this->query(window_size).low;
+}
+
+/**
+ * @brief Returns the maximum of the newest data points.
+ *
+ * @param window_size The number of newest data points k, clamped to the data points available.
+ * @return The maximum, 0 if the object is disabled or empty.
+ */
+template<typename T, uint16_t N>
+T WindowHistory<T, N>::readMaximum(uint16_t window_size) const {
+  if (!this->enabled || this->num_elements == 0 || window_size == 0)
+    return 0;
+
+  return this->query(window_size).high;
+}
+
+/**
+ * @brief Returns the number of data points in the history.
+ *
+ * @return The number of data points, at most N.
+ */
+template<typename T, uint16_t N>
+uint16_t WindowHistory<T, N>::size() const {
+  return this->num_elements;
+}
+
+/**
+ * @brief Combines the newest data points.
+ *
+ * @param window_size The number of newest data points, clamped to the data points available.
+ * @return The sum, minimum and maximum of the data points.
+ */
+template<typename T, uint16_t N>
+typename WindowHistory<T, N>::Node WindowHistory<T, N>::query(uint16_t window_size) const {
+  size_t length = window_size < this->num_elements ? window_size : this->num_elements;
+  Node result = identity();
+  if (length <= this->head) {
+    this->collect(result, this->head - length, this->head);
+  } else {
+    this->collect(result, size_t(N) - (length - this->head), N);
+    this->collect(result, 0, this->head);
+  }
+  return result;
+}
+
+/**
+ * @brief Combines a range of slots into a result, bottom-up in O(log N).
+ *
+ * @param result The node to combine the range into.
+ * @param first The first slot of the range.
+ * @param last The slot after the range.
+ */
+template<typename T, uint16_t N>
+void WindowHistory<T, N>::collect(Node& result, size_t first, size_t last) const {
+  for (first += N, last += N; first < last; first >>= 1, last >>= 1) {
+    if (first & 1)
+      merge(result, this->nodes[first++]);
+    if (last & 1)
+      merge(result, this->nodes[--last]);
+  }
+}
+
+/**
+ * @brief Returns the node of an empty range.
+ */
+template<typename T, uint16_t N>
+typename WindowHistory<T, N>::Node WindowHistory<T, N>::identity() {
+  Node node;
+  node.sum = 0;
+  node.low = MinMonoid<T>::identity();
+  node.high = MaxMonoid<T>::identity();
+  return node;
+}
+
+/**
+ * @brief Combines a node into a result.
+ *
+ * @param result The node to combine into.
+ * @param node The node to combine.
+ */
+template<typename T, uint16_t N>
+void WindowHistory<T, N>::merge(Node& result, const Node& node) {
+  result.sum += node.sum;
+  result.low = MinMonoid<T>::combine(result.low, node.low);
+  result.high = MaxMonoid<T>::combine(result.high, node.high);
+}
+
+#endif  // WINDOWHISTORY_H